@@ -0,0 +1,234 @@
+#include "AudioCache.h"
+#include "AudioDecode.h"
+#include "TimeStretch.h"
+#include "Trace.h"
+#include "ZipArchive.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QPromise>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrent>
+#include <cmath>
+
+static QFuture<DecodedAudioPtr> readyFuture(const DecodedAudioPtr &audio) {
+    QPromise<DecodedAudioPtr> promise;
+    promise.start();
+    promise.addResult(audio);
+    promise.finish();
+    return promise.future();
+}
+
+AudioCache::AudioCache() {
+    // 变速渲染是纯计算，一首歌要跑好几秒：只给一个最低优先级的线程，游戏线程和解码不会被挤占
+    m_stretchPool.setMaxThreadCount(1);
+    m_stretchPool.setThreadPriority(QThread::LowestPriority);
+}
+
+AudioCache::~AudioCache() {
+    QMutexLocker locker(&m_mutex);
+    for (const Job &job : std::as_const(m_stretchJobs)) job.cancelled->store(true);
+    locker.unlock();
+    m_stretchPool.waitForDone();
+}
+
+AudioCache &AudioCache::instance() {
+    static AudioCache cache;
+    return cache;
+}
+
+QString AudioCache::keyFor(const QString &path) {
+    // 包内的音频按包文件的大小 / 修改时间识别 (包被替换时缓存自然失效)
+    QString archive;
+    const bool packed = ZipArchive::splitPath(path, &archive, nullptr);
+    QFileInfo info(packed ? archive : path);
+    return QString("%1|%2|%3").arg(packed ? path : info.absoluteFilePath())
+                              .arg(info.size())
+                              .arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+QFuture<DecodedAudioPtr> AudioCache::request(const QString &path, bool pin) {
+    const QString key = keyFor(path);
+
+    QMutexLocker locker(&m_mutex);
+    if (DecodedAudioPtr audio = lookup(key)) {
+        m_hits++;
+        return readyFuture(audio);
+    }
+
+    auto it = m_jobs.find(key);
+    if (it != m_jobs.end() && !it->cancelled->load()) {
+        m_hits++;
+        if (pin) it->pinned = true;
+        return it->future;
+    }
+
+    // 新解码 (之前被取消的同名任务会自己结束，不影响这里)
+    m_misses++;
+    auto cancelled = std::make_shared<std::atomic_bool>(false);
+    Job job;
+    job.cancelled = cancelled;
+    job.pinned = pin;
+    job.future = QtConcurrent::run([this, key, path, cancelled]() -> DecodedAudioPtr {
+        QElapsedTimer timer;
+        timer.start();
+        AudioDecode::Result r = AudioDecode::decode(path, 0, 0, cancelled.get());
+
+        DecodedAudioPtr audio;
+        if (r.ok && !cancelled->load()) {
+            auto decoded = std::make_shared<DecodedAudio>();
+            decoded->key = key;
+            decoded->path = path;
+            decoded->format = r.format;
+            decoded->durationMs = r.format.durationForBytes(r.pcm.size()) / 1000;
+            decoded->pcm = std::move(r.pcm);
+            audio = decoded;
+        } else if (!cancelled->load()) {
+            qDebug() << "Audio decode failed:" << path << r.error;
+        }
+
+        QMutexLocker locker(&m_mutex);
+        auto it = m_jobs.find(key);
+        if (it != m_jobs.end() && it->cancelled == cancelled) m_jobs.erase(it);
+        if (audio) {
+            insert(audio);
+            qDebug() << "Decoded" << path << "in" << timer.elapsed() << "ms";
+        }
+        return audio;
+    });
+    m_jobs.insert(key, job);
+    return job.future;
+}
+
+QString AudioCache::stretchKey(const QString &key, double rate) {
+    return QString("%1@%2").arg(key, QString::number(rate, 'f', 2));
+}
+
+QFuture<DecodedAudioPtr> AudioCache::requestStretched(const DecodedAudioPtr &source, double rate) {
+    if (!source || std::abs(rate - 1.0) < 0.005) return readyFuture(source);
+    const QString key = stretchKey(source->key, rate);
+
+    QMutexLocker locker(&m_mutex);
+    if (DecodedAudioPtr audio = lookup(key)) {
+        m_hits++;
+        return readyFuture(audio);
+    }
+    auto it = m_stretchJobs.find(key);
+    if (it != m_stretchJobs.end()) {
+        m_hits++;
+        return it->future;
+    }
+
+    // 只有当前这首歌的变速版本值得渲染：其他歌排队中的任务直接取消
+    const QString prefix = source->key + '@';
+    for (auto job = m_stretchJobs.begin(); job != m_stretchJobs.end();) {
+        if (job.key().startsWith(prefix)) {
+            ++job;
+        } else {
+            job->cancelled->store(true);
+            job = m_stretchJobs.erase(job);
+        }
+    }
+
+    m_misses++;
+    auto cancelled = std::make_shared<std::atomic_bool>(false);
+    Job job;
+    job.cancelled = cancelled;
+    job.pinned = true;
+    job.future = QtConcurrent::run(&m_stretchPool, [this, key, source, rate, cancelled]() -> DecodedAudioPtr {
+        TRACE_SCOPE("audio.stretch");
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray pcm = TimeStretch::render(source->pcm, source->format, rate, cancelled.get());
+
+        DecodedAudioPtr audio;
+        if (!pcm.isEmpty() && !cancelled->load()) {
+            auto stretched = std::make_shared<DecodedAudio>();
+            stretched->key = key;
+            stretched->path = source->path;
+            stretched->rate = rate;
+            stretched->format = source->format;
+            stretched->durationMs = source->format.durationForBytes(pcm.size()) / 1000;
+            stretched->pcm = std::move(pcm);
+            audio = stretched;
+        }
+
+        QMutexLocker locker(&m_mutex);
+        auto it = m_stretchJobs.find(key);
+        if (it != m_stretchJobs.end() && it->cancelled == cancelled) m_stretchJobs.erase(it);
+        if (audio) {
+            insert(audio);
+            qDebug() << "Stretched" << source->path << "to" << rate << "x in" << timer.elapsed() << "ms";
+        }
+        return audio;
+    });
+    m_stretchJobs.insert(key, job);
+    return job.future;
+}
+
+DecodedAudioPtr AudioCache::peek(const QString &path) {
+    const QString key = keyFor(path);
+    QMutexLocker locker(&m_mutex);
+    return lookup(key);
+}
+
+void AudioCache::cancel(const QString &path) {
+    const QString key = keyFor(path);
+    QMutexLocker locker(&m_mutex);
+    auto it = m_jobs.find(key);
+    if (it == m_jobs.end() || it->pinned) return;
+    it->cancelled->store(true);
+    m_jobs.erase(it);
+}
+
+void AudioCache::setMemoryLimit(qint64 bytes) {
+    QMutexLocker locker(&m_mutex);
+    m_limit = bytes;
+    while (m_bytes > m_limit && !m_entries.isEmpty()) {
+        m_bytes -= m_entries.last()->pcm.size();
+        m_entries.removeLast();
+    }
+}
+
+AudioCache::Stats AudioCache::stats() const {
+    QMutexLocker locker(&m_mutex);
+    Stats s;
+    s.hits = m_hits;
+    s.misses = m_misses;
+    s.bytes = m_bytes;
+    s.entries = int(m_entries.size());
+    s.limit = m_limit;
+    return s;
+}
+
+QString AudioCache::statsText() const {
+    const Stats s = stats();
+    return QString("Audio cache: %1% hit (%2/%3), %4 / %5 MB in %6 songs")
+        .arg(QString::number(s.hitRate() * 100, 'f', 0))
+        .arg(s.hits).arg(s.hits + s.misses)
+        .arg(QString::number(s.bytes / (1024.0 * 1024.0), 'f', 1))
+        .arg(s.limit / (1024 * 1024))
+        .arg(s.entries);
+}
+
+DecodedAudioPtr AudioCache::lookup(const QString &key) {
+    for (qsizetype i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i]->key == key) {
+            m_entries.move(i, 0);
+            return m_entries.first();
+        }
+    }
+    return nullptr;
+}
+
+void AudioCache::insert(const DecodedAudioPtr &audio) {
+    m_entries.prepend(audio);
+    m_bytes += audio->pcm.size();
+    // 至少保留刚解码的这一首
+    while (m_bytes > m_limit && m_entries.size() > 1) {
+        m_bytes -= m_entries.last()->pcm.size();
+        m_entries.removeLast();
+    }
+    TRACE_COUNTER("audioCache.bytes", m_bytes);
+}
@@ -0,0 +1,84 @@
+#ifndef AUDIOCACHE_H
+#define AUDIOCACHE_H
+
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+
+// 解码后的整首歌 (只读，在线程间共享)
+struct DecodedAudio {
+    QString key;          // AudioCache::keyFor(path)，变速版本为 stretchKey(原 key, rate)
+    QString path;
+    double rate = 1.0;    // 变速倍率 (1.0 为原始解码结果)
+    QAudioFormat format;
+    QByteArray pcm;
+    qint64 durationMs = 0;
+};
+using DecodedAudioPtr = std::shared_ptr<const DecodedAudio>;
+
+// 进程内共享的解码音频缓存：按 (路径, 大小, 修改时间) 识别同一个音频文件。
+// 同一谱面集的各个难度共用一份 PCM，切换难度 / 重试都不需要再经过解码器。
+// 按总字节数做 LRU 淘汰；正在播放的数据由 shared_ptr 保持有效，不受淘汰影响。
+class AudioCache {
+public:
+    struct Stats {
+        qint64 hits = 0;    // 不需要新解码的请求 (已缓存或正在解码)
+        qint64 misses = 0;  // 启动了一次新解码
+        qint64 bytes = 0;
+        int entries = 0;
+        qint64 limit = 0;
+        double hitRate() const { return hits + misses == 0 ? 0.0 : double(hits) / (hits + misses); }
+    };
+
+    static AudioCache &instance();
+    static QString keyFor(const QString &path);
+
+    // 已缓存时返回已完成的 future；否则在线程池上解码 (同一文件同时只解码一次)
+    // pin = true 表示有人在等着播放，这次解码不会被 cancel() 取消
+    QFuture<DecodedAudioPtr> request(const QString &path, bool pin = false);
+    // 只查缓存：不计入命中统计，也不触发解码
+    DecodedAudioPtr peek(const QString &path);
+    // 变速版本 (保持音高)：与原始 PCM 一起按 LRU 缓存，同一 (音频, 倍率) 只渲染一次。
+    // 渲染在单独一个最低优先级的线程上排队进行，不占用全局线程池；
+    // 换了另一首歌时，之前那首还没渲染完的变速任务会被取消
+    QFuture<DecodedAudioPtr> requestStretched(const DecodedAudioPtr &source, double rate);
+    static QString stretchKey(const QString &key, double rate);
+    // 取消该文件尚未完成的预读解码 (被 pin 的除外)
+    void cancel(const QString &path);
+
+    void setMemoryLimit(qint64 bytes);
+    Stats stats() const;
+    QString statsText() const;
+
+private:
+    AudioCache();
+    ~AudioCache();
+
+    struct Job {
+        std::shared_ptr<std::atomic_bool> cancelled;
+        bool pinned = false;
+        QFuture<DecodedAudioPtr> future;
+    };
+
+    DecodedAudioPtr lookup(const QString &key); // 调用方已持锁
+    void insert(const DecodedAudioPtr &audio);  // 调用方已持锁
+
+    mutable QMutex m_mutex;
+    QList<DecodedAudioPtr> m_entries; // 最近使用的在最前
+    QHash<QString, Job> m_jobs;       // 正在解码的文件
+    QHash<QString, Job> m_stretchJobs; // 正在渲染的变速版本 (按 stretchKey)
+    QThreadPool m_stretchPool;
+    qint64 m_bytes = 0;
+    qint64 m_limit = 384LL * 1024 * 1024; // 约 12 首 3 分钟的歌
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+};
+
+#endif // AUDIOCACHE_H
@@ -0,0 +1,118 @@
+#include "AudioDecode.h"
+#include "ZipArchive.h"
+#include "Trace.h"
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QBuffer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QUrl>
+
+namespace AudioDecode {
+
+// 检查取消标记的间隔 (ms)
+static const int kCancelPollInterval = 20;
+
+QAudioFormat outputFormat() {
+    QAudioFormat format;
+    format.setSampleRate(44100);
+    format.setChannelCount(2);
+    format.setSampleFormat(QAudioFormat::Int16);
+    return format;
+}
+
+Result decode(const QString &path, qint64 startMs, qint64 maxMs, const std::atomic_bool *cancelled) {
+    TRACE_SCOPE("audio.decode");
+    Result r;
+    r.startMs = startMs;
+
+    // .osz 包内的音频：条目解压到内存，解码器直接从内存读，不写临时文件 (缓冲区要比解码器活得久)
+    QByteArray packed;
+    QBuffer packedDevice(&packed);
+
+    // 解码器和事件循环都属于当前 (工作) 线程，信号在本线程内派发
+    QAudioDecoder decoder;
+    decoder.setAudioFormat(outputFormat());
+    if (ZipArchive::splitPath(path, nullptr, nullptr)) {
+        if (!ZipArchive::readFile(path, packed)) {
+            r.error = "Cannot read archive entry";
+            return r;
+        }
+        packedDevice.open(QIODevice::ReadOnly);
+        decoder.setSourceDevice(&packedDevice);
+    } else {
+        decoder.setSource(QUrl::fromLocalFile(path));
+    }
+
+    QEventLoop loop;
+    bool done = false;
+    auto finish = [&]() {
+        done = true;
+        loop.quit();
+    };
+
+    QObject::connect(&decoder, &QAudioDecoder::durationChanged, &loop, [&](qint64 ms) {
+        if (ms > 0) r.durationMs = ms;
+    });
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&]() {
+        const QAudioBuffer buffer = decoder.read();
+        if (!buffer.isValid() || done) return;
+        if (!r.format.isValid()) r.format = buffer.format();
+
+        const qint64 bufferStart = buffer.startTime() / 1000; // us -> ms
+        const qint64 bufferEnd = bufferStart + buffer.duration() / 1000;
+        if (bufferEnd <= startMs) return; // 还没到起点，直接丢弃
+
+        // 整首解码时按报告的时长一次预留好，避免边解码边扩容
+        if (maxMs <= 0 && r.pcm.isEmpty() && r.durationMs > startMs) {
+            r.pcm.reserve(r.format.bytesForDuration((r.durationMs - startMs) * 1000));
+        }
+
+        const char *data = buffer.constData<char>();
+        qint64 bytes = buffer.byteCount();
+        if (r.pcm.isEmpty()) {
+            if (bufferStart < startMs) {
+                // 起点落在这个缓冲区中间：按帧对齐裁掉前面的部分
+                qint64 skip = r.format.bytesForDuration((startMs - bufferStart) * 1000);
+                skip -= skip % r.format.bytesPerFrame();
+                data += skip;
+                bytes -= skip;
+            } else {
+                r.startMs = bufferStart;
+            }
+        }
+        r.pcm.append(data, bytes);
+
+        if (maxMs > 0) {
+            const qint64 maxBytes = r.format.bytesForDuration(maxMs * 1000);
+            if (r.pcm.size() >= maxBytes) {
+                r.pcm.truncate(maxBytes - maxBytes % r.format.bytesPerFrame());
+                finish();
+            }
+        }
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, finish);
+    QObject::connect(&decoder, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), &loop, [&](QAudioDecoder::Error) {
+        r.error = decoder.errorString();
+        finish();
+    });
+
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, &loop, [&]() {
+        if (cancelled && cancelled->load()) {
+            r.error = "Cancelled";
+            finish();
+        }
+    });
+    poll.start(kCancelPollInterval);
+
+    decoder.start();
+    if (!done) loop.exec();
+    decoder.stop();
+
+    if (r.durationMs < 0 && decoder.duration() > 0) r.durationMs = decoder.duration();
+    r.ok = r.error.isEmpty() && !r.pcm.isEmpty();
+    return r;
+}
+
+}
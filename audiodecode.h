@@ -0,0 +1,31 @@
+#ifndef AUDIODECODE_H
+#define AUDIODECODE_H
+
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+
+// 同步音频解码 (基于 QAudioDecoder + 局部事件循环)，只在工作线程里调用
+// path 可以是 .osz 包内的虚拟路径 (见 ZipArchive)
+namespace AudioDecode {
+
+struct Result {
+    bool ok = false;
+    QAudioFormat format;
+    QByteArray pcm;          // 交错排列的 PCM 帧
+    qint64 startMs = 0;      // pcm 第一帧对应的歌曲时间
+    qint64 durationMs = -1;  // 整首歌的时长 (解码器报告，未知时为 -1)
+    QString error;
+};
+
+// 请求的输出格式：44.1kHz 立体声 16 位，多段 PCM 可以共用同一个输出设备
+QAudioFormat outputFormat();
+
+// 跳过 startMs 之前的部分，最多输出 maxMs (<= 0 表示解码到结尾)
+// cancelled 被置位时尽快返回 (ok = false)
+Result decode(const QString &path, qint64 startMs, qint64 maxMs, const std::atomic_bool *cancelled = nullptr);
+
+}
+
+#endif // AUDIODECODE_H
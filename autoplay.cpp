@@ -0,0 +1,81 @@
+#include "Autoplay.h"
+#include <algorithm>
+
+namespace Autoplay {
+
+// 单点按下后保持的时间 (只影响按键的显示，不影响判定)
+static constexpr int kTapHoldMs = 40;
+
+std::vector<AutoplayInput> generate(const std::vector<Note> &notes, int keyCount) {
+    const int keys = std::clamp(keyCount, 1, BeatmapInfo::kMaxKeys);
+
+    // 同列下一个物件的开始时间：单点最多按到它为止
+    std::vector<int> nextInLane(notes.size(), -1);
+    std::vector<int> last(size_t(keys), -1);
+    for (int i = int(notes.size()) - 1; i >= 0; --i) {
+        const int c = std::clamp(notes[i].column, 0, keys - 1);
+        nextInLane[i] = last[c];
+        last[c] = i;
+    }
+
+    // 排序键：同一时刻 0 = 松开之前按下的物件，1 = 按下，2 = 松开同一时刻按下的物件 (零长度)
+    struct Keyed {
+        AutoplayInput input;
+        int rank;
+    };
+    std::vector<Keyed> keyed;
+    keyed.reserve(notes.size() * 2);
+    for (size_t i = 0; i < notes.size(); ++i) {
+        const Note &note = notes[i];
+        const int c = std::clamp(note.column, 0, keys - 1);
+        qint64 up;
+        if (note.isHold) {
+            up = std::max(note.endTime, note.time);
+        } else {
+            up = note.time + kTapHoldMs;
+            if (nextInLane[i] >= 0) up = std::min<qint64>(up, notes[nextInLane[i]].time);
+            up = std::max<qint64>(up, note.time);
+        }
+        keyed.push_back({{note.time, c, true}, 1});
+        keyed.push_back({{up, c, false}, up > note.time ? 0 : 2});
+    }
+    std::stable_sort(keyed.begin(), keyed.end(), [](const Keyed &a, const Keyed &b) {
+        if (a.input.time != b.input.time) return a.input.time < b.input.time;
+        return a.rank < b.rank;
+    });
+
+    std::vector<AutoplayInput> inputs;
+    inputs.reserve(keyed.size());
+    for (const Keyed &k : keyed) inputs.push_back(k.input);
+    return inputs;
+}
+
+AutoplayResult run(const std::vector<Note> &notes, int keyCount, const JudgmentWindow &window) {
+    std::unique_ptr<JudgeEngine> engine = JudgeEngine::create(keyCount);
+    engine->setWindow(window);
+    engine->load(notes);
+
+    AutoplayResult result;
+    auto check = [&](qint64 time, Judgment j) {
+        if (j != Judgment::Perfect && result.firstFlawMs < 0) {
+            result.firstFlawMs = time;
+            result.firstFlaw = j;
+        }
+    };
+
+    const std::vector<AutoplayInput> inputs = generate(notes, engine->keyCount());
+    size_t cursor = 0;
+    feed(*engine, inputs, &cursor, std::numeric_limits<qint64>::max(), check);
+
+    // 最后一个输入之后还没结算的 (按过头的长条 / 没被按到的物件) 全部扫掉
+    qint64 end = 0;
+    for (const Note &note : engine->notes()) end = std::max<qint64>(end, note.endTime);
+    const Judgment j = engine->sweep(end + window.miss * 4 + 1);
+    if (j != Judgment::None) check(end, j);
+
+    result.score = engine->score();
+    result.judgments = engine->totalJudgments();
+    return result;
+}
+
+}
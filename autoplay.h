@@ -0,0 +1,54 @@
+#ifndef AUTOPLAY_H
+#define AUTOPLAY_H
+
+#include <QtGlobal>
+#include <vector>
+#include "JudgeEngine.h"
+
+// 一次按键输入 (谱面时间)
+struct AutoplayInput {
+    qint64 time;
+    int column;
+    bool press;
+};
+
+// 一次自动游玩的结果
+struct AutoplayResult {
+    ScoreState score;
+    int judgments = 0;        // 谱面的判定总数
+    qint64 firstFlawMs = -1;  // 第一个不是 Perfect 的判定所在时间 (-1 表示全部 Perfect)
+    Judgment firstFlaw = Judgment::None;
+
+    bool isMaxScore() const { return judgments == 0 || (score.countPerfect == judgments && score.score == 1000000); }
+};
+
+// 自动游玩：在每个物件的准确时间生成按下 / 松开，走和真人一样的 JudgeEngine 判定路径。
+// 界面上作为渲染压力测试；无头模式下不需要音频，全速跑完整个谱面，理论上任何合法谱面都应满分，
+// 达不到满分说明解析、谱面本身 (同列重叠等) 或判定逻辑有问题。
+namespace Autoplay {
+
+// notes 需按时间排序 (和 JudgeEngine::load 的要求一致)。
+// 同一时刻先松开到期的长条，再按下，最后松开单点，保证同列首尾相接的物件都能判到
+std::vector<AutoplayInput> generate(const std::vector<Note> &notes, int keyCount);
+
+// 把 inputs 中 time <= untilMs 的部分依次送进引擎 (从 *cursor 开始，结束后 cursor 指向下一个未处理的输入)，
+// 每个输入之前先 sweep 到它的时间；onJudgment(time, judgment) 在每个判定产生时调用
+template <typename Fn>
+void feed(JudgeEngine &engine, const std::vector<AutoplayInput> &inputs, size_t *cursor, qint64 untilMs, Fn &&onJudgment) {
+    size_t i = *cursor;
+    for (; i < inputs.size() && inputs[i].time <= untilMs; ++i) {
+        const AutoplayInput &in = inputs[i];
+        Judgment j = engine.sweep(in.time);
+        if (j != Judgment::None) onJudgment(in.time, j);
+        j = in.press ? engine.press(in.column, in.time) : engine.release(in.column, in.time);
+        if (j != Judgment::None) onJudgment(in.time, j);
+    }
+    *cursor = i;
+}
+
+// 无头运行整个谱面 (不需要音频，不做任何等待)
+AutoplayResult run(const std::vector<Note> &notes, int keyCount, const JudgmentWindow &window);
+
+}
+
+#endif // AUTOPLAY_H
@@ -0,0 +1,348 @@
+#include "BeatmapLibrary.h"
+#include "LibraryCache.h"
+#include "OsuParser.h"
+#include "ContentHash.h"
+#include "RecordStore.h"
+#include "RecordWriter.h"
+#include "ChartAnalysis.h"
+#include "ZipArchive.h"
+#include "Trace.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSet>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+namespace {
+// 缓存未命中、需要完整分析的文件
+struct PendingFile {
+    QString path;
+    qint64 size = 0;
+    qint64 mtime = 0;
+    QString folderName;
+};
+
+// 谱面文件的大小 / 修改时间 (决定搜索文档要不要重建)
+struct FileStamp {
+    qint64 size = 0;
+    qint64 mtime = 0;
+};
+}
+
+// 读取一个 .osu (也可以在 .osz 包内)：整个文件读一次，计算内容哈希、解析头部和物件、统计难度 (在线程池中执行)
+static BeatmapInfo analyzeFile(const PendingFile &pending) {
+    TRACE_SCOPE("library.analyzeFile");
+    BeatmapInfo info;
+    QByteArray bytes;
+    if (!ZipArchive::readFile(pending.path, bytes)) return info;
+
+    info.filePath = pending.path;
+    info.contentHash = ContentHash::xxh64(bytes.constData(), bytes.size());
+    OsuParser::parseHeader(bytes, info);
+
+    std::vector<Note> notes;
+    OsuParser::parseHitObjects(bytes, info.keyCount, notes);
+    info.metrics = ChartAnalysis::compute(notes, info.keyCount);
+    return info;
+}
+
+static qint64 stringBytes(const QString &s) {
+    return s.isEmpty() ? 0 : StringPool::kArrayHeaderBytes + qint64(s.capacity()) * qint64(sizeof(QChar));
+}
+
+// 一个难度单独存成 BeatmapInfo 时的大小 (每个难度的字符串各自分配)
+static qint64 unpackedBytes(const BeatmapInfo &info) {
+    return qint64(sizeof(BeatmapInfo)) + stringBytes(info.filePath) + stringBytes(info.title)
+           + stringBytes(info.artist) + stringBytes(info.titleRomanised) + stringBytes(info.artistRomanised)
+           + stringBytes(info.version) + stringBytes(info.audioFilename);
+}
+
+BeatmapLibrary &BeatmapLibrary::instance() {
+    static BeatmapLibrary library;
+    return library;
+}
+
+void BeatmapLibrary::scan(const QString &folder) {
+    TRACE_SCOPE("library.scan");
+    QElapsedTimer timer;
+    timer.start();
+
+    // 换了根目录时搜索索引整个重建，同一目录重新扫描时只增量更新
+    if (folder != m_root) {
+        m_search.clear();
+        m_documents.clear();
+        m_freeDocuments.clear();
+        m_nextDocument = 0;
+    }
+    m_root = folder;
+    m_rootPrefix = QDir::cleanPath(folder) + '/';
+    m_generation++;
+    m_strings.clear();
+    m_memory = LibraryMemory();
+    m_maps.clear();
+    m_folders.clear();
+    m_folderOfMap.clear();
+
+    // 库缓存：文件大小和修改时间没变的谱面不需要再读取/哈希/分析
+    LibraryCache cache;
+    cache.load();
+    QSet<QString> seenPaths;
+
+    // 先收集 (文件夹名, 谱面)，最后统一排序成连续表
+    std::vector<BeatmapInfo> maps;
+    std::vector<QString> folderNames;
+    std::vector<FileStamp> stamps;
+    QList<PendingFile> pending;
+
+    auto addFile = [&](const QString &path, qint64 size, qint64 mtime, const QString &folderName) {
+        seenPaths.insert(path);
+        BeatmapInfo info;
+        if (cache.lookup(path, size, mtime, info)) {
+            folderNames.push_back(folderName);
+            stamps.push_back({size, mtime});
+            maps.push_back(std::move(info));
+        } else {
+            pending.append({path, size, mtime, folderName});
+        }
+    };
+
+    QDirIterator it(folder, QStringList() << "*.osu" << "*.osz", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString path = it.next();
+        QFileInfo fileInfo = it.fileInfo();
+        qint64 size = fileInfo.size();
+        qint64 mtime = fileInfo.lastModified().toMSecsSinceEpoch();
+
+        if (ZipArchive::isArchiveName(path)) {
+            // 谱面包不解压：读中央目录，包内每个 .osu 用虚拟路径 "<包>/<条目>" 索引，
+            // 文件夹名取包名 (与 osu! 解压后的文件夹同名)；包的修改时间变了，里面的谱面都重新分析
+            QString error;
+            ZipIndexPtr index = ZipArchive::index(path, &error);
+            if (!index) {
+                qDebug() << "Skipping archive" << path << ":" << error;
+                continue;
+            }
+            const QString folderName = fileInfo.completeBaseName();
+            for (const ZipEntry &entry : index->entries) {
+                if (!entry.name.endsWith(QLatin1String(".osu"), Qt::CaseInsensitive)) continue;
+                addFile(ZipArchive::joinPath(path, entry.name), entry.size, mtime, folderName);
+            }
+            continue;
+        }
+
+        // 使用父文件夹名称作为分组 Key
+        addFile(path, size, mtime, fileInfo.dir().dirName());
+    }
+
+    // 未命中的文件在全局线程池上并行分析，结果按 pending 的顺序返回
+    if (!pending.isEmpty()) {
+        QElapsedTimer analyzeTimer;
+        analyzeTimer.start();
+        const QList<BeatmapInfo> analyzed = QtConcurrent::blockingMapped<QList<BeatmapInfo>>(pending, analyzeFile);
+        for (qsizetype i = 0; i < pending.size(); ++i) {
+            const PendingFile &p = pending[i];
+            if (analyzed[i].filePath.isEmpty()) continue; // 读取失败，下次扫描再试
+            cache.insert(p.path, p.size, p.mtime, analyzed[i]);
+            folderNames.push_back(p.folderName);
+            stamps.push_back({p.size, p.mtime});
+            maps.push_back(analyzed[i]);
+        }
+        qDebug() << "Analyzed" << pending.size() << "changed beatmaps in" << analyzeTimer.elapsed() << "ms";
+    }
+
+    // 旧版成绩 (按 Artist + Title + Version 的 md5 命名) 迁移到内容哈希：交给成绩写入线程，
+    // 和新成绩的写入排在同一个队列里。同名的谱面有好几个不同内容时猜不出旧成绩属于哪一个，不迁移
+    RecordStore &store = RecordStore::instance();
+    if (store.hasLegacyRecords()) {
+        QHash<QString, QString> keyOfLegacy;
+        QSet<QString> ambiguous;
+        for (const BeatmapInfo &info : maps) {
+            if (info.title.isEmpty()) continue;
+            const QString legacy = info.legacyHash();
+            if (!store.hasSummary(RecordStore::legacyKey(legacy))) continue;
+            const QString key = info.getHash();
+            auto it = keyOfLegacy.constFind(legacy);
+            if (it == keyOfLegacy.cend()) keyOfLegacy.insert(legacy, key);
+            else if (it.value() != key) ambiguous.insert(legacy);
+        }
+        QList<RecordWriter::LegacyMigration> migrations;
+        for (auto it = keyOfLegacy.cbegin(); it != keyOfLegacy.cend(); ++it) {
+            if (ambiguous.contains(it.key())) {
+                qDebug() << "Skipping legacy record migration for" << it.key() << ": shared by several beatmaps";
+                continue;
+            }
+            migrations.append({it.key(), it.value()});
+        }
+        RecordWriter::instance().enqueueMigrations(migrations);
+    }
+
+    // 只保留本次扫描到的文件，有变化才写回
+    cache.retainOnly(folder, seenPaths);
+    if (cache.isDirty()) cache.save();
+
+    // 按 (文件夹名, 难度名) 排序下标，再按顺序压缩进连续表
+    std::vector<int> order;
+    order.reserve(maps.size());
+    for (size_t i = 0; i < maps.size(); ++i) {
+        if (!maps[i].title.isEmpty()) order.push_back(int(i));
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        int c = QString::compare(folderNames[a], folderNames[b]);
+        if (c != 0) return c < 0;
+        return maps[a].version < maps[b].version;
+    });
+
+    m_maps.reserve(order.size());
+    m_folderOfMap.reserve(order.size());
+    QHash<QString, SearchDocument> documents;
+    documents.reserve(qsizetype(order.size()));
+    std::vector<int> docOfMap;
+    docOfMap.reserve(order.size());
+    int reindexed = 0;
+    for (int idx : order) {
+        const QString &name = folderNames[idx];
+        if (m_folders.empty() || m_folders.back().name != name) {
+            // 文件夹名也进池，FolderGroup 持有的是同一份字符数据
+            m_folders.push_back({m_strings.at(m_strings.intern(name)), int(m_maps.size()), 0});
+        }
+        m_folders.back().count++;
+        m_folders.back().maxStars = std::max(m_folders.back().maxStars, maps[idx].metrics.stars);
+        m_folderOfMap.push_back(int(m_folders.size()) - 1);
+        m_memory.unpackedBytes += unpackedBytes(maps[idx]);
+
+        // 搜索文档：大小和修改时间都没变的沿用原来的 (不重新拆三元组)，其余的新建或覆盖
+        const BeatmapInfo &info = maps[idx];
+        const FileStamp &stamp = stamps[idx];
+        SearchDocument doc = m_documents.take(info.filePath);
+        if (doc.id < 0 || doc.size != stamp.size || doc.mtime != stamp.mtime) {
+            if (doc.id < 0) {
+                if (!m_freeDocuments.empty()) {
+                    doc.id = m_freeDocuments.back();
+                    m_freeDocuments.pop_back();
+                } else {
+                    doc.id = m_nextDocument++;
+                }
+            }
+            doc.size = stamp.size;
+            doc.mtime = stamp.mtime;
+            m_search.addDocument(doc.id, QStringList() << info.title << info.titleRomanised << info.artist
+                                 << info.artistRomanised << info.version << name);
+            reindexed++;
+        }
+        documents.insert(info.filePath, doc);
+        docOfMap.push_back(doc.id);
+
+        m_maps.push_back(pack(info));
+    }
+    maps.clear();
+    maps.shrink_to_fit();
+
+    // 剩下的是这次没扫到 (删除 / 读取失败) 的谱面：从索引里去掉，id 留给以后的新谱面
+    for (const SearchDocument &doc : std::as_const(m_documents)) {
+        m_search.removeDocument(doc.id);
+        m_freeDocuments.push_back(doc.id);
+    }
+    m_documents.swap(documents);
+    m_mapOfDocument.assign(size_t(m_nextDocument), -1);
+    for (size_t i = 0; i < docOfMap.size(); ++i) m_mapOfDocument[docOfMap[i]] = int(i);
+    qDebug() << "Search index:" << reindexed << "documents updated," << m_freeDocuments.size() << "free ids";
+
+    // 之后不再驻留新字符串：释放去重用的哈希表
+    m_strings.squeeze();
+    m_memory.beatmaps = int(m_maps.size());
+    m_memory.strings = m_strings.size();
+    m_memory.poolBytes = m_strings.memoryBytes();
+    m_memory.recordBytes = qint64(m_maps.capacity() * sizeof(PackedBeatmap))
+                           + qint64(m_folders.capacity() * sizeof(FolderGroup))
+                           + qint64(m_folderOfMap.capacity() * sizeof(int));
+
+    refreshSummaries();
+    TRACE_COUNTER("library.beatmaps", m_maps.size());
+
+    qDebug() << "Library scanned:" << m_maps.size() << "beatmaps in" << m_folders.size()
+             << "folders," << timer.elapsed() << "ms";
+    qDebug() << memoryText();
+}
+
+PackedBeatmap BeatmapLibrary::pack(const BeatmapInfo &info) {
+    PackedBeatmap p;
+    p.title = m_strings.intern(info.title);
+    p.artist = m_strings.intern(info.artist);
+    p.titleRomanised = m_strings.intern(info.titleRomanised);
+    p.artistRomanised = m_strings.intern(info.artistRomanised);
+    p.version = m_strings.intern(info.version);
+    p.audioFilename = m_strings.intern(info.audioFilename);
+
+    // 扫描到的文件都在根目录下：只存相对部分，同一文件夹的难度共用一个文件夹字符串
+    QString relative = QDir::cleanPath(info.filePath);
+    if (relative.startsWith(m_rootPrefix)) relative = relative.mid(m_rootPrefix.size());
+    const qsizetype slash = relative.lastIndexOf('/');
+    p.dir = m_strings.intern(slash < 0 ? QString() : relative.left(slash));
+    p.fileName = m_strings.intern(relative.mid(slash + 1));
+
+    p.previewTime = info.previewTime;
+    p.keyCount = info.keyCount;
+    p.contentHash = info.contentHash;
+    p.metrics = info.metrics;
+    return p;
+}
+
+BeatmapInfo BeatmapLibrary::beatmap(int id) const {
+    const PackedBeatmap &p = m_maps[id];
+    BeatmapInfo info;
+    info.filePath = filePath(id);
+    info.title = m_strings.at(p.title);
+    info.artist = m_strings.at(p.artist);
+    info.titleRomanised = m_strings.at(p.titleRomanised);
+    info.artistRomanised = m_strings.at(p.artistRomanised);
+    info.version = m_strings.at(p.version);
+    info.audioFilename = m_strings.at(p.audioFilename);
+    info.previewTime = p.previewTime;
+    info.keyCount = p.keyCount;
+    info.contentHash = p.contentHash;
+    info.metrics = p.metrics;
+    return info;
+}
+
+QString BeatmapLibrary::filePath(int id) const {
+    const PackedBeatmap &p = m_maps[id];
+    const QString &dir = m_strings.at(p.dir);
+    const QString &file = m_strings.at(p.fileName);
+    if (dir.isEmpty()) return m_rootPrefix + file;
+    if (QDir::isAbsolutePath(dir)) return dir + '/' + file; // 不在根目录下的文件 (保留原路径)
+    return m_rootPrefix + dir + '/' + file;
+}
+
+QString BeatmapLibrary::memoryText() const {
+    const LibraryMemory &m = m_memory;
+    auto mb = [](qint64 bytes) { return QString::number(bytes / (1024.0 * 1024.0), 'f', 1); };
+    return QString("Library memory: %1 MB for %2 beatmaps (%3 unique strings, pool %4 MB), unpacked ~%5 MB")
+        .arg(mb(m.totalBytes())).arg(m.beatmaps).arg(m.strings).arg(mb(m.poolBytes)).arg(mb(m.unpackedBytes));
+}
+
+void BeatmapLibrary::refreshSummaries() {
+    RecordStore &store = RecordStore::instance();
+
+    m_mapSummaries.assign(m_maps.size(), RecordSummary());
+    m_folderSummaries.assign(m_folders.size(), RecordSummary());
+
+    for (size_t i = 0; i < m_maps.size(); ++i) {
+        const QString key = recordKey(int(i));
+        if (!store.hasSummary(key)) continue;
+        const RecordSummary s = store.summary(key);
+        m_mapSummaries[i] = s;
+
+        // 汇总到文件夹
+        RecordSummary &f = m_folderSummaries[m_folderOfMap[i]];
+        if (f.playCount == 0 || s.bestScore > f.bestScore) {
+            f.bestScore = s.bestScore;
+            f.bestGrade = s.bestGrade;
+        }
+        f.bestAcc = std::max(f.bestAcc, s.bestAcc);
+        if (!f.lastPlayed.isValid() || s.lastPlayed > f.lastPlayed) f.lastPlayed = s.lastPlayed;
+        f.playCount += s.playCount;
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef BEATMAPLIBRARY_H
+#define BEATMAPLIBRARY_H
+
+#include <QHash>
+#include <QString>
+#include <vector>
+#include "Structs.h"
+#include "SearchIndex.h"
+#include "StringPool.h"
+
+// 一个谱面文件夹在扁平表中的范围 [first, first + count)
+struct FolderGroup {
+    QString name;
+    int first = 0;
+    int count = 0;
+    float maxStars = 0; // 文件夹内最难的难度，用于按难度排序
+};
+
+// 一个难度在库中的紧凑记录：字符串都是 StringPool 下标 (同一谱面集的标题 / 艺术家只存一份)，
+// 路径拆成相对扫描根目录的文件夹 + 文件名
+struct PackedBeatmap {
+    StringPool::Id title = 0;
+    StringPool::Id artist = 0;
+    StringPool::Id titleRomanised = 0;
+    StringPool::Id artistRomanised = 0;
+    StringPool::Id version = 0;
+    StringPool::Id audioFilename = 0;
+    StringPool::Id dir = 0;      // 相对根目录的文件夹 (空串表示就在根目录下)
+    StringPool::Id fileName = 0;
+    qint32 previewTime = -1;
+    qint32 keyCount = 4;
+    quint64 contentHash = 0;
+    ChartMetrics metrics; // 定长 (每列数据也是定长数组)，记录本身不带堆分配
+};
+
+// 谱面库的内存占用 (扫描后统计一次)
+struct LibraryMemory {
+    int beatmaps = 0;
+    int strings = 0;          // 驻留池中的不同字符串数
+    qint64 poolBytes = 0;     // 驻留池
+    qint64 recordBytes = 0;   // 紧凑记录 + 文件夹表
+    qint64 unpackedBytes = 0; // 同样的数据按每个难度一份 BeatmapInfo 存放时的估算
+    qint64 totalBytes() const { return poolBytes + recordBytes; }
+};
+
+// 谱面库：所有难度存放在一张按 (文件夹名, 难度名) 排序的连续表里，
+// 同一文件夹的难度相邻，文件夹只记录下标范围。界面层只通过下标访问，不复制数据。
+// 每个难度只存一条 PackedBeatmap，字符串在驻留池里去重，按下标取字段都是 O(1)。
+// 进程内共享一份，重新打开选歌界面时不需要重新扫描。
+class BeatmapLibrary {
+public:
+    static BeatmapLibrary &instance();
+
+    // 扫描目录 (使用 LibraryCache，未变化的文件不会重新读取；变化的文件在线程池上并行分析)
+    void scan(const QString &folder);
+    QString rootFolder() const { return m_root; }
+    bool isEmpty() const { return m_maps.empty(); }
+
+    int beatmapCount() const { return int(m_maps.size()); }
+    int folderCount() const { return int(m_folders.size()); }
+    // 还原成完整的 BeatmapInfo (字符串与驻留池隐式共享，只有 filePath 需要拼接)
+    BeatmapInfo beatmap(int id) const;
+    // 列表显示用的字段：直接返回池中的字符串，不构造 BeatmapInfo
+    const QString &title(int id) const { return m_strings.at(m_maps[id].title); }
+    const QString &version(int id) const { return m_strings.at(m_maps[id].version); }
+    const ChartMetrics &metrics(int id) const { return m_maps[id].metrics; }
+    QString filePath(int id) const;
+    QString recordKey(int id) const { return BeatmapInfo::hashToKey(m_maps[id].contentHash); }
+    const FolderGroup &folder(int index) const { return m_folders[index]; }
+    int folderOf(int id) const { return m_folderOfMap[id]; }
+
+    // 成绩摘要：按谱面下标 / 文件夹下标缓存，refreshSummaries() 后生效
+    const RecordSummary &mapSummary(int id) const { return m_mapSummaries[id]; }
+    const RecordSummary &folderSummary(int index) const { return m_folderSummaries[index]; }
+    void refreshSummaries();
+
+    // 搜索索引；查询可在任意线程进行。文档 id 按文件路径固定分配 (重新扫描时只更新变化的谱面)，
+    // 查询结果用 mapOfDocument() 换成当前表里的谱面下标
+    const SearchIndex &searchIndex() const { return m_search; }
+    int mapOfDocument(int document) const { return m_mapOfDocument[document]; }
+    // 每次重新扫描递增，用于丢弃针对旧表的异步结果
+    int generation() const { return m_generation; }
+
+    const LibraryMemory &memoryUsage() const { return m_memory; }
+    QString memoryText() const;
+
+private:
+    BeatmapLibrary() = default;
+
+    PackedBeatmap pack(const BeatmapInfo &info);
+
+    QString m_root;
+    QString m_rootPrefix; // m_root + '/'
+    StringPool m_strings;
+    std::vector<PackedBeatmap> m_maps;
+    std::vector<FolderGroup> m_folders;
+    std::vector<int> m_folderOfMap;
+    std::vector<RecordSummary> m_mapSummaries;
+    std::vector<RecordSummary> m_folderSummaries;
+
+    // 每个已建索引的谱面文件：文档 id + 建索引时的大小 / 修改时间
+    struct SearchDocument {
+        int id = -1;
+        qint64 size = 0;
+        qint64 mtime = 0;
+    };
+
+    SearchIndex m_search;
+    QHash<QString, SearchDocument> m_documents; // 文件路径 -> 文档
+    std::vector<int> m_mapOfDocument;           // 文档 id -> 谱面下标 (-1 表示已删除)
+    std::vector<int> m_freeDocuments;           // 已删除文档的 id，新谱面优先复用
+    int m_nextDocument = 0;
+    int m_generation = 0;
+    LibraryMemory m_memory;
+};
+
+#endif // BEATMAPLIBRARY_H
@@ -0,0 +1,264 @@
+// 热点路径微基准：解析 / 扫描头部 / 判定查找 / Miss 扫描 / 成绩 JSON 读写和排序。
+// 谱面由固定种子合成 (1k ~ 1M 物件)，每项重复多次取中位数，结果按行输出 JSON 或 CSV，
+// 方便逐个提交对比、观察各路径随规模的变化。
+//
+//   osu_bench [--max-notes N] [--reps N] [--filter text] [--format json|csv]
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <vector>
+#include "ChartGenerator.h"
+#include "HitErrors.h"
+#include "JudgeEngine.h"
+#include "OsuParser.h"
+
+namespace {
+
+struct BenchOptions {
+    qint64 maxNotes = 1000000;
+    int reps = 5;
+    QString filter;
+    bool csv = false;
+};
+
+struct BenchResult {
+    QString name;
+    qint64 n = 0;      // 规模 (物件数 / 记录数)
+    qint64 items = 0;  // 每次运行处理的单位数 (用于 ns/item)
+    int reps = 0;
+    qint64 minNs = 0;
+    qint64 medianNs = 0;
+};
+
+// 合成 .osu：固定种子，约 30% 长条、10% 双押，行间隔 150ms
+QByteArray makeChart(int noteCount, int keyCount) {
+    ChartGenerator::Params params;
+    params.keyCount = keyCount;
+    params.bpm = 100;
+    params.snap = 4;
+    params.maxNotes = noteCount;
+    params.holdRatio = 0.3;
+    params.chordRatio = 0.1;
+    params.chordSize = 2;
+    params.title = "Benchmark";
+    return ChartGenerator::generate(params).osu;
+}
+
+// 一条和 GameWidget::saveRecord 结构相同的成绩
+QJsonObject makeRecord(std::mt19937 &rng, int hitCount) {
+    std::uniform_int_distribution<int> scoreDist(500000, 1000000);
+    std::normal_distribution<double> errDist(0.0, 25.0);
+    QJsonObject r;
+    const int score = scoreDist(rng);
+    r["hash"] = "0123456789abcdef";
+    r["score"] = score;
+    r["acc"] = score / 10000.0;
+    r["combo"] = hitCount / 2;
+    r["grade"] = score >= 970000 ? "S" : score >= 900000 ? "A" : "B";
+    r["perfect"] = hitCount / 2;
+    r["great"] = hitCount / 4;
+    r["good"] = hitCount / 8;
+    r["miss"] = hitCount / 8;
+    r["keys"] = 4;
+    r["date"] = QDateTime::fromMSecsSinceEpoch(1700000000000LL + rng() % 100000000).toString(Qt::ISODate);
+    std::vector<qint16> errors(hitCount);
+    for (qint16 &e : errors) e = qint16(std::clamp(errDist(rng), -150.0, 150.0));
+    HitErrors::writeToRecord(errors, r);
+    return r;
+}
+
+class Runner {
+public:
+    explicit Runner(const BenchOptions &options) : m_options(options), m_out(stdout) {
+        if (m_options.csv) m_out << "bench,n,items,reps,min_ns,median_ns,ns_per_item\n";
+    }
+
+    bool enabled(const QString &name) const {
+        return m_options.filter.isEmpty() || name.contains(m_options.filter);
+    }
+
+    // setup 不计时 (每次重复前调用)，body 计时
+    void run(const QString &name, qint64 n, qint64 items,
+             const std::function<void()> &setup, const std::function<void()> &body) {
+        if (!enabled(name)) return;
+        std::vector<qint64> samples;
+        // 先跑一次热身 (缓存 / 分配器 / 页面)
+        for (int rep = 0; rep <= m_options.reps; ++rep) {
+            if (setup) setup();
+            QElapsedTimer t;
+            t.start();
+            body();
+            const qint64 ns = t.nsecsElapsed();
+            if (rep > 0) samples.push_back(ns);
+        }
+        std::sort(samples.begin(), samples.end());
+        BenchResult r{name, n, items, int(samples.size()), samples.front(), samples[samples.size() / 2]};
+        print(r);
+    }
+
+private:
+    void print(const BenchResult &r) {
+        const double perItem = r.items > 0 ? double(r.medianNs) / r.items : 0.0;
+        if (m_options.csv) {
+            m_out << r.name << "," << r.n << "," << r.items << "," << r.reps << ","
+                  << r.minNs << "," << r.medianNs << "," << QString::number(perItem, 'f', 2) << "\n";
+        } else {
+            QJsonObject o;
+            o["bench"] = r.name;
+            o["n"] = r.n;
+            o["items"] = r.items;
+            o["reps"] = r.reps;
+            o["min_ns"] = r.minNs;
+            o["median_ns"] = r.medianNs;
+            o["ns_per_item"] = perItem;
+            m_out << QJsonDocument(o).toJson(QJsonDocument::Compact) << "\n";
+        }
+        m_out.flush();
+    }
+
+    BenchOptions m_options;
+    QTextStream m_out;
+};
+
+// 防止结果被优化掉
+volatile qint64 g_sink = 0;
+
+void benchChart(Runner &runner, int noteCount) {
+    const int keyCount = 7;
+    const QByteArray bytes = makeChart(noteCount, keyCount);
+
+    runner.run("parse.hitobjects", noteCount, noteCount, nullptr, [&] {
+        std::vector<Note> notes;
+        OsuParser::parseHitObjects(bytes, keyCount, notes);
+        g_sink = g_sink + qint64(notes.size());
+    });
+
+    // 与选歌扫描相同：只读头部，遇到 [Events] 就停
+    runner.run("parse.header", noteCount, 1, nullptr, [&] {
+        BeatmapInfo info;
+        OsuParser::parseHeader(bytes, info);
+        g_sink = g_sink + info.keyCount;
+    });
+
+    std::vector<Note> notes;
+    OsuParser::parseHitObjects(bytes, keyCount, notes);
+    std::unique_ptr<JudgeEngine> engine = JudgeEngine::create(keyCount);
+    engine->load(notes);
+
+    // 按键查找：每个物件在自己的时间按下，长条在结束时松开 (打满 Perfect)
+    struct Event { int time; int column; bool press; };
+    std::vector<Event> events;
+    events.reserve(notes.size() * 2);
+    for (const Note &note : notes) {
+        events.push_back({note.time, note.column, true});
+        events.push_back({note.isHold ? note.endTime : note.time + 1, note.column, false});
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.time < b.time; });
+
+    runner.run("judge.press_release", noteCount, qint64(events.size()), [&] { engine->reset(); }, [&] {
+        for (const Event &e : events) {
+            if (e.press) engine->press(e.column, e.time);
+            else engine->release(e.column, e.time);
+        }
+        g_sink = g_sink + engine->score().score;
+    });
+
+    // 立即重开：只重置物件状态和统计 (GameWidget::retry 的主要 CPU 开销)
+    runner.run("judge.reset", noteCount, noteCount, nullptr, [&] {
+        engine->reset();
+        g_sink = g_sink + engine->score().score;
+    });
+
+    // Miss 扫描：没有任何输入，按 4ms 一帧推进到结尾 (每个物件都在扫描中判 Miss)
+    const int endTime = notes.empty() ? 0 : notes.back().endTime + 1000;
+    const qint64 frames = endTime / 4 + 1;
+    runner.run("judge.sweep", noteCount, frames, [&] { engine->reset(); }, [&] {
+        for (int t = 0; t <= endTime; t += 4) engine->sweep(t);
+        g_sink = g_sink + engine->score().countMiss;
+    });
+}
+
+void benchRecords(Runner &runner, int recordCount, const QString &dir) {
+    std::mt19937 rng(777);
+    QJsonArray history;
+    for (int i = 0; i < recordCount; ++i) history.append(makeRecord(rng, 1000));
+    const QString path = dir + QString("/history_%1.json").arg(recordCount);
+
+    // 与 RecordWriter 相同：整个数组写回 (QSaveFile 原子替换)
+    runner.run("record.save", recordCount, recordCount, nullptr, [&] {
+        QSaveFile f(path);
+        if (!f.open(QIODevice::WriteOnly)) return;
+        f.write(QJsonDocument(history).toJson(QJsonDocument::Compact));
+        f.commit();
+    });
+
+    // 与 SongSelectWindow::loadHistory 相同：读取、解析、取出日期
+    struct RecordData { QJsonObject json; QDateTime date; };
+    QList<RecordData> records;
+    runner.run("record.load", recordCount, recordCount, nullptr, [&] {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly)) return;
+        const QJsonArray arr = QJsonDocument::fromJson(f.readAll()).array();
+        records.clear();
+        records.reserve(arr.size());
+        for (const auto &val : arr) {
+            RecordData r;
+            r.json = val.toObject();
+            r.date = QDateTime::fromString(r.json["date"].toString(), Qt::ISODate);
+            records.append(r);
+        }
+        g_sink = g_sink + records.size();
+    });
+
+    const QList<RecordData> loaded = records;
+    runner.run("history.sort", recordCount, recordCount, [&] { records = loaded; }, [&] {
+        std::sort(records.begin(), records.end(), [](const RecordData &a, const RecordData &b) {
+            return a.json["score"].toInt() > b.json["score"].toInt();
+        });
+        g_sink = g_sink + records.size();
+    });
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("osu_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Microbenchmarks for parser, judgment and record hot paths.");
+    parser.addHelpOption();
+    QCommandLineOption maxOption("max-notes", "Largest synthetic chart (default 1000000).", "n");
+    QCommandLineOption repsOption("reps", "Timed repetitions per benchmark (default 5).", "n");
+    QCommandLineOption filterOption("filter", "Only run benchmarks whose name contains this text.", "text");
+    QCommandLineOption formatOption("format", "Output format: json (one object per line) or csv.", "fmt", "json");
+    parser.addOptions({maxOption, repsOption, filterOption, formatOption});
+    parser.process(app);
+
+    BenchOptions options;
+    if (parser.isSet(maxOption)) options.maxNotes = std::max<qint64>(1000, parser.value(maxOption).toLongLong());
+    if (parser.isSet(repsOption)) options.reps = std::max(1, parser.value(repsOption).toInt());
+    options.filter = parser.value(filterOption);
+    options.csv = parser.value(formatOption) == "csv";
+
+    Runner runner(options);
+    for (qint64 n = 1000; n <= options.maxNotes; n *= 10) benchChart(runner, int(n));
+
+    QTemporaryDir dir;
+    if (dir.isValid()) {
+        for (int n : {10, 100, 1000, 10000}) benchRecords(runner, n, dir.path());
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "ChartAnalysis.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
+
+namespace ChartAnalysis {
+
+static const int kNpsWindow = 1000;     // 峰值密度的滑动窗口 (ms)
+static const int kJackGap = 180;        // 同列两次间隔不超过这个算一次 jack (ms)
+
+// strain 参数参考 osu!mania 旧版星级算法
+static const double kIndividualDecayBase = 0.125; // 单列 strain 每秒衰减到 1/8
+static const double kOverallDecayBase = 0.30;
+static const int kStrainSection = 400;            // 取每 400ms 内的 strain 峰值
+static const double kSectionWeight = 0.9;         // 峰值从大到小按 0.9^i 加权
+static const double kStarScale = 0.018;
+
+// 各步骤尽量写成对连续数组的简单循环 (结构体数组 -> 数组结构体)，方便编译器自动向量化
+ChartMetrics compute(const std::vector<Note> &notes, int keyCount) {
+    ChartMetrics m;
+    m.valid = true;
+    keyCount = std::clamp(keyCount, 1, BeatmapInfo::kMaxKeys);
+
+    const int n = int(notes.size());
+    if (n == 0) return m;
+
+    std::vector<int> times(n), columns(n), endTimes(n);
+    for (int i = 0; i < n; ++i) {
+        times[i] = notes[i].time;
+        columns[i] = std::clamp(notes[i].column, 0, keyCount - 1);
+        endTimes[i] = notes[i].endTime;
+        if (notes[i].isHold) m.holdCount++;
+    }
+
+    const int first = times.front();
+    const int last = *std::max_element(endTimes.begin(), endTimes.end());
+    m.noteCount = n;
+    m.durationMs = last - first;
+    m.holdRatio = float(m.holdCount) / n;
+
+    // 不足 1 秒的谱面按 1 秒算，避免除出离谱的密度
+    const double seconds = std::max(m.durationMs, 1000) / 1000.0;
+    m.avgNps = float(n / seconds);
+
+    // 1. 峰值密度：双指针维护 [times[lo], times[hi]] 跨度小于窗口
+    int peak = 0;
+    for (int lo = 0, hi = 0; hi < n; ++hi) {
+        while (times[hi] - times[lo] >= kNpsWindow) ++lo;
+        peak = std::max(peak, hi - lo + 1);
+    }
+    m.peakNps = float(peak * 1000.0 / kNpsWindow);
+
+    // 2. 和弦密度：物件数 / 不同时间点数
+    int groups = 1;
+    for (int i = 1; i < n; ++i) groups += (times[i] != times[i - 1]);
+    m.chordDensity = float(n) / groups;
+
+    // 3. 同列间隔 (秒)：jack 统计和单列 strain 衰减都要用
+    std::vector<float> columnGap(n);
+    std::vector<int> lastInColumn(keyCount, INT_MIN);
+    std::vector<int> jackCount(keyCount, 0);
+    for (int i = 0; i < n; ++i) {
+        const int c = columns[i];
+        if (lastInColumn[c] == INT_MIN) {
+            columnGap[i] = 1e6f; // 该列第一个物件：视为之前的 strain 已完全衰减
+        } else {
+            const int gap = times[i] - lastInColumn[c];
+            columnGap[i] = gap / 1000.0f;
+            if (gap <= kJackGap) jackCount[c]++;
+        }
+        lastInColumn[c] = times[i];
+    }
+    for (int c = 0; c < keyCount; ++c) {
+        m.columnJacks[c] = float(jackCount[c] / seconds);
+        m.jackDensity = std::max(m.jackDensity, m.columnJacks[c]);
+    }
+
+    // 4. 衰减系数：base^dt = exp(dt * ln(base))，与递推分开算，这两个循环没有依赖可以向量化
+    std::vector<float> overallDecay(n), individualDecay(n);
+    const float lnOverall = float(std::log(kOverallDecayBase));
+    const float lnIndividual = float(std::log(kIndividualDecayBase));
+    overallDecay[0] = 0.0f;
+    for (int i = 1; i < n; ++i) overallDecay[i] = (times[i] - times[i - 1]) / 1000.0f;
+    for (int i = 0; i < n; ++i) overallDecay[i] = std::exp(overallDecay[i] * lnOverall);
+    for (int i = 0; i < n; ++i) individualDecay[i] = std::exp(columnGap[i] * lnIndividual);
+
+    // 5. strain 递推：按住其他列长条时打的物件额外加权
+    std::vector<float> individual(keyCount, 0.0f);
+    std::vector<int> holdEnd(keyCount, INT_MIN);
+    float overall = 0;
+    const int sectionCount = m.durationMs / kStrainSection + 1;
+    std::vector<float> sectionPeaks(sectionCount, 0.0f);
+
+    for (int i = 0; i < n; ++i) {
+        const int c = columns[i];
+        bool holdingOther = false;
+        for (int k = 0; k < keyCount; ++k) {
+            if (k != c && holdEnd[k] > times[i]) holdingOther = true;
+        }
+        const float holdFactor = holdingOther ? 1.25f : 1.0f;
+        const float holdAddition = holdingOther ? 1.0f : 0.0f;
+
+        individual[c] = individual[c] * individualDecay[i] + 2.0f * holdFactor;
+        overall = overall * overallDecay[i] + (1.0f + holdAddition) * holdFactor;
+        if (endTimes[i] > times[i]) holdEnd[c] = endTimes[i];
+
+        const int section = std::min((times[i] - first) / kStrainSection, sectionCount - 1);
+        sectionPeaks[section] = std::max(sectionPeaks[section], individual[c] + overall);
+    }
+
+    // 6. 峰值降序加权求和
+    std::sort(sectionPeaks.begin(), sectionPeaks.end(), std::greater<float>());
+    double difficulty = 0, weight = 1;
+    for (float peakStrain : sectionPeaks) {
+        if (peakStrain <= 0) break;
+        difficulty += peakStrain * weight;
+        weight *= kSectionWeight;
+    }
+    m.stars = float(difficulty * kStarScale);
+    return m;
+}
+
+}
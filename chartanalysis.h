@@ -0,0 +1,15 @@
+#ifndef CHARTANALYSIS_H
+#define CHARTANALYSIS_H
+
+#include <vector>
+#include "Structs.h"
+
+// 谱面难度统计 (纯计算，不依赖 GUI，可在任意线程调用)
+namespace ChartAnalysis {
+
+// notes 需按时间排序 (OsuParser::parseHitObjects 的输出即可)
+ChartMetrics compute(const std::vector<Note> &notes, int keyCount);
+
+}
+
+#endif // CHARTANALYSIS_H
@@ -0,0 +1,116 @@
+#include "ChartBinary.h"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <algorithm>
+
+namespace ChartBinary {
+
+// 格式变化时递增版本号，旧文件会被忽略并重新解析
+static const quint32 kMagic = 0x4F514342; // "OQCB"
+static const quint32 kVersion = 2;
+
+QString defaultDir() {
+    return QCoreApplication::applicationDirPath() + "/cache/charts";
+}
+
+QString pathFor(const QString &dir, quint64 contentHash) {
+    return dir + "/" + BeatmapInfo::hashToKey(contentHash) + ".oqc";
+}
+
+QByteArray serialize(const BeatmapInfo &info, const std::vector<Note> &notes,
+                     const std::vector<TimingPoint> &timing) {
+    QByteArray data;
+    data.reserve(256 + qsizetype(notes.size()) * 10);
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << kMagic << kVersion << info.contentHash
+        << info.title << info.artist << info.titleRomanised << info.artistRomanised
+        << info.version << info.audioFilename << qint32(info.previewTime) << qint32(info.keyCount)
+        << quint32(notes.size());
+    // 每个物件 10 字节：列 (1) + 开始 (4) + 结束 (4) + 是否长条 (1)
+    for (const Note &note : notes) {
+        out << quint8(note.column) << qint32(note.time) << qint32(note.endTime) << quint8(note.isHold);
+    }
+    // 时间点：时间 (4) + 拍长 (8) + 是否红线 (1)
+    out << quint32(timing.size());
+    for (const TimingPoint &p : timing) out << qint32(p.time) << p.beatLength << quint8(p.uninherited);
+    return data;
+}
+
+bool deserialize(const QByteArray &data, BeatmapInfo &info, std::vector<Note> &notes,
+                 std::vector<TimingPoint> *timing) {
+    QDataStream in(data);
+    quint32 magic = 0, version = 0, count = 0;
+    qint32 previewTime = -1, keyCount = 4;
+    in >> magic >> version;
+    if (magic != kMagic || version != kVersion) return false;
+
+    BeatmapInfo parsed;
+    in >> parsed.contentHash
+       >> parsed.title >> parsed.artist >> parsed.titleRomanised >> parsed.artistRomanised
+       >> parsed.version >> parsed.audioFilename >> previewTime >> keyCount >> count;
+    if (in.status() != QDataStream::Ok) return false;
+    // 数据长度对不上 (截断的文件) 时不要按 count 盲目分配
+    if (quint64(count) * 10 > quint64(data.size())) return false;
+
+    parsed.previewTime = previewTime;
+    parsed.keyCount = std::clamp(int(keyCount), 1, BeatmapInfo::kMaxKeys);
+
+    std::vector<Note> loaded;
+    loaded.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        quint8 column = 0, isHold = 0;
+        qint32 time = 0, endTime = 0;
+        in >> column >> time >> endTime >> isHold;
+        loaded.push_back({std::min(int(column), parsed.keyCount - 1), time, endTime, isHold != 0, false, false, false});
+    }
+    quint32 pointCount = 0;
+    in >> pointCount;
+    if (in.status() != QDataStream::Ok || quint64(pointCount) * 13 > quint64(data.size())) return false;
+    std::vector<TimingPoint> points;
+    points.reserve(pointCount);
+    for (quint32 i = 0; i < pointCount; ++i) {
+        qint32 time = 0;
+        double beatLength = 0;
+        quint8 uninherited = 1;
+        in >> time >> beatLength >> uninherited;
+        points.push_back({time, beatLength, uninherited != 0});
+    }
+    if (in.status() != QDataStream::Ok) return false;
+
+    parsed.filePath = info.filePath;
+    if (timing) *timing = std::move(points);
+    info = std::move(parsed);
+    notes = std::move(loaded);
+    return true;
+}
+
+bool save(const QString &path, const BeatmapInfo &info, const std::vector<Note> &notes,
+          const std::vector<TimingPoint> &timing) {
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(serialize(info, notes, timing));
+    return file.commit();
+}
+
+bool load(const QString &path, quint64 expectedHash, BeatmapInfo &info, std::vector<Note> &notes,
+          std::vector<TimingPoint> *timing) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    BeatmapInfo loaded;
+    loaded.filePath = info.filePath;
+    std::vector<Note> loadedNotes;
+    std::vector<TimingPoint> loadedTiming;
+    if (!deserialize(file.readAll(), loaded, loadedNotes, &loadedTiming)) return false;
+    if (expectedHash != 0 && loaded.contentHash != expectedHash) return false;
+    info = std::move(loaded);
+    notes = std::move(loadedNotes);
+    if (timing) *timing = std::move(loadedTiming);
+    return true;
+}
+
+}
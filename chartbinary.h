@@ -0,0 +1,33 @@
+#ifndef CHARTBINARY_H
+#define CHARTBINARY_H
+
+#include <QByteArray>
+#include <QString>
+#include <vector>
+#include "Structs.h"
+#include "ScrollIndex.h"
+
+// 预编译谱面：解析好的头部信息 + 物件表的二进制形式，按内容哈希命名。
+// 命令行工具批量生成，游戏加载时 .osu 内容哈希一致就直接读取，不再解析文本。
+namespace ChartBinary {
+
+// 默认目录：<程序目录>/cache/charts
+QString defaultDir();
+// <dir>/<内容哈希>.oqc
+QString pathFor(const QString &dir, quint64 contentHash);
+
+QByteArray serialize(const BeatmapInfo &info, const std::vector<Note> &notes,
+                     const std::vector<TimingPoint> &timing);
+// 格式 / 版本不符或数据不完整时返回 false；不会修改 info.filePath。timing 可以为空
+bool deserialize(const QByteArray &data, BeatmapInfo &info, std::vector<Note> &notes,
+                 std::vector<TimingPoint> *timing = nullptr);
+
+bool save(const QString &path, const BeatmapInfo &info, const std::vector<Note> &notes,
+          const std::vector<TimingPoint> &timing);
+// expectedHash 不为 0 时还要求文件里记录的内容哈希一致
+bool load(const QString &path, quint64 expectedHash, BeatmapInfo &info, std::vector<Note> &notes,
+          std::vector<TimingPoint> *timing = nullptr);
+
+}
+
+#endif // CHARTBINARY_H
@@ -0,0 +1,191 @@
+#include "ChartGenerator.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+
+namespace ChartGenerator {
+
+static constexpr int kMaxKeys = 10;
+
+// 列中心对应的 x 坐标 (解析时 floor(x * K / 512) 落回同一列)
+static int columnX(int column, int keyCount) {
+    return (column * 512 + 256) / keyCount;
+}
+
+static void appendNote(QByteArray &out, int x, int time) {
+    out += QByteArray::number(x);
+    out += ",192,";
+    out += QByteArray::number(time);
+    out += ",1,0,0:0:0:0:\n";
+}
+
+static void appendHold(QByteArray &out, int x, int time, int endTime) {
+    out += QByteArray::number(x);
+    out += ",192,";
+    out += QByteArray::number(time);
+    out += ",128,0,";
+    out += QByteArray::number(endTime);
+    out += ":0:0:0:0:\n";
+}
+
+Result generate(const Params &p) {
+    const int keys = std::clamp(p.keyCount, 1, kMaxKeys);
+    const double beatMs = 60000.0 / std::max(1.0, p.bpm);
+    const double stepMs = beatMs / std::max(1, p.snap);
+    const int lengthMs = std::max(1, p.lengthMs);
+
+    QString version = p.version;
+    if (version.isEmpty()) {
+        version = QString("%1K %2 %3bpm 1-%4").arg(keys).arg(patternName(p.pattern)).arg(p.bpm).arg(p.snap);
+        if (p.maxNotes > 0) version += QString(" %1 notes").arg(p.maxNotes);
+    }
+
+    Result r;
+    QByteArray &out = r.osu;
+    const qint64 estimate = p.maxNotes > 0 ? p.maxNotes : qint64(lengthMs / stepMs) * keys;
+    out.reserve(qsizetype(std::min<qint64>(estimate, 50000000)) * 28 + 1024);
+
+    out += "osu file format v14\n\n[General]\nAudioFilename: " + p.audioFilename.toUtf8()
+         + "\nAudioLeadIn: 0\nPreviewTime: 0\nMode: 3\n\n"
+         + "[Metadata]\nTitle:" + p.title.toUtf8() + "\nTitleUnicode:" + p.title.toUtf8()
+         + "\nArtist:ChartGenerator\nArtistUnicode:ChartGenerator\nCreator:ChartGenerator\n"
+         + "Version:" + version.toUtf8() + "\nTags:stress synthetic\n\n"
+         + "[Difficulty]\nHPDrainRate:8\nCircleSize:" + QByteArray::number(keys)
+         + "\nOverallDifficulty:8\nApproachRate:5\nSliderMultiplier:1.4\nSliderTickRate:1\n\n"
+         + "[Events]\n\n[TimingPoints]\n0," + QByteArray::number(beatMs, 'f', 6) + ",4,2,0,50,1,0\n\n"
+         + "[HitObjects]\n";
+
+    std::mt19937 rng(p.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::array<int, kMaxKeys> busyUntil;
+    busyUntil.fill(-1);
+    std::array<int, kMaxKeys> order;
+    for (int i = 0; i < kMaxKeys; ++i) order[i] = i;
+
+    auto limitReached = [&]() { return p.maxNotes > 0 && r.noteCount >= p.maxNotes; };
+    auto place = [&](int column, int time, int endTime) {
+        if (endTime > time) {
+            appendHold(out, columnX(column, keys), time, endTime);
+            r.holdCount++;
+        } else {
+            appendNote(out, columnX(column, keys), time);
+        }
+        busyUntil[column] = std::max(time, endTime);
+        r.endTime = std::max(r.endTime, std::max(time, endTime));
+        r.noteCount++;
+    };
+
+    // 行数：maxNotes 指定时不受 lengthMs 限制
+    for (qint64 row = 0;; ++row) {
+        const int time = 1000 + int(row * stepMs);
+        if (p.maxNotes > 0 ? limitReached() : time > 1000 + lengthMs) break;
+        // 整数 ms 溢出前停止 (约 24 天)
+        if (row * stepMs > 2.0e9) break;
+
+        switch (p.pattern) {
+        case Pattern::Chords:
+            // snap 短于 1ms 时相邻行会取整到同一时间：该列已有物件就跳过这一行
+            for (int c = 0; c < keys && !limitReached(); ++c) {
+                if (busyUntil[c] < time) place(c, time, time);
+            }
+            break;
+
+        case Pattern::Jacks: {
+            // 同一组列连打：长条只能短于一个 snap，否则会和下一行重叠
+            const int width = std::clamp(p.chordSize, 1, keys);
+            const int holdLen = int(stepMs / 2);
+            for (int c = 0; c < width && !limitReached(); ++c) {
+                if (busyUntil[c] >= time) continue; // 同上：取整后和上一行同一时间
+                const bool hold = holdLen > 0 && unit(rng) < p.holdRatio;
+                place(c, time, hold ? time + holdLen : time);
+            }
+            break;
+        }
+
+        case Pattern::Holds: {
+            // 每列每 keys 行开始一个长条，相邻列错开一行，长度略短于 keys 行：
+            // 同一列前后不重叠，但任意时刻几乎所有列都在按住
+            const int c = int(row % keys);
+            const int endTime = time + std::max(1, int(stepMs * keys) - 1);
+            if (busyUntil[c] < time) place(c, time, endTime);
+            break;
+        }
+
+        case Pattern::Random: {
+            const int want = (unit(rng) < p.chordRatio) ? std::clamp(p.chordSize, 1, keys) : 1;
+            std::shuffle(order.begin(), order.begin() + keys, rng);
+            int placed = 0;
+            for (int k = 0; k < keys && placed < want && !limitReached(); ++k) {
+                const int c = order[k];
+                if (busyUntil[c] >= time) continue; // 该列还有长条没结束
+                const bool hold = unit(rng) < p.holdRatio;
+                const int holdLen = int(stepMs * (2 + int(unit(rng) * 6)));
+                place(c, time, hold ? time + holdLen : time);
+                placed++;
+            }
+            break;
+        }
+        }
+    }
+    return r;
+}
+
+bool writeSilentWav(const QString &path, int durationMs) {
+    const quint32 sampleRate = 8000;
+    const quint32 dataSize = quint32(qint64(std::max(0, durationMs)) * sampleRate / 1000);
+
+    QByteArray header(44, '\0');
+    uchar *h = reinterpret_cast<uchar *>(header.data());
+    memcpy(h, "RIFF", 4);
+    qToLittleEndian<quint32>(36 + dataSize, h + 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, h + 16);          // fmt 块长度
+    qToLittleEndian<quint16>(1, h + 20);           // PCM
+    qToLittleEndian<quint16>(1, h + 22);           // 单声道
+    qToLittleEndian<quint32>(sampleRate, h + 24);
+    qToLittleEndian<quint32>(sampleRate, h + 28);  // 每秒字节数
+    qToLittleEndian<quint16>(1, h + 32);           // 块对齐
+    qToLittleEndian<quint16>(8, h + 34);           // 位深
+    memcpy(h + 36, "data", 4);
+    qToLittleEndian<quint32>(dataSize, h + 40);
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(header);
+    // 8 位 PCM 是无符号的，静音 = 0x80；分块写，避免长音频一次分配太多内存
+    const QByteArray chunk(64 * 1024, char(0x80));
+    for (quint32 left = dataSize; left > 0;) {
+        const quint32 n = std::min<quint32>(left, quint32(chunk.size()));
+        file.write(chunk.constData(), n);
+        left -= n;
+    }
+    return file.commit();
+}
+
+bool parsePattern(const QString &name, Pattern &pattern) {
+    const QString n = name.toLower();
+    if (n == "random") pattern = Pattern::Random;
+    else if (n == "chords") pattern = Pattern::Chords;
+    else if (n == "jacks") pattern = Pattern::Jacks;
+    else if (n == "holds") pattern = Pattern::Holds;
+    else return false;
+    return true;
+}
+
+QString patternName(Pattern pattern) {
+    switch (pattern) {
+    case Pattern::Random: return "random";
+    case Pattern::Chords: return "chords";
+    case Pattern::Jacks: return "jacks";
+    case Pattern::Holds: return "holds";
+    }
+    return "random";
+}
+
+}
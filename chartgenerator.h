@@ -0,0 +1,51 @@
+#ifndef CHARTGENERATOR_H
+#define CHARTGENERATOR_H
+
+#include <QByteArray>
+#include <QString>
+
+// 合成谱面生成 (压力测试 / 基准测试用)：写出合法的 .osu 文本，
+// 同一列的物件不会重叠，时间严格按行递增。固定种子时结果可复现。
+namespace ChartGenerator {
+
+enum class Pattern {
+    Random,   // 每行随机选列，按 chordRatio 出双押 / 多押
+    Chords,   // 每行全部列同时按下 (100% 和弦)
+    Jacks,    // 每行都打同一组列 (纵连)，间隔 = 一个 snap
+    Holds     // 所有列都铺长条，相邻列错开，任意时刻多列同时按住
+};
+
+struct Params {
+    int keyCount = 4;
+    double bpm = 180;
+    int snap = 4;              // 每拍几行 (4 = 16 分)
+    int lengthMs = 120000;     // 谱面长度 (物件时间范围)
+    qint64 maxNotes = 0;       // > 0 时物件数到达上限就停止 (覆盖 lengthMs)
+    double holdRatio = 0.2;    // Random / Jacks 中长条的比例
+    double chordRatio = 0.2;   // Random 中多押行的比例
+    int chordSize = 2;         // Random 中多押行的物件数
+    Pattern pattern = Pattern::Random;
+    quint32 seed = 12345;
+    QString title = "Stress";
+    QString version;           // 空则按参数自动命名
+    QString audioFilename = "audio.wav";
+};
+
+struct Result {
+    QByteArray osu;
+    qint64 noteCount = 0;
+    qint64 holdCount = 0;
+    int endTime = 0;           // 最后一个物件结束的时间 (ms)
+};
+
+Result generate(const Params &params);
+
+// 写出无声 WAV (8 kHz / 单声道 / 8 位)，让加载流程有音频可解码；每秒只占 8 KB
+bool writeSilentWav(const QString &path, int durationMs);
+
+bool parsePattern(const QString &name, Pattern &pattern);
+QString patternName(Pattern pattern);
+
+}
+
+#endif // CHARTGENERATOR_H
@@ -0,0 +1,166 @@
+#include "ChartPrefetcher.h"
+#include "AudioCache.h"
+#include "ContentHash.h"
+#include "OsuParser.h"
+#include "ChartBinary.h"
+#include "ChartValidator.h"
+#include "ZipArchive.h"
+#include "Trace.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrent>
+
+ChartPrefetcher &ChartPrefetcher::instance() {
+    static ChartPrefetcher prefetcher;
+    return prefetcher;
+}
+
+PreparedChartPtr ChartPrefetcher::loadChart(const QString &filePath, const std::atomic_bool *cancelled) {
+    TRACE_SCOPE("chart.load");
+    // 先取时间戳再读：读的过程中文件被改，下次查缓存时对不上，宁可多读一次
+    const QString stamp = stampFor(filePath);
+    // 普通文件或 .osz 包内的文件 (直接解压到内存)
+    QByteArray bytes;
+    if (!ZipArchive::readFile(filePath, bytes)) return nullptr;
+    if (cancelled && cancelled->load()) return nullptr;
+
+    auto chart = std::make_shared<PreparedChart>();
+    chart->info.filePath = filePath;
+    chart->fileStamp = stamp;
+    chart->info.contentHash = ContentHash::xxh64(bytes.constData(), bytes.size());
+    // 命令行工具预编译过 (内容哈希一致) 就直接读二进制，否则解析文本
+    const QString compiled = ChartBinary::pathFor(ChartBinary::defaultDir(), chart->info.contentHash);
+    std::vector<TimingPoint> timing;
+    if (!ChartBinary::load(compiled, chart->info.contentHash, chart->info, chart->notes, &timing)) {
+        TRACE_SCOPE("chart.parse");
+        OsuParser::parseHeader(bytes, chart->info);
+        OsuParser::parseTimingPoints(bytes, timing);
+        OsuParser::parseHitObjects(bytes, chart->info.keyCount, chart->notes); // 键数来自 CircleSize
+    }
+
+    // 变速预积分：每个物件的滚动位置在这里 (后台线程) 算好，游戏中不再计算
+    int endTime = 0;
+    for (const Note &note : chart->notes) endTime = std::max(endTime, note.endTime);
+    chart->scroll.build(std::move(timing), endTime);
+    chart->scroll.applyTo(chart->notes);
+    if (cancelled && cancelled->load()) return nullptr;
+
+    chart->audioPath = resolveAudioPath(filePath, chart->info.audioFilename);
+    return chart;
+}
+
+QString ChartPrefetcher::resolveAudioPath(const QString &osuPath, const QString &audioFilename) {
+    return ChartValidator::resolveAudioPath(osuPath, audioFilename);
+}
+
+QString ChartPrefetcher::stampFor(const QString &filePath) {
+    QString archive;
+    const bool packed = ZipArchive::splitPath(filePath, &archive, nullptr);
+    QFileInfo info(packed ? archive : filePath);
+    return QString("%1|%2").arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+void ChartPrefetcher::prefetch(const QString &filePath) {
+    const QString stamp = stampFor(filePath); // 在锁外访问文件系统
+    QMutexLocker locker(&m_mutex);
+    if (m_job.filePath == filePath && m_job.fileStamp == stamp) return; // 正在预读 (或刚预读完) 同一个文件
+    // 同一文件夹的难度通常共用一个音频，不取消它的解码
+    cancelJob(QFileInfo(m_job.filePath).path() != QFileInfo(filePath).path());
+
+    if (PreparedChartPtr chart = lookup(filePath, stamp)) {
+        // 谱面已在缓存中，音频可能已被淘汰，再请求一次 (已缓存时不会解码)
+        m_job.filePath = filePath;
+        m_job.fileStamp = stamp;
+        if (!chart->audioPath.isEmpty()) {
+            m_job.audioPath = chart->audioPath;
+            warmAudio(chart->audioPath);
+        }
+        return;
+    }
+
+    auto cancelled = std::make_shared<std::atomic_bool>(false);
+    m_job.filePath = filePath;
+    m_job.fileStamp = stamp;
+    m_job.cancelled = cancelled;
+    m_job.chart = QtConcurrent::run([this, filePath, cancelled]() -> PreparedChartPtr {
+        PreparedChartPtr chart = loadChart(filePath, cancelled.get());
+        if (!chart || cancelled->load()) return chart;
+        insert(chart);
+
+        // 谱面已经可以交给 GameWidget 了，音频解码由 AudioCache 另起任务，不阻塞 take()
+        if (!chart->audioPath.isEmpty()) {
+            QMutexLocker locker(&m_mutex);
+            if (cancelled->load()) return chart;
+            m_job.audioPath = chart->audioPath;
+            warmAudio(chart->audioPath);
+        }
+        return chart;
+    });
+}
+
+void ChartPrefetcher::cancel() {
+    QMutexLocker locker(&m_mutex);
+    cancelJob(true);
+}
+
+void ChartPrefetcher::cancelJob(bool cancelAudio) {
+    if (m_job.cancelled) m_job.cancelled->store(true);
+    if (cancelAudio && !m_job.audioPath.isEmpty()) AudioCache::instance().cancel(m_job.audioPath);
+    m_job = Job();
+}
+
+PreparedChartPtr ChartPrefetcher::take(const QString &filePath) {
+    const QString stamp = stampFor(filePath);
+    QFuture<PreparedChartPtr> pending;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (PreparedChartPtr chart = lookup(filePath, stamp)) return chart;
+        if (m_job.filePath != filePath || m_job.fileStamp != stamp) return nullptr;
+        pending = m_job.chart;
+    }
+    if (!pending.isValid()) return nullptr;
+    // 任务已经在跑，等它比重新读一遍快
+    pending.waitForFinished();
+    return pending.result();
+}
+
+void ChartPrefetcher::invalidate(const QString &filePath) {
+    QMutexLocker locker(&m_mutex);
+    m_cache.removeIf([&](const PreparedChartPtr &chart) { return chart->info.filePath == filePath; });
+    if (m_job.filePath == filePath) cancelJob(false); // 音频没变，不打断它的解码
+}
+
+void ChartPrefetcher::insert(const PreparedChartPtr &chart) {
+    QMutexLocker locker(&m_mutex);
+    for (qsizetype i = 0; i < m_cache.size(); ++i) {
+        if (m_cache[i]->info.filePath == chart->info.filePath) {
+            m_cache.removeAt(i);
+            break;
+        }
+    }
+    m_cache.prepend(chart);
+    while (m_cache.size() > kCapacity) m_cache.removeLast();
+}
+
+PreparedChartPtr ChartPrefetcher::lookup(const QString &filePath, const QString &stamp) {
+    for (qsizetype i = 0; i < m_cache.size(); ++i) {
+        if (m_cache[i]->info.filePath == filePath) {
+            if (m_cache[i]->fileStamp != stamp) {
+                m_cache.removeAt(i); // 文件在缓存之后被改过
+                return nullptr;
+            }
+            PreparedChartPtr chart = m_cache[i];
+            m_cache.move(i, 0); // 移到最前
+            return chart;
+        }
+    }
+    return nullptr;
+}
+
+void ChartPrefetcher::warmAudio(const QString &audioPath) {
+    // 整首解码进共享缓存：按 Play 时 GameWidget 直接命中，同一首歌的其他难度也一样
+    AudioCache::instance().request(audioPath);
+}
@@ -0,0 +1,75 @@
+#ifndef CHARTPREFETCHER_H
+#define CHARTPREFETCHER_H
+
+#include <QFuture>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Structs.h"
+#include "ScrollIndex.h"
+
+// 已解析好的谱面 (只读，可在线程间共享)
+struct PreparedChart {
+    BeatmapInfo info;        // 头部信息 + filePath + contentHash
+    std::vector<Note> notes; // 已按时间排序
+    QString audioPath;       // 实际使用的音频文件 (找不到时为空)
+    ScrollIndex scroll;      // BPM / SV 变速 (notes 的 headPos / tailPos 已按它算好)
+    QString fileStamp;       // 读取前文件的 大小|修改时间 (见 ChartPrefetcher::stampFor)
+};
+using PreparedChartPtr = std::shared_ptr<const PreparedChart>;
+
+// 选歌时的预读：选中一个难度就在线程池上解析谱面，并让 AudioCache 在后台解码整首音频，
+// 按 Play 时 GameWidget 直接拿现成的结果。选中项变化时取消上一个任务 (包括音频解码)。
+// 进程内共享一份，最近几次选中的谱面保存在一个小的 LRU 里。
+class ChartPrefetcher {
+public:
+    static ChartPrefetcher &instance();
+
+    // 同步读取并解析谱面 (预读任务和未命中时都用它)；读取失败返回 nullptr
+    static PreparedChartPtr loadChart(const QString &filePath, const std::atomic_bool *cancelled = nullptr);
+
+    // 谱面使用的音频：优先用 AudioFilename，找不到就取同目录下第一个音频 (都没有返回空串)
+    // .osz 包内的谱面返回包内的虚拟路径
+    static QString resolveAudioPath(const QString &osuPath, const QString &audioFilename);
+
+    // 文件的 大小|修改时间；.osz 包内的谱面用包文件的 (和 AudioCache::keyFor 一致)。
+    // 缓存的谱面和它对不上就说明文件被改过，不再使用
+    static QString stampFor(const QString &filePath);
+
+    // 选中项变化时调用：取消正在进行的预读，开始预读 filePath (已在缓存中则只调整 LRU 顺序)
+    void prefetch(const QString &filePath);
+    void cancel();
+
+    // 取预读结果：正在预读同一个文件时等它的谱面部分完成；没有预读过返回 nullptr
+    PreparedChartPtr take(const QString &filePath);
+
+    // 文件已知被修改 (热重载)：丢掉它的缓存和正在进行的预读
+    void invalidate(const QString &filePath);
+
+private:
+    ChartPrefetcher() = default;
+
+    struct Job {
+        QString filePath;
+        QString fileStamp;
+        QString audioPath; // 谱面解析完后才知道
+        std::shared_ptr<std::atomic_bool> cancelled;
+        QFuture<PreparedChartPtr> chart; // 谱面解析任务 (完成后再单独起一个音频预热任务)
+    };
+
+    void insert(const PreparedChartPtr &chart);
+    void warmAudio(const QString &audioPath);
+    void cancelJob(bool cancelAudio); // 调用方已持锁
+    PreparedChartPtr lookup(const QString &filePath, const QString &stamp); // 调用方已持锁；过期的条目顺便删掉
+
+    static const int kCapacity = 4;
+
+    mutable QMutex m_mutex;
+    QList<PreparedChartPtr> m_cache; // 最近使用的在最前
+    Job m_job;
+};
+
+#endif // CHARTPREFETCHER_H
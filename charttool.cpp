@@ -0,0 +1,303 @@
+// 命令行谱面工具：遍历歌曲目录，在全部核心上并行解析 / 校验每个 .osu，
+// 可选地输出预编译谱面并预热库缓存，最后打印吞吐量和各阶段耗时。
+// --autoplay 用完美输入把每个谱面跑一遍真实的判定引擎，达不到满分的谱面单独列出。
+//
+//   osu_chart_tool <歌曲目录> [--compile] [--out <dir>] [--warm-cache] [--autoplay] [--jobs N] [--quiet] [--strict] [--trace <file>]
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include "Autoplay.h"
+#include "ChartAnalysis.h"
+#include "ChartBinary.h"
+#include "ChartValidator.h"
+#include "ContentHash.h"
+#include "LibraryCache.h"
+#include "OsuParser.h"
+#include "Trace.h"
+
+namespace {
+
+struct ToolOptions {
+    bool compile = false;
+    QString outDir;
+    bool warmCache = false;
+    bool autoplay = false;
+    JudgmentWindow window; // 自动游玩用游戏当前设置的判定区间
+};
+
+struct FileTask {
+    QString path;
+    qint64 size = 0;
+    qint64 mtime = 0;
+};
+
+// 单个文件的处理结果，各阶段耗时用纳秒 (线程内计时，汇总后就是各阶段的 CPU 时间)
+struct FileResult {
+    bool ok = false;
+    qint64 bytes = 0;
+    qint64 readNs = 0;
+    qint64 hashNs = 0;
+    qint64 parseNs = 0;
+    qint64 checkNs = 0;
+    qint64 writeNs = 0;
+    qint64 autoplayNs = 0;
+    int noteCount = 0;
+    bool compiled = false;
+    AutoplayResult autoplay;
+    BeatmapInfo info;
+    QList<ChartIssue> issues;
+};
+
+FileResult processFile(const FileTask &task, const ToolOptions &options) {
+    TRACE_SCOPE("tool.processFile");
+    FileResult r;
+    QElapsedTimer t;
+
+    t.start();
+    QFile f(task.path);
+    if (!f.open(QIODevice::ReadOnly)) return r;
+    const QByteArray bytes = f.readAll();
+    f.close();
+    r.readNs = t.nsecsElapsed();
+    r.bytes = bytes.size();
+
+    t.start();
+    r.info.filePath = task.path;
+    r.info.contentHash = ContentHash::xxh64(bytes.constData(), bytes.size());
+    r.hashNs = t.nsecsElapsed();
+
+    t.start();
+    std::vector<Note> notes;
+    OsuParser::ParseReport report;
+    std::vector<TimingPoint> timing;
+    {
+        TRACE_SCOPE("chart.parse");
+        OsuParser::parseHeader(bytes, r.info);
+        OsuParser::parseTimingPoints(bytes, timing);
+        OsuParser::parseHitObjects(bytes, r.info.keyCount, notes, &report);
+    }
+    r.parseNs = t.nsecsElapsed();
+    r.noteCount = int(notes.size());
+
+    t.start();
+    r.issues = ChartValidator::check(notes, r.info.keyCount, report);
+    // 和游戏同样的查找规则 (找不到指定文件时退回文件夹里的第一个音频)
+    if (ChartValidator::resolveAudioPath(task.path, r.info.audioFilename).isEmpty()) {
+        r.issues.append({ChartIssue::MissingAudio, -1, 1});
+    }
+    if (options.warmCache) r.info.metrics = ChartAnalysis::compute(notes, r.info.keyCount);
+    r.checkNs = t.nsecsElapsed();
+
+    if (options.autoplay) {
+        t.start();
+        r.autoplay = Autoplay::run(notes, r.info.keyCount, options.window);
+        r.autoplayNs = t.nsecsElapsed();
+    }
+
+    if (options.compile) {
+        t.start();
+        r.compiled = ChartBinary::save(ChartBinary::pathFor(options.outDir, r.info.contentHash), r.info, notes, timing);
+        r.writeNs = t.nsecsElapsed();
+    }
+
+    r.ok = true;
+    return r;
+}
+
+const char *judgmentName(Judgment j) {
+    switch (j) {
+    case Judgment::Perfect: return "perfect";
+    case Judgment::Great: return "great";
+    case Judgment::Good: return "good";
+    case Judgment::Bad: return "bad";
+    case Judgment::Miss: return "miss";
+    case Judgment::MissEarly: return "miss-early";
+    case Judgment::MissOverhold: return "miss-overhold";
+    case Judgment::None: break;
+    }
+    return "none";
+}
+
+// 游戏保存的判定区间 (和 GameWidget::loadSettings 同一份设置)
+JudgmentWindow savedJudgmentWindow() {
+    QSettings settings("MugDiffusion", "OsuQuickReader");
+    JudgmentWindow w;
+    w.perfect = settings.value("judge_perfect", w.perfect).toInt();
+    w.great = settings.value("judge_great", w.great).toInt();
+    w.good = settings.value("judge_good", w.good).toInt();
+    w.miss = settings.value("judge_miss", w.miss).toInt();
+    return w;
+}
+
+QString formatMs(qint64 ns) {
+    return QString::number(ns / 1e6, 'f', 1) + " ms";
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("osu_chart_tool");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Parse, validate and precompile every .osu chart under a song folder.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("folder", "Song folder to scan (recursively).");
+    QCommandLineOption compileOption("compile", "Write precompiled binary charts.");
+    QCommandLineOption outOption("out", "Output folder for precompiled charts (default: <app>/cache/charts).", "dir");
+    QCommandLineOption warmOption("warm-cache", "Update the game's library cache with the scanned charts.");
+    QCommandLineOption autoplayOption("autoplay", "Run every chart with perfect input and report charts that miss the maximum score (exit code 3).");
+    QCommandLineOption jobsOption("jobs", "Worker threads (default: all cores).", "n");
+    QCommandLineOption quietOption("quiet", "Only print the summary.");
+    QCommandLineOption strictOption("strict", "Exit with code 2 when any chart has issues.");
+    QCommandLineOption traceOption("trace", "Record spans and write a Chrome trace-event JSON file.", "file");
+    parser.addOptions({compileOption, outOption, warmOption, autoplayOption, jobsOption, quietOption, strictOption, traceOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1 || !QFileInfo(args.first()).isDir()) {
+        err << "usage: osu_chart_tool <folder> [options]  (see --help)\n";
+        return 1;
+    }
+
+    ToolOptions options;
+    options.compile = parser.isSet(compileOption);
+    options.outDir = parser.isSet(outOption) ? parser.value(outOption) : ChartBinary::defaultDir();
+    options.warmCache = parser.isSet(warmOption);
+    options.autoplay = parser.isSet(autoplayOption);
+    if (options.autoplay) options.window = savedJudgmentWindow();
+    if (options.compile) QDir().mkpath(options.outDir);
+    if (parser.isSet(jobsOption)) {
+        QThreadPool::globalInstance()->setMaxThreadCount(std::max(1, parser.value(jobsOption).toInt()));
+    }
+    const bool quiet = parser.isSet(quietOption);
+    if (parser.isSet(traceOption)) {
+        if (!Trace::compiledIn()) err << "warning: built without OSU_ENABLE_TRACING, --trace writes no spans\n";
+        Trace::setEnabled(true);
+    }
+
+    QElapsedTimer total;
+    total.start();
+
+    // 1. 遍历目录 (单线程，只取文件名 / 大小 / 修改时间)
+    QElapsedTimer phase;
+    phase.start();
+    QList<FileTask> tasks;
+    QDirIterator it(args.first(), QStringList() << "*.osu", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo fi = it.fileInfo();
+        tasks.append({fi.absoluteFilePath(), fi.size(), fi.lastModified().toMSecsSinceEpoch()});
+    }
+    const qint64 walkMs = phase.elapsed();
+
+    // 2. 读取 + 哈希 + 解析 + 校验 (+ 输出) 全部在线程池上并行
+    phase.start();
+    const QList<FileResult> results = QtConcurrent::blockingMapped<QList<FileResult>>(
+        tasks, [&options](const FileTask &task) { return processFile(task, options); });
+    const qint64 processMs = phase.elapsed();
+
+    // 3. 汇总 (按遍历顺序输出，便于比对)
+    qint64 bytes = 0, readNs = 0, hashNs = 0, parseNs = 0, checkNs = 0, writeNs = 0, autoplayNs = 0;
+    qint64 notes = 0;
+    int failed = 0, withIssues = 0, compiled = 0, autoplayFailed = 0;
+    for (qsizetype i = 0; i < results.size(); ++i) {
+        const FileResult &r = results[i];
+        if (!r.ok) {
+            failed++;
+            if (!quiet) out << "ERROR  " << tasks[i].path << ": cannot read\n";
+            continue;
+        }
+        bytes += r.bytes;
+        readNs += r.readNs;
+        hashNs += r.hashNs;
+        parseNs += r.parseNs;
+        checkNs += r.checkNs;
+        writeNs += r.writeNs;
+        autoplayNs += r.autoplayNs;
+        notes += r.noteCount;
+        if (r.compiled) compiled++;
+        if (options.autoplay && !r.autoplay.isMaxScore()) {
+            autoplayFailed++;
+            if (!quiet) {
+                out << "AUTO   " << tasks[i].path << ": score " << r.autoplay.score.score << ", "
+                    << r.autoplay.score.countPerfect << "/" << r.autoplay.judgments << " perfect, first "
+                    << judgmentName(r.autoplay.firstFlaw) << " @" << r.autoplay.firstFlawMs << "ms\n";
+            }
+        }
+        if (r.issues.isEmpty()) continue;
+
+        withIssues++;
+        if (quiet) continue;
+        out << "WARN   " << tasks[i].path << ":";
+        for (const ChartIssue &issue : r.issues) {
+            out << " " << ChartValidator::kindName(issue.kind);
+            if (issue.count > 1) out << " x" << issue.count;
+            if (issue.time >= 0) out << " @" << issue.time << "ms";
+        }
+        out << "\n";
+    }
+
+    // 4. 预热库缓存 (单线程写一个文件)
+    qint64 cacheMs = 0;
+    if (options.warmCache) {
+        phase.start();
+        LibraryCache cache;
+        cache.load();
+        for (qsizetype i = 0; i < results.size(); ++i) {
+            if (results[i].ok) cache.insert(tasks[i].path, tasks[i].size, tasks[i].mtime, results[i].info);
+        }
+        if (cache.isDirty() && !cache.save()) err << "failed to write library cache\n";
+        cacheMs = phase.elapsed();
+    }
+
+    const double seconds = std::max<qint64>(1, processMs) / 1000.0;
+    const double mb = bytes / (1024.0 * 1024.0);
+    out << "\nfiles:      " << tasks.size() << " (" << failed << " unreadable, " << withIssues << " with issues)\n"
+        << "notes:      " << notes << "\n"
+        << "data:       " << QString::number(mb, 'f', 1) << " MB\n"
+        << "threads:    " << QThreadPool::globalInstance()->maxThreadCount() << "\n"
+        << "walk:       " << walkMs << " ms\n"
+        << "process:    " << processMs << " ms wall  ("
+        << QString::number(tasks.size() / seconds, 'f', 0) << " files/s, "
+        << QString::number(mb / seconds, 'f', 1) << " MB/s)\n"
+        << "  read      " << formatMs(readNs) << " cpu\n"
+        << "  hash      " << formatMs(hashNs) << " cpu\n"
+        << "  parse     " << formatMs(parseNs) << " cpu\n"
+        << "  check     " << formatMs(checkNs) << " cpu\n";
+    if (options.autoplay) {
+        out << "  autoplay  " << formatMs(autoplayNs) << " cpu  (" << autoplayFailed << " below max score, window "
+            << options.window.perfect << "/" << options.window.great << "/" << options.window.good << "/"
+            << options.window.miss << " ms)\n";
+    }
+    if (options.compile) {
+        out << "  compile   " << formatMs(writeNs) << " cpu  (" << compiled << " charts -> " << options.outDir << ")\n";
+    }
+    if (options.warmCache) out << "cache:      " << cacheMs << " ms\n";
+    out << "total:      " << total.elapsed() << " ms\n";
+    if (parser.isSet(traceOption)) {
+        QString error;
+        const int events = Trace::dump(parser.value(traceOption), &error);
+        if (events < 0) err << "failed to write trace: " << error << "\n";
+        else out << "trace:      " << events << " events -> " << parser.value(traceOption) << "\n";
+    }
+    out.flush();
+
+    if (failed > 0) return 1;
+    if (parser.isSet(strictOption) && withIssues > 0) return 2;
+    if (autoplayFailed > 0) return 3;
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "ChartValidator.h"
+#include "ZipArchive.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <array>
+
+namespace ChartValidator {
+
+// 包内版本：在 .osu 所在的包内文件夹里找
+static QString resolveArchiveAudio(const QString &archive, const QString &entryName, const QString &audioFilename) {
+    ZipIndexPtr index = ZipArchive::index(archive);
+    if (!index) return QString();
+    const qsizetype slash = entryName.lastIndexOf('/');
+    const QString prefix = entryName.left(slash + 1);
+    if (!audioFilename.isEmpty()) {
+        if (const ZipEntry *entry = index->find(prefix + audioFilename)) return ZipArchive::joinPath(archive, entry->name);
+    }
+    for (const ZipEntry &entry : index->entries) {
+        if (!entry.name.startsWith(prefix, Qt::CaseInsensitive) || entry.name.indexOf('/', prefix.size()) >= 0) continue;
+        if (entry.name.endsWith(QLatin1String(".mp3"), Qt::CaseInsensitive)
+            || entry.name.endsWith(QLatin1String(".ogg"), Qt::CaseInsensitive)
+            || entry.name.endsWith(QLatin1String(".wav"), Qt::CaseInsensitive)) {
+            return ZipArchive::joinPath(archive, entry.name);
+        }
+    }
+    return QString();
+}
+
+QString resolveAudioPath(const QString &osuPath, const QString &audioFilename) {
+    QString archive, entryName;
+    if (ZipArchive::splitPath(osuPath, &archive, &entryName)) return resolveArchiveAudio(archive, entryName, audioFilename);
+
+    QDir dir = QFileInfo(osuPath).absoluteDir();
+    QString audioPath = dir.filePath(audioFilename);
+    if (!audioFilename.isEmpty() && QFile::exists(audioPath)) return audioPath;
+
+    const QStringList audios = dir.entryList(QStringList() << "*.mp3" << "*.ogg" << "*.wav", QDir::Files);
+    return audios.isEmpty() ? QString() : dir.filePath(audios.first());
+}
+
+QList<ChartIssue> check(const std::vector<Note> &notes, int keyCount, const OsuParser::ParseReport &report) {
+    QList<ChartIssue> issues;
+    if (report.unsortedCount > 0)
+        issues.append({ChartIssue::Unsorted, report.firstUnsortedTime, report.unsortedCount});
+    if (report.reversedHolds > 0)
+        issues.append({ChartIssue::ReversedHold, report.firstReversedTime, report.reversedHolds});
+    if (report.malformedLines > 0)
+        issues.append({ChartIssue::Malformed, -1, report.malformedLines});
+    if (notes.empty()) {
+        issues.append({ChartIssue::Empty, -1, 1});
+        return issues;
+    }
+
+    // 重叠：物件已按时间排序，每列只需记住上一个物件占用到的时间
+    keyCount = std::clamp(keyCount, 1, kMaxKeyCount);
+    std::array<int, kMaxKeyCount> busyUntil;
+    busyUntil.fill(-1);
+    std::array<bool, kMaxKeyCount> seen{};
+    int overlaps = 0;
+    int firstOverlap = -1;
+    for (const Note &note : notes) {
+        const int c = std::clamp(note.column, 0, keyCount - 1);
+        if (seen[c] && note.time <= busyUntil[c]) {
+            if (overlaps++ == 0) firstOverlap = note.time;
+        }
+        seen[c] = true;
+        busyUntil[c] = std::max(busyUntil[c], note.endTime);
+    }
+    if (overlaps > 0) issues.append({ChartIssue::Overlap, firstOverlap, overlaps});
+    return issues;
+}
+
+QString kindName(ChartIssue::Kind kind) {
+    switch (kind) {
+    case ChartIssue::Unsorted: return "unsorted";
+    case ChartIssue::Overlap: return "overlap";
+    case ChartIssue::ReversedHold: return "reversed-hold";
+    case ChartIssue::Malformed: return "malformed";
+    case ChartIssue::MissingAudio: return "missing-audio";
+    case ChartIssue::Empty: return "empty";
+    }
+    return "unknown";
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef CHARTVALIDATOR_H
+#define CHARTVALIDATOR_H
+
+#include <QList>
+#include <QString>
+#include <vector>
+#include "Structs.h"
+#include "OsuParser.h"
+
+// 谱面校验中发现的一个问题
+struct ChartIssue {
+    enum Kind {
+        Unsorted,      // 原始物件没有按时间排列
+        Overlap,       // 同一列的物件重叠 (同一时间两个物件 / 落在长条内部)
+        ReversedHold,  // 长条 endTime < time
+        Malformed,     // 物件行字段不足
+        MissingAudio,  // 找不到音频文件
+        Empty          // 没有任何物件
+    };
+    Kind kind;
+    int time = -1;   // 第一个出问题的时间点 (ms)，-1 表示不适用
+    int count = 1;   // 同类问题的个数
+};
+
+// 谱面校验 (不依赖 GUI，命令行工具使用)
+namespace ChartValidator {
+
+// notes 为 parseHitObjects 的结果 (已排序)，report 为同一次解析的报告；音频检查由调用方负责
+QList<ChartIssue> check(const std::vector<Note> &notes, int keyCount, const OsuParser::ParseReport &report);
+
+QString kindName(ChartIssue::Kind kind);
+
+// 游戏实际会用的音频文件 (普通文件夹或 .osz 包内)：先按 AudioFilename 找，找不到时退回同目录下第一个
+// .mp3 / .ogg / .wav；都没有返回空串。游戏加载和命令行工具的 MissingAudio 检查共用这一套规则
+QString resolveAudioPath(const QString &osuPath, const QString &audioFilename);
+
+}
+
+#endif // CHARTVALIDATOR_H
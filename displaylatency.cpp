@@ -0,0 +1,52 @@
+#include "DisplayLatency.h"
+#include <algorithm>
+#include <cmath>
+
+void DisplayLatency::Ring::add(qint64 v) {
+    values[next] = v;
+    next = (next + 1) % kSamples;
+    count = std::min(count + 1, kSamples);
+}
+
+qint64 DisplayLatency::Ring::median() const {
+    if (count == 0) return 0;
+    std::array<qint64, kSamples> sorted = values;
+    auto mid = sorted.begin() + count / 2;
+    std::nth_element(sorted.begin(), mid, sorted.begin() + count);
+    return *mid;
+}
+
+void DisplayLatency::framePainted(qint64 ns) {
+    // 一次交换之前可能绘制了多次 (极少见)，以第一次为准：那一帧里最早的画面最晚上屏
+    if (m_paintNs < 0) m_paintNs = ns;
+}
+
+bool DisplayLatency::frameSwapped(qint64 ns) {
+    if (m_lastSwapNs >= 0 && ns - m_lastSwapNs < kMaxIntervalNs) m_intervals.add(ns - m_lastSwapNs);
+    m_lastSwapNs = ns;
+    if (m_paintNs < 0) return false; // 不是我们绘制的帧 (例如窗口合成时的重绘)
+    m_delays.add(ns - m_paintNs);
+    m_paintNs = -1;
+
+    const double old = m_latencyMs;
+    m_swapDelayMs = m_delays.median() / 1e6;
+    m_intervalMs = m_intervals.count > 0 ? m_intervals.median() / 1e6 : m_nominalIntervalMs;
+    m_latencyMs = m_swapDelayMs + m_intervalMs;
+    return std::lround(old * 10) != std::lround(m_latencyMs * 10);
+}
+
+void DisplayLatency::reset() {
+    m_delays = Ring();
+    m_intervals = Ring();
+    m_paintNs = -1;
+    m_lastSwapNs = -1;
+    m_swapDelayMs = 0;
+    m_intervalMs = m_nominalIntervalMs;
+    m_latencyMs = 0;
+}
+
+void DisplayLatency::setNominalRefreshRate(double hz) {
+    if (hz <= 1) return;
+    m_nominalIntervalMs = 1000.0 / hz;
+    if (m_intervals.count == 0) m_intervalMs = m_nominalIntervalMs;
+}
@@ -0,0 +1,48 @@
+#ifndef DISPLAYLATENCY_H
+#define DISPLAYLATENCY_H
+
+#include <QtGlobal>
+#include <array>
+
+// 绘制到上屏的延迟估计：paintEvent 开始时记一次绘制时刻，frameSwapped 时记一次交换时刻。
+// 交换后的帧最早在下一次垂直同步时才显示，所以
+//     延迟 = 绘制 -> 交换 (最近若干帧的中位数) + 一个刷新间隔 (相邻两次交换间隔的中位数)
+// 用中位数而不是平均值：偶尔卡一帧不会把估计值拉偏。时间统一用纳秒 (同一个单调时钟)。
+class DisplayLatency {
+public:
+    static constexpr int kSamples = 64;
+    static constexpr qint64 kMaxIntervalNs = 50'000'000; // 超过 50ms 的交换间隔视为空闲，不计入刷新间隔
+
+    void framePainted(qint64 ns);
+    // 返回估计值是否有变化 (按 0.1ms 取整比较)
+    bool frameSwapped(qint64 ns);
+    void reset();
+
+    // 还没有样本时用屏幕的标称刷新率
+    void setNominalRefreshRate(double hz);
+
+    double latencyMs() const { return m_latencyMs; }
+    double swapDelayMs() const { return m_swapDelayMs; }
+    double frameIntervalMs() const { return m_intervalMs; }
+    bool hasSamples() const { return m_delays.count > 0; }
+
+private:
+    struct Ring {
+        std::array<qint64, kSamples> values{};
+        int count = 0;
+        int next = 0;
+        void add(qint64 v);
+        qint64 median() const;
+    };
+
+    Ring m_delays;
+    Ring m_intervals;
+    qint64 m_paintNs = -1;
+    qint64 m_lastSwapNs = -1;
+    double m_nominalIntervalMs = 1000.0 / 60.0;
+    double m_swapDelayMs = 0;
+    double m_intervalMs = 1000.0 / 60.0;
+    double m_latencyMs = 0;
+};
+
+#endif // DISPLAYLATENCY_H
@@ -1,11 +1,8 @@
 #include "GameWidget.h"
 #include <QPainter>
-#include <QFile>
-#include <QDir>
-#include <QFileInfo>
-#include <QTextStream>
 #include <QKeyEvent>
 #include <cmath>
+#include <algorithm>
 #include <QSettings>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -13,35 +10,110 @@
 #include <QStandardPaths>
 #include <QDebug>
 #include <QPainterPath>
+#include <QScreen>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrent>
+#include "HitErrors.h"
+#include "ChartPrefetcher.h"
+#include "AudioCache.h"
+#include "OsuParser.h"
+#include "ZipArchive.h"
+#include "Trace.h"
 
 GameWidget::GameWidget(QWidget *parent) : QOpenGLWidget(parent) { // 构造函数改为 QOpenGLWidget
     setFocusPolicy(Qt::StrongFocus);
 
-    // 初始化音频
-    m_player = new QMediaPlayer(this);
-    m_audioOutput = new QAudioOutput(this);
-    m_player->setAudioOutput(m_audioOutput);
+    // 加载谱面前按 4 键显示空轨道
+    m_engine = JudgeEngine::create(4);
+
+    // 初始化音频：直接播放缓存里的 PCM，解码在后台完成
+    m_player = new PcmPlayer(this);
+    connect(&m_audioWatcher, &QFutureWatcher<DecodedAudioPtr>::finished, this, [this]() {
+        applyAudio(m_audioWatcher.result());
+    });
 
     // 游戏循环定时器 (~60 FPS)
     m_timer = new QTimer(this);
     connect(m_timer, &QTimer::timeout, this, &GameWidget::gameLoop);
+
+    // 侧边栏统计在每个显示帧之后最多推送一次，密集连打时也不会每次按键都刷新界面；
+    // 交换时刻同时用来估计显示延迟
+    m_frameClock.start();
+    connect(this, &QOpenGLWidget::frameSwapped, this, [this]() {
+        if (m_latency.frameSwapped(m_frameClock.nsecsElapsed())) markStatsDirty();
+        publishStats(false);
+        if (m_retryTimer.isValid()) {
+            qDebug() << "Retry to first frame:" << m_retryTimer.nsecsElapsed() / 1000 << "us";
+            m_retryTimer.invalidate();
+        }
+        if (m_reloadApplied) {
+            qDebug() << "Hot reload, save to first frame:" << m_reloadLatency.elapsed() << "ms";
+            m_reloadApplied = false;
+            m_reloadLatency.invalidate();
+        }
+    });
     m_timer->start(4);
 
+    // 谱面热重载：文件变化 -> 去抖 -> 后台解析 [HitObjects] -> 比对并换入
+    connect(&m_chartWatcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path) {
+        if (path != m_chartPath) return;
+        // 很多编辑器先写临时文件再改名覆盖，原路径会从监视列表里掉出去：重新加上
+        rewatchChart();
+        if (!m_reloadLatency.isValid()) m_reloadLatency.start();
+        m_reloadTimer.start();
+    });
+    // 先删除再写入的编辑器 (vim 等) 触发 fileChanged 时新文件往往还不存在，上面加不回去；
+    // 所在目录也一起监视，文件重新出现时加回来并当作一次修改
+    connect(&m_chartWatcher, &QFileSystemWatcher::directoryChanged, this, [this]() {
+        if (!rewatchChart()) return;
+        if (!m_reloadLatency.isValid()) m_reloadLatency.start();
+        m_reloadTimer.start();
+    });
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(kReloadDebounceMs);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &GameWidget::startReload);
+    connect(&m_reloadWatcher, &QFutureWatcher<NoteListPtr>::finished, this, [this]() {
+        if (m_reloadQueued) {
+            m_reloadQueued = false;
+            startReload();
+            return;
+        }
+        if (m_reloadWatcher.future().resultCount() == 0) { // 换歌时取消的任务
+            m_reloadLatency.invalidate();
+            return;
+        }
+        const NoteListPtr notes = m_reloadWatcher.result();
+        if (notes && m_hasChart) applyReload(*notes);
+        if (!m_reloadApplied) m_reloadLatency.invalidate();
+    });
+
+    // 成绩后台写入
+    m_recordWriter = &RecordWriter::instance();
+    connect(m_recordWriter, &RecordWriter::recordSaved, this, &GameWidget::recordSaved);
+    connect(m_recordWriter, &RecordWriter::saveFailed, this, &GameWidget::recordSaveFailed);
+
     loadSettings();
 }
 
 qint64 GameWidget::getSmoothTime() const {
+    qint64 elapsed;
     if (m_preGameCountingDown) {
         // 在倒计时期间，实际游戏时间应该是负数，或者从0开始，这样Note才会在屏幕上方
         // smoothTime = 经过的时间 - 延迟时间 - 额外偏移
-        return m_visualTimer.elapsed() - (m_preGameStartTime + m_config.preGameDelay) - m_config.audioOffset;
+        elapsed = m_visualTimer.elapsed() - (m_preGameStartTime + m_config.preGameDelay) - m_config.audioOffset;
+    } else {
+        // 游戏开始后，就按照正常逻辑 (区间练习从 m_timeBase 开始计时)
+        elapsed = m_visualTimer.elapsed() - m_preGameStartTime - m_config.audioOffset;
     }
-    // 游戏开始后，就按照正常逻辑
-    return m_visualTimer.elapsed() - m_preGameStartTime - m_config.audioOffset;
+    // 计时器走的是实际时间，变速时换算成谱面时间
+    if (m_rate != 1.0) elapsed = std::llround(elapsed * m_rate);
+    return m_timeBase + elapsed;
 }
 
 void GameWidget::updateConfig(const GameConfig &config) {
     m_config = config;
+    m_engine->setWindow(m_config.judgeWindow);
     saveSettings();
 }
 
@@ -51,144 +123,387 @@ void GameWidget::resetGame() {
 
     m_preGameCountingDown = false;
     m_preGameStartTime = 0;
+    m_timeBase = 0;
 
-    m_score = 0; m_combo = 0; m_maxCombo = 0;
-    m_totalHits = 0; m_totalAccWeight = 0;
-
-    // 重置详细统计
-    m_countPerfect = 0;
-    m_countGreat = 0;
-    m_countGood = 0;
-    m_countMiss = 0;
+    // 重置物件状态和详细统计
+    m_engine->reset();
+    m_keysPressed.fill(false);
+    m_autoCursor = 0;
 
     m_lastJudgmentText = "";
 
-    for(auto &note : m_notes) {
-        note.isHit = false; note.isMissed = false;
-        note.isHolding = false;
+    // 通知 UI 清零 (立即推送，不等下一帧)
+    m_progressTime = 0;
+    markStatsDirty();
+    publishStats(true);
+}
+
+void GameWidget::loadBeatmap(const QString &filePath, const QString &recordKey) {
+    TRACE_SCOPE("game.loadBeatmap");
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+
+    resetGame();
+    m_hasChart = false;
+    m_practice = PracticeSection();
+    m_loopMark = -1;
+    m_engine->load({});
+    m_scroll.clear();
+    m_player->setAudio(nullptr);
+    m_sourceAudio = nullptr;
+    m_audioWatcher.setFuture(QFuture<DecodedAudioPtr>()); // 不再关心之前那首歌的解码结果
+    m_audioPending = false;
+
+    // 选歌界面已经在后台解析好的话直接拿来用，否则当场读取
+    PreparedChartPtr chart = ChartPrefetcher::instance().take(filePath);
+    const bool prefetched = (chart != nullptr);
+    if (!chart) chart = ChartPrefetcher::loadChart(filePath);
+    if (!chart) return;
+
+    watchChart(filePath);
+    m_chartEdited = false;
+
+    // 成绩主键：优先用扫描时缓存的内容哈希
+    m_currentRecordKey = recordKey.isEmpty() ? chart->info.getHash() : recordKey;
+
+    const BeatmapInfo &info = chart->info;
+    // 键数变化时换一个按该键数特化的引擎
+    if (m_engine->keyCount() != info.keyCount) m_engine = JudgeEngine::create(info.keyCount);
+    m_engine->setWindow(m_config.judgeWindow);
+    m_engine->setRate(m_rate);
+    m_engine->load(chart->notes); // 已按时间排序，滚动位置已预先算好
+    if (screen()) m_latency.setNominalRefreshRate(screen()->refreshRate());
+    m_autoInputs.clear();
+    if (m_autoplay) m_autoInputs = Autoplay::generate(m_engine->notes(), m_engine->keyCount());
+    m_autoCursor = 0;
+    m_scroll = chart->scroll;
+    m_currentTitle = info.title.isEmpty() ? QString("Unknown Title") : info.title;
+    m_currentArtist = info.artist.isEmpty() ? QString("Unknown Artist") : info.artist;
+    m_currentVersion = info.version;
+
+    const QString &audioPath = chart->audioPath;
+    if (!audioPath.isEmpty()) {
+        // 1. 获取最后一个 Note 的时间
+        m_lastNoteTime = 0;
+        for (const auto &note : m_engine->notes()) m_lastNoteTime = std::max(m_lastNoteTime, note.endTime);
+
+        // 2. 先设置一个保底时长 (最后 Note + 3秒)，拿到音频后再取两者最大值
+        m_songDuration = m_lastNoteTime + 3000;
+
+        // 3. 音频：同一首歌的其他难度 / 重来直接命中缓存；否则在倒计时期间后台解码
+        QFuture<DecodedAudioPtr> audio = AudioCache::instance().request(audioPath, true);
+        if (audio.isFinished()) {
+            applyAudio(audio.result());
+        } else {
+            m_audioPending = true;
+            m_audioWatcher.setFuture(audio);
+        }
+        qDebug() << AudioCache::instance().statsText();
+
+        m_hasChart = true;
+        startCountdown();
+
+        qDebug() << "Pre-game countdown started for" << m_config.preGameDelay << "ms.";
+        // === 发射信号：通知主窗口歌曲加载完毕 ===
+        emit songLoaded(m_currentTitle, m_currentArtist, m_songDuration);
+        qDebug() << "Game Started. Initial Duration:" << m_songDuration
+                 << "load:" << loadTimer.elapsed() << "ms" << (prefetched ? "(prefetched)" : "(cold)");
     }
+}
 
-    // 通知 UI 清零
-    emit statsChanged(0, 0, 0, 0, 0, 0, 0, 100.0);
-    emit progressChanged(0, 1);
+void GameWidget::startCountdown() {
+    m_visualTimer.restart(); // 视觉计时器开始跑，用于倒计时
+    m_preGameCountingDown = true; // 标记进入倒计时状态
+    m_preGameStartTime = m_visualTimer.elapsed(); // 记录倒计时开始时刻
+    m_isPlaying = false; // 游戏本身还没开始，只是在倒计时
 }
 
-void GameWidget::loadBeatmap(const QString &filePath) {
+void GameWidget::retry() {
+    if (!m_hasChart) return;
+    if (m_practice.active) {
+        // 练习中重开只回到区间开头
+        m_loopIteration = 0;
+        restartPracticeLoop();
+        return;
+    }
+    m_retryTimer.start();
+
+    // 停止播放并回到开头 (PCM 仍在内存里)、清空物件状态和统计；成绩不保存
     resetGame();
-    m_notes.clear();
+    m_player->setPosition(0);
+    startCountdown();
 
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return;
+    qDebug() << "Retry: state reset in" << m_retryTimer.nsecsElapsed() / 1000 << "us";
+    update();
+}
 
-    QTextStream in(&file);
-    bool inHitObjects = false;
-    QString audioFilename;
-    QDir dir = QFileInfo(filePath).absoluteDir();
+void GameWidget::startPractice(qint64 startMs, qint64 endMs) {
+    // 还在等解码时没法精确跳转，先不进入练习
+    if (!m_hasChart || m_audioPending || endMs <= startMs) return;
+
+    m_practice = {startMs, endMs, true};
+    m_loopMark = -1;
+    m_loopIteration = 0;
+
+    // 每列二分出区间边界，只统计区间内的物件 (不遍历整张谱)
+    m_engine->setRange(startMs, endMs);
+    m_practiceTailMs = endMs;
+    const std::vector<Note> &notes = m_engine->notes();
+    for (int c = 0; c < m_engine->keyCount(); ++c) {
+        const std::vector<int> &lane = m_engine->lane(c);
+        for (int k = m_engine->laneCursor(c); k < m_engine->laneEnd(c); ++k) {
+            m_practiceTailMs = std::max<qint64>(m_practiceTailMs, notes[lane[k]].endTime);
+        }
+    }
 
-    m_currentTitle = "Unknown Title";
-    m_currentArtist = "Unknown Artist";
+    qDebug() << "Practice section" << startMs << "-" << endMs << "ms," << m_engine->rangeJudgments() << "judgments";
+    emit practiceChanged(m_practice);
+    restartPracticeLoop();
+}
 
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
+void GameWidget::stopPractice() {
+    m_loopMark = -1;
+    if (!m_practice.active) return;
+    m_practice = PracticeSection();
+    m_engine->clearRange();
+    emit practiceChanged(m_practice);
+    retry(); // 回到整首歌的正常流程
+}
 
-        // 解析歌曲信息
-        if (line.startsWith("Title:")) m_currentTitle = line.mid(6).trimmed();
-        else if (line.startsWith("TitleUnicode:")) m_currentTitle = line.mid(13).trimmed(); // 优先用 Unicode
-        else if (line.startsWith("Artist:")) m_currentArtist = line.mid(7).trimmed();
-        else if (line.startsWith("ArtistUnicode:")) m_currentArtist = line.mid(14).trimmed();
-        else if (line.startsWith("Version:")) m_currentVersion = line.mid(8).trimmed();
+void GameWidget::markLoopStart() {
+    if (!m_isPlaying) return;
+    m_loopMark = std::max<qint64>(0, getSmoothTime());
+    PracticeSection pending;
+    pending.startMs = m_loopMark;
+    emit practiceChanged(pending);
+}
 
-        if (line.startsWith("AudioFilename:")) {
-            audioFilename = line.split(":").last().trimmed();
-        } else if (line == "[HitObjects]") {
-            inHitObjects = true;
-            continue;
-        }
+void GameWidget::markLoopEnd() {
+    if (!m_isPlaying || m_loopMark < 0) return;
+    startPractice(m_loopMark, getSmoothTime());
+}
 
-        if (inHitObjects && !line.isEmpty()) {
-            QStringList parts = line.split(',');
-            if (parts.size() > 2) {
-                double x = parts[0].toDouble();
-                int time = parts[2].toInt();
-                int type = parts[3].toInt(); // 读取 Type 字段
+void GameWidget::restartPracticeLoop() {
+    m_retryTimer.start();
 
-                int col = std::floor(x * 4 / 512);
-                col = std::max(0, std::min(col, 3));
+    // 只重置区间内的物件，区间之前的物件保持原状 (游标直接从区间开头开始)
+    m_engine->reset();
+    m_lastJudgmentText = "";
+    m_feedbackTimer = 0;
 
-                // === 解析长条逻辑 ===
-                bool isHold = (type & 128) != 0; // Bit 7 set = Hold Note
-                int endTime = time;
+    const qint64 from = std::max<qint64>(0, m_practice.startMs - kPracticeLeadInMs);
+    m_keysPressed.fill(false);
+    syncAutoplay(from);
+    resumeAt(from);
+    m_isPlaying = true;
 
-                if (isHold && parts.size() > 5) {
-                    // 长条格式: x,y,time,type,hitSound,endTime:extras
-                    QString extraPart = parts[5];
-                    endTime = extraPart.split(':').first().toInt();
-                }
+    m_progressTime = from;
+    markStatsDirty();
+    publishStats(true);
+    update();
+}
 
-                // 推入 vector
-                m_notes.push_back({col, time, endTime, isHold, false, false});
-            }
-        }
-    }
+void GameWidget::resumeAt(qint64 time) {
+    // 帧对齐的精确跳转：PCM 在内存里，只换读取位置，不重新解码 (变速音频的时间轴是谱面时间 / 倍率)
+    m_player->setPosition(std::llround(time / m_rate));
+    if (!m_player->isPlaying()) m_player->play();
 
-    std::sort(m_notes.begin(), m_notes.end(), [](const Note& a, const Note& b){
-        return a.time < b.time;
-    });
+    // 不走倒计时：视觉时间直接从跳转位置继续
+    m_preGameCountingDown = false;
+    m_timeBase = time;
+    m_visualTimer.restart();
+    m_preGameStartTime = m_visualTimer.elapsed();
+}
 
-    int totalJudgments = 0;
-    for (const auto& note : m_notes) {
-        totalJudgments++; // 头部
-        if (note.isHold) totalJudgments++; // 尾部
-    }
+void GameWidget::watchChart(const QString &path) {
+    const QStringList watched = m_chartWatcher.files() + m_chartWatcher.directories();
+    if (!watched.isEmpty()) m_chartWatcher.removePaths(watched);
+    m_reloadTimer.stop();
+    m_reloadQueued = false;
+    m_reloadApplied = false;
+    m_reloadLatency.invalidate();
+    m_reloadWatcher.setFuture(QFuture<NoteListPtr>()); // 上一首的解析结果不再需要
+
+    // .osz 包内的谱面不监视 (编辑器改的是解压出来的文件)
+    m_chartPath = ZipArchive::splitPath(path, nullptr, nullptr) ? QString() : path;
+    if (!m_chartPath.isEmpty()) m_chartWatcher.addPaths({m_chartPath, QFileInfo(m_chartPath).absolutePath()});
+}
 
-    m_maxPossibleScore = (totalJudgments == 0) ? 1 : totalJudgments * 300.0;
-    m_currentRawScore = 0;
-    m_score = 0;
+bool GameWidget::rewatchChart() {
+    if (m_chartPath.isEmpty() || m_chartWatcher.files().contains(m_chartPath)) return false;
+    if (!QFileInfo::exists(m_chartPath)) return false;
+    return m_chartWatcher.addPath(m_chartPath);
+}
 
-    // 音频加载逻辑
-    QString audioPath = dir.filePath(audioFilename);
-    if (!QFile::exists(audioPath)) {
-        QStringList filters; filters << "*.mp3" << "*.ogg" << "*.wav";
-        dir.setNameFilters(filters);
-        if (!dir.entryList().isEmpty()) audioPath = dir.filePath(dir.entryList().first());
+void GameWidget::startReload() {
+    if (m_chartPath.isEmpty() || !m_hasChart) return;
+    rewatchChart(); // 去抖期间文件可能刚被重新写出来
+    if (m_reloadWatcher.isRunning()) {
+        m_reloadQueued = true;
+        return;
     }
-    if (QFile::exists(audioPath)) {
-        m_player->setSource(QUrl::fromLocalFile(audioPath));
+    // 头部和时间点都沿用当前的：键数决定列映射，滚动索引给新物件算位置
+    const QString path = m_chartPath;
+    const int keyCount = m_engine->keyCount();
+    const ScrollIndex scroll = m_scroll;
+    m_reloadWatcher.setFuture(QtConcurrent::run([path, keyCount, scroll]() -> NoteListPtr {
+        TRACE_SCOPE("chart.hotReload");
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return nullptr;
+        const QByteArray bytes = file.readAll();
+        // 只解析 [HitObjects] 段；编辑器写到一半 (还没有这一段) 时等下一次变化
+        const qsizetype at = bytes.indexOf("[HitObjects]");
+        if (at < 0) return nullptr;
+        auto notes = std::make_shared<std::vector<Note>>();
+        OsuParser::parseHitObjects(QByteArray::fromRawData(bytes.constData() + at, bytes.size() - at), keyCount, *notes);
+        scroll.applyTo(*notes);
+        return notes;
+    }));
+}
 
-        // 1. 获取最后一个 Note 的时间
-        int lastNoteTime = m_notes.empty() ? 0 : m_notes.back().endTime;
-
-        // 2. 先设置一个保底时长 (最后 Note + 3秒)
-        m_songDuration = lastNoteTime + 3000;
-
-        // 3. 连接 duration 信号
-        disconnect(m_player, &QMediaPlayer::durationChanged, nullptr, nullptr);
-        connect(m_player, &QMediaPlayer::durationChanged, this, [this, lastNoteTime](qint64 dur){
-            if (dur > 0) {
-                // 取 音频时长 和 谱面结束+3s 的最大值
-                m_songDuration = std::max((qint64)lastNoteTime + 3000, dur);
-                qDebug() << "Duration Updated:" << m_songDuration;
-                emit songLoaded(m_currentTitle, m_currentArtist, m_songDuration);
-            }
-        });
+void GameWidget::applyReload(const std::vector<Note> &notes) {
+    TRACE_SCOPE("game.applyReload");
+    // 文件已经变了：选歌界面的预读缓存里那份是旧的
+    ChartPrefetcher::instance().invalidate(m_chartPath);
+    // 比对：两边都按 (时间, 列) 排序，去掉相同的前缀和后缀，剩下的就是改动的范围
+    const std::vector<Note> &old = m_engine->notes();
+    auto same = [](const Note &a, const Note &b) {
+        return a.time == b.time && a.column == b.column && a.endTime == b.endTime && a.isHold == b.isHold;
+    };
+    const size_t common = std::min(old.size(), notes.size());
+    size_t prefix = 0;
+    while (prefix < common && same(old[prefix], notes[prefix])) ++prefix;
+    size_t suffix = 0;
+    while (suffix < common - prefix && same(old[old.size() - 1 - suffix], notes[notes.size() - 1 - suffix])) ++suffix;
+    const int removed = int(old.size() - prefix - suffix);
+    const int added = int(notes.size() - prefix - suffix);
+    if (removed == 0 && added == 0) {
+        qDebug() << "Hot reload: hit objects unchanged";
+        return;
+    }
+    qint64 firstChange = std::numeric_limits<qint64>::max();
+    if (prefix < old.size()) firstChange = old[prefix].time;
+    if (prefix < notes.size()) firstChange = std::min<qint64>(firstChange, notes[prefix].time);
+
+    // 游戏中从恢复点继续：回退时跳到改动处之前几秒。恢复点之前的新物件视为已跳过
+    const qint64 now = getSmoothTime();
+    qint64 resume = now;
+    if (m_config.reloadRewind) resume = std::max<qint64>(0, std::min(now, firstChange) - kReloadRewindMs);
+    const bool live = m_isPlaying && !m_practice.active;
+
+    // 只换改动的那一段，其余物件的判定状态和分数 / 连击都保留
+    m_chartEdited = true;
+    m_engine->splice(int(prefix), removed, std::vector<Note>(notes.begin() + prefix, notes.end() - suffix),
+                     live ? resume : std::numeric_limits<qint64>::min());
+    m_lastNoteTime = 0;
+    for (const Note &note : notes) m_lastNoteTime = std::max(m_lastNoteTime, note.endTime);
+    m_songDuration = std::max<qint64>(m_songDuration, m_lastNoteTime + 3000);
+    m_autoInputs.clear();
+    if (m_autoplay) m_autoInputs = Autoplay::generate(m_engine->notes(), m_engine->keyCount());
+    m_autoCursor = 0;
+
+    if (m_practice.active) {
+        // 练习中：按新物件重新划定区间，从区间开头再来
+        startPractice(m_practice.startMs, m_practice.endMs);
+    } else if (live) {
+        if (resume != now) resumeAt(resume);
+        syncAutoplay(resume);
+    }
+    // 倒计时中 / 已结束：新物件已经装好，开始时就是整首
+
+    m_reloadApplied = true;
+    const qint64 latency = m_reloadLatency.isValid() ? m_reloadLatency.elapsed() : 0;
+    qDebug() << "Hot reload:" << removed << "removed," << added << "added from" << firstChange << "ms, applied in" << latency << "ms";
+    emit chartReloaded(firstChange, removed, added, latency);
+    markStatsDirty();
+    update();
+}
 
-        m_visualTimer.restart(); // 视觉计时器开始跑，用于倒计时
-        m_preGameCountingDown = true; // 标记进入倒计时状态
-        m_preGameStartTime = m_visualTimer.elapsed(); // 记录倒计时开始时刻
-        m_isPlaying = false; // 游戏本身还没开始，只是在倒计时
+void GameWidget::setRate(double rate) {
+    rate = std::clamp(rate, 0.5, 2.0);
+    if (std::abs(rate - m_rate) < 0.005) return;
+    m_rate = rate;
+    m_engine->setRate(rate);
+    if (!m_hasChart) return;
 
-        qDebug() << "Pre-game countdown started for" << m_config.preGameDelay << "ms.";
-        // === 发射信号：通知主窗口歌曲加载完毕 ===
-        emit songLoaded(m_currentTitle, m_currentArtist, m_songDuration);
-        qDebug() << "Game Started. Initial Duration:" << m_songDuration;
+    // 原速 PCM 还在解码的话，解码完成后 applyAudio 会接着要变速版本
+    if (m_sourceAudio) requestRateAudio();
+    retry();
+}
+
+void GameWidget::setAutoplay(bool enabled) {
+    if (enabled == m_autoplay) return;
+    m_autoplay = enabled;
+    if (m_autoplay && m_autoInputs.empty()) m_autoInputs = Autoplay::generate(m_engine->notes(), m_engine->keyCount());
+    if (!m_hasChart) return;
+    retry(); // 一局里不混合真人和自动的输入
+}
+
+void GameWidget::setLatencyCompensation(bool enabled) {
+    if (enabled == m_config.latencyCompensation) return;
+    m_config.latencyCompensation = enabled;
+    saveSettings();
+    markStatsDirty();
+    update();
+}
+
+void GameWidget::syncAutoplay(qint64 time) {
+    m_autoCursor = size_t(std::lower_bound(m_autoInputs.begin(), m_autoInputs.end(), time,
+                                           [](const AutoplayInput &in, qint64 t) { return in.time < t; })
+                          - m_autoInputs.begin());
+}
+
+void GameWidget::playAutoplay(qint64 time) {
+    const size_t from = m_autoCursor;
+    Autoplay::feed(*m_engine, m_autoInputs, &m_autoCursor, time, [this](qint64, Judgment judgment) {
+        showJudgment(judgment, judgment == Judgment::Perfect ? 30 : 20);
+    });
+    // 按键灯跟着输入走
+    for (size_t i = from; i < m_autoCursor; ++i) m_keysPressed[m_autoInputs[i].column] = m_autoInputs[i].press;
+}
+
+void GameWidget::requestRateAudio() {
+    QFuture<DecodedAudioPtr> audio = AudioCache::instance().requestStretched(m_sourceAudio, m_rate);
+    if (audio.isFinished()) {
+        applyAudio(audio.result());
+    } else {
+        // 渲染期间不放旧倍率的声音，倒计时会停在最后等它
+        m_audioPending = true;
+        m_player->setAudio(nullptr);
+        m_audioWatcher.setFuture(audio);
     }
 }
 
+void GameWidget::applyAudio(const DecodedAudioPtr &audio) {
+    if (audio && audio->rate == 1.0) m_sourceAudio = audio;
+    // 拿到的不是当前倍率的版本 (原速刚解码完 / 渲染期间又换了倍率)：再去要对应的版本
+    if (audio && std::abs(audio->rate - m_rate) >= 0.005) {
+        requestRateAudio();
+        return;
+    }
+
+    m_audioPending = false;
+    m_player->setAudio(audio);
+    if (!audio) return; // 解码失败：没有声音，但谱面照常进行
+
+    // 时长按谱面时间计
+    m_songDuration = std::max<qint64>(m_lastNoteTime + 3000, std::llround(audio->durationMs * audio->rate));
+    qDebug() << "Duration Updated:" << m_songDuration;
+    emit songLoaded(m_currentTitle, m_currentArtist, m_songDuration);
+    // 练习中途换了音频 (setAudio 会回到开头)：重新跳到区间开头
+    if (m_practice.active && m_isPlaying) restartPracticeLoop();
+}
+
 void GameWidget::gameLoop() {
+    TRACE_SCOPE("game.tick");
     // 1. 处理倒计时状态
     if (m_preGameCountingDown) {
         qint64 elapsedSinceCountdownStart = m_visualTimer.elapsed() - m_preGameStartTime;
-        if (elapsedSinceCountdownStart >= m_config.preGameDelay) {
+        // 第一次玩的歌可能还在解码：倒计时停在最后，等解码完再开始
+        if (elapsedSinceCountdownStart >= m_config.preGameDelay && m_audioPending) {
+            m_preGameStartTime = m_visualTimer.elapsed() - m_config.preGameDelay;
+        }
+        else if (elapsedSinceCountdownStart >= m_config.preGameDelay) {
             // 倒计时结束，真正开始游戏！
             m_preGameCountingDown = false;
             m_isPlaying = true; // 游戏正式开始
@@ -212,14 +527,22 @@ void GameWidget::gameLoop() {
 
     qint64 audioTime = m_player->position();
     qint64 currentTime = getSmoothTime();
+    TRACE_COUNTER("game.audioDriftMs", audioTime - currentTime);
 
     bool timeIsUp = (m_songDuration > 0 && currentTime > m_songDuration + 1000);
-    bool playerStopped = (currentTime > 1000 && m_player->playbackState() == QMediaPlayer::StoppedState);
-
-
-    if (timeIsUp || playerStopped) {
+    bool playerStopped = (currentTime > 1000 && m_player->hasAudio() && !m_player->isPlaying());
+
+    // 区间练习：最后一个判定的 Miss 窗口过去后结算这一轮，马上从区间开头再来
+    if (m_practice.active) {
+        if (currentTime > m_practiceTailMs + m_engine->span().miss) {
+            m_engine->sweep(currentTime);
+            emit practiceLoopFinished(++m_loopIteration, currentStats());
+            restartPracticeLoop();
+            return;
+        }
+    } else if (timeIsUp || playerStopped) {
         qDebug() << "Game Over Triggered! Time:" << currentTime << "Duration:" << m_songDuration;
-        saveRecord();
+        if (!m_autoplay && !m_chartEdited) saveRecord();
         m_isPlaying = false;
         m_player->stop();
         update();
@@ -230,55 +553,17 @@ void GameWidget::gameLoop() {
     if (m_songDuration > 0 && displayTime > m_songDuration) {
         displayTime = m_songDuration;
     }
-    if (m_songDuration > 0) {
-        emit progressChanged(displayTime, m_songDuration);
+    if (m_songDuration > 0 && displayTime != m_progressTime) {
+        m_progressTime = displayTime;
+        markStatsDirty(); // 进度只记下来，和其他统计一起在帧结束时推送
     }
 
-    bool statsUpdated = false; // 标记本帧是否有状态改变
-
-    // 遍历所有 Note 进行状态检查
-    for (auto &note : m_notes) {
-        if (note.isMissed) continue;
+    // 自动游玩：把到期的输入按准确时间送进引擎 (要在 sweep 之前，否则到期的物件会先被判 Miss)
+    if (m_autoplay) playAutoplay(currentTime);
 
-        // 1. 检查头部 Miss
-        if (!note.isHit) {
-            if (currentTime > note.time + m_config.judgeWindow.miss) {
-                note.isMissed = true;
-                m_combo = 0;
-                m_countMiss++;
-                m_totalHits++;
-                m_lastJudgmentText = "MISS";
-                m_lastJudgmentColor = Qt::red;
-                m_feedbackTimer = 20;
-                calculateScore(0);
-
-                statsUpdated = true; // === 标记需要更新 UI ===
-            }
-        }
-        // 2. 检查长条 Over-hold
-        else if (note.isHold && note.isHolding) {
-            if (currentTime > note.endTime + m_config.judgeWindow.miss) {
-                note.isHolding = false;
-                note.isMissed = true;
-                m_combo = 0;
-                m_countMiss++;
-                m_totalHits++;
-                m_lastJudgmentText = "MISS (Overhold)";
-                m_lastJudgmentColor = Qt::red;
-                m_feedbackTimer = 20;
-                calculateScore(0);
-
-                statsUpdated = true; // === 标记需要更新 UI ===
-            }
-        }
-    }
-
-    // === 修复 1: 如果检测到 Miss，立即更新左侧面板 ===
-    if (statsUpdated) {
-        double acc = (m_totalHits == 0) ? 100.0 : (m_totalAccWeight / m_totalHits) * 100.0;
-        // 修改：带上 m_maxCombo
-        emit statsChanged(m_countPerfect, m_countGreat, m_countGood, m_countMiss, m_combo, m_maxCombo, m_score, acc);
-    }
+    // 每列只看游标处的物件：头部 Miss 和长条 Over-hold
+    Judgment judgment = m_engine->sweep(currentTime);
+    if (judgment != Judgment::None) showJudgment(judgment, 20);
 
     update();
 }
@@ -291,130 +576,199 @@ void GameWidget::keyPressEvent(QKeyEvent *event) {
     }
 
     if (event->isAutoRepeat()) return;
+    TRACE_SCOPE("input.press");
 
-    int colTriggered = -1;
-    for (int i = 0; i < 4; ++i) {
-        if (event->key() == m_config.keyMapping[i]) {
-            m_keysPressed[i] = true;
-            colTriggered = i;
-            break;
+    int colTriggered = columnForKey(event->key());
+    // 重开键和轨道键冲突时以轨道为准
+    if (colTriggered == -1 && event->key() == m_config.retryKey) {
+        retry();
+        return;
+    }
+    if (colTriggered == -1) {
+        switch (event->key()) {
+        case Qt::Key_BracketLeft: markLoopStart(); return;
+        case Qt::Key_BracketRight: markLoopEnd(); return;
+        case Qt::Key_Backslash: stopPractice(); return;
         }
     }
+    if (colTriggered != -1 && m_autoplay) return; // 自动游玩时轨道键不起作用
+    if (colTriggered != -1) m_keysPressed[colTriggered] = true;
 
     if (colTriggered != -1 && m_isPlaying) {
-        checkHit(colTriggered);
+        // 空按不改变统计，不需要刷新
+        Judgment judgment = m_engine->press(colTriggered, getSmoothTime());
+        if (judgment != Judgment::None) showJudgment(judgment, 30);
     }
     update();
 }
 
 void GameWidget::keyReleaseEvent(QKeyEvent *event) {
     if (event->isAutoRepeat()) return;
+    TRACE_SCOPE("input.release");
 
-    int colTriggered = -1;
-    for (int i = 0; i < 4; ++i) {
-        if (event->key() == m_config.keyMapping[i]) {
-            m_keysPressed[i] = false;
-            colTriggered = i;
-            break;
-        }
-    }
+    int colTriggered = columnForKey(event->key());
+    if (colTriggered != -1 && m_autoplay) return;
+    if (colTriggered != -1) m_keysPressed[colTriggered] = false;
 
     // === 新增：松手判定 ===
     if (colTriggered != -1 && m_isPlaying) {
-        checkRelease(colTriggered); // 检测长条尾部
+        // 检测长条尾部
+        Judgment judgment = m_engine->release(colTriggered, getSmoothTime());
+        if (judgment != Judgment::None) showJudgment(judgment, 20);
     }
     update();
 }
 
-void GameWidget::checkHit(int col) {
-    qint64 currentTime = getSmoothTime();
+int GameWidget::columnForKey(int key) const {
+    const int keyCount = m_engine->keyCount();
+    const KeyLayout &keys = m_config.keysFor(keyCount);
+    for (int i = 0; i < keyCount; ++i) {
+        if (key == keys[i]) return i;
+    }
+    return -1;
+}
 
-    Note* target = nullptr;
-    int minDiff = 10000;
-
-    for (auto &note : m_notes) {
-        // 找最近的、没打过的、没 Miss 的
-        if (note.column == col && !note.isHit && !note.isMissed) {
-            int diff = std::abs(note.time - (int)currentTime);
-            if (diff <= m_config.judgeWindow.miss) {
-                if (diff < minDiff) {
-                    minDiff = diff;
-                    target = &note;
-                }
-            }
-        }
+void GameWidget::showJudgment(Judgment judgment, int frames) {
+    switch (judgment) {
+    case Judgment::Perfect:
+        m_lastJudgmentText = "PERFECT";
+        m_lastJudgmentColor = QColor(0, 255, 255);
+        break;
+    case Judgment::Great:
+        m_lastJudgmentText = "GREAT";
+        m_lastJudgmentColor = Qt::green;
+        break;
+    case Judgment::Good:
+        m_lastJudgmentText = "GOOD";
+        m_lastJudgmentColor = Qt::blue;
+        break;
+    case Judgment::Bad:
+        m_lastJudgmentText = "BAD";
+        m_lastJudgmentColor = Qt::darkRed;
+        break;
+    case Judgment::Miss:
+        m_lastJudgmentText = "MISS";
+        m_lastJudgmentColor = Qt::red;
+        break;
+    case Judgment::MissEarly:
+        m_lastJudgmentText = "MISS (Early)";
+        m_lastJudgmentColor = Qt::red;
+        break;
+    case Judgment::MissOverhold:
+        m_lastJudgmentText = "MISS (Overhold)";
+        m_lastJudgmentColor = Qt::red;
+        break;
+    case Judgment::None:
+        return;
     }
+    m_feedbackTimer = frames;
+    markStatsDirty();
+}
 
-    if (target) {
-        target->isHit = true; // 头部被击中
+// 轨道颜色：左右交替白 / 金，奇数键的中间列单独用粉色
+template <int K>
+static constexpr std::array<QRgb, K> laneColors() {
+    std::array<QRgb, K> colors{};
+    for (int i = 0; i < K; ++i) {
+        if (K % 2 == 1 && i == K / 2) colors[i] = qRgb(255, 105, 180);
+        else colors[i] = (i % 2 == 0) ? qRgb(240, 240, 240) : qRgb(255, 215, 0);
+    }
+    return colors;
+}
 
-        if (target->isHold) {
-            target->isHolding = true; //如果是长条，标记为“正在按住”
+template <int K>
+void GameWidget::paintLanes(QPainter &p, double judgmentY) {
+    const int h = height();
+    const double colWidth = width() / double(K);
+    for (int i = 0; i < K; ++i) {
+        double x = i * colWidth;
+        // 按键高亮
+        if (m_keysPressed[i]) {
+            p.fillRect(QRectF(x, 0, colWidth, h), QColor(255, 255, 255, 40));
+            p.fillRect(QRectF(x, judgmentY, colWidth, h - judgmentY), QColor(255, 255, 255, 180));
         }
+        // 轨道线
+        p.setPen(QColor(60, 60, 60));
+        p.drawLine(x, 0, x, h);
+    }
+}
 
-        m_combo++;
-
-        if (m_combo > m_maxCombo) m_maxCombo = m_combo;
-        m_totalHits++;
-
-        int weight = 0;
-        if (minDiff <= m_config.judgeWindow.perfect) {
-            weight = 300;
-            m_countPerfect++;
-            m_lastJudgmentText = "PERFECT";
-            m_lastJudgmentColor = QColor(0, 255, 255);
-            m_totalAccWeight += 1.0;
-        } else if (minDiff <= m_config.judgeWindow.great) {
-            weight = 200;
-            m_countGreat++;
-            m_lastJudgmentText = "GREAT";
-            m_lastJudgmentColor = Qt::green;
-            m_totalAccWeight += 0.8;
-        } else if (minDiff <= m_config.judgeWindow.good) {
-            weight = 50;
-            m_countGood++;
-            m_lastJudgmentText = "GOOD";
-            m_lastJudgmentColor = Qt::blue;
-            m_totalAccWeight += 0.5;
-        } else {
-            weight = 0;
-            m_combo = 0;
-            m_countMiss++; // Bad 视为断连但给了0分
-            m_lastJudgmentText = "BAD";
-            m_lastJudgmentColor = Qt::darkRed;
+template <int K>
+void GameWidget::paintNotes(QPainter &p, double judgmentY, qint64 smoothTime) {
+    static constexpr std::array<QRgb, K> kColors = laneColors<K>();
+    const int h = height();
+    const double colWidth = width() / double(K);
+    const int noteHeight = 30;
+    const std::vector<Note> &notes = m_engine->notes();
+    // 当前滚动位置：每帧一次二分 + 插值；物件位置已预先积分好，下面每个物件只需一次减法和乘法
+    const double nowPos = m_scroll.positionAt(double(smoothTime));
+    const double speed = m_config.scrollSpeed;
+    p.setPen(Qt::NoPen);
+
+    // 长条：头部 (正在按住时固定在判定线)、身体、尾部
+    auto drawHold = [&](const Note &note, double x, const QColor &color) {
+        // 计算头部 Y 坐标：倒计时期间 smoothTime 是负数，y 很小 (在屏幕上方)，
+        // 随着 smoothTime 趋向 0，y 会慢慢变大，产生"下坠"效果
+        double yTail = judgmentY - (note.tailPos - nowPos) * speed;
+        double yHead = note.isHolding ? judgmentY : judgmentY - (note.headPos - nowPos) * speed;
+        if (yTail > h) return;
+
+        double bodyH = yHead - yTail;
+        if (bodyH > 0) {
+            QColor bodyColor = color;
+            bodyColor.setAlpha(180);
+            p.setBrush(bodyColor);
+            p.drawRect(QRectF(x + 10, yTail, colWidth - 20, bodyH));
+        }
+        p.setBrush(color);
+        if (!note.isHolding) p.drawRect(QRectF(x + 2, yHead - noteHeight, colWidth - 4, noteHeight));
+        p.drawRect(QRectF(x + 2, yTail, colWidth - 4, 5));
+    };
+
+    for (int c = 0; c < K; ++c) {
+        const double x = c * colWidth;
+        const QColor color = QColor::fromRgb(kColors[c]);
+
+        // 正在按住的长条已经不在游标之后了，单独画
+        const int holding = m_engine->laneHolding(c);
+        if (holding >= 0) drawHold(notes[holding], x, color);
+
+        // 从游标开始往上画，头部超出屏幕上沿或到了区间末尾就停 (同一列后面的物件只会更靠上)
+        const std::vector<int> &lane = m_engine->lane(c);
+        for (int k = m_engine->laneCursor(c); k < m_engine->laneEnd(c); ++k) {
+            const Note &note = notes[lane[k]];
+            if (note.isMissed || note.isHit) continue;
+
+            double y = judgmentY - (note.headPos - nowPos) * speed;
+            if (y < 0) break; // SV 不会为负，位置随时间单调
+
+            if (note.isHold) {
+                drawHold(note, x, color);
+            } else {
+                if (y > h + 50) continue; // 视口优化
+                p.setBrush(color);
+                p.drawRect(QRectF(x + 2, y - noteHeight, colWidth - 4, noteHeight));
+            }
         }
-        calculateScore(weight);
-        m_feedbackTimer = 30;
     }
-
-    double acc = (m_totalHits == 0) ? 100.0 : (m_totalAccWeight / m_totalHits) * 100.0;
-    emit statsChanged(m_countPerfect, m_countGreat, m_countGood, m_countMiss, m_combo, m_maxCombo, m_score, acc);
 }
 
 void GameWidget::paintEvent(QPaintEvent *event) {
+    TRACE_SCOPE("game.paint");
+    m_latency.framePainted(m_frameClock.nsecsElapsed());
     QPainter p(this);
     p.setRenderHint(QPainter::Antialiasing);
     p.fillRect(rect(), Qt::black);
 
     int w = width();
     int h = height();
-    double colWidth = w / 4.0;
     double judgmentY = h * 0.85;
+    const int keyCount = m_engine->keyCount();
 
     // ==========================================
     // 1. 始终绘制轨道和判定线 (作为背景)
     // ==========================================
-    for (int i = 0; i < 4; ++i) {
-        double x = i * colWidth;
-        // 按键高亮
-        if (m_keysPressed[i]) {
-            p.fillRect(QRectF(x, 0, colWidth, h), QColor(255, 255, 255, 40));
-            p.fillRect(QRectF(x, judgmentY, colWidth, h - judgmentY), QColor(255, 255, 255, 180));
-        }
-        // 轨道线
-        p.setPen(QColor(60, 60, 60));
-        p.drawLine(x, 0, x, h);
-    }
+    withKeyCount(keyCount, [&](auto k) { paintLanes<decltype(k)::value>(p, judgmentY); });
     // 判定线
     p.setPen(QPen(Qt::red, 2));
     p.drawLine(0, judgmentY, w, judgmentY);
@@ -434,71 +788,15 @@ void GameWidget::paintEvent(QPaintEvent *event) {
     // 如果是倒计时期间，getSmoothTime() 会返回负数 (例如 -2000 到 0)
     // 这样 Note 就会根据计算绘制在屏幕上方，并随着时间推移自然下落
     qint64 smoothTime = getSmoothTime();
+    // 这一帧要再过 displayLatencyMs 才上屏：按那时的时间摆放物件 (实际毫秒换算成谱面时间)
+    if (m_config.latencyCompensation) smoothTime += std::llround(m_latency.latencyMs() * m_rate);
+    TRACE_COUNTER("game.displayLatencyUs", m_latency.latencyMs() * 1000);
 
     // ==========================================
     // 4. 绘制 Note (即使在倒计时期间也绘制)
     // ==========================================
-    int noteHeight = 30;
-    QColor colors[4] = {QColor(240,240,240), QColor(255,215,0), QColor(240,240,240), QColor(255,215,0)};
-
-    for (const auto &note : m_notes) {
-        if (note.isMissed) continue;
-        if (note.isHit && !note.isHold) continue;
-        if (note.isHit && note.isHold && !note.isHolding) continue;
-
-        double x = note.column * colWidth;
-
-        // 计算头部 Y 坐标
-        // 在倒计时期间，smoothTime 是负数。
-        // 假设 diff = note.time - (-2000) = note.time + 2000 (很大)
-        // y = judgmentY - (diff * speed) (很小，甚至负无穷，即在屏幕上方)
-        // 随着 smoothTime 趋向 0，y 会慢慢变大，产生“下坠”效果。
-
-        if (note.isHold) {
-            double diffEnd = note.endTime - smoothTime;
-            double yTail = judgmentY - (diffEnd * m_config.scrollSpeed);
-            double yHead;
-
-            if (note.isHolding) {
-                yHead = judgmentY;
-            } else {
-                double diffHead = note.time - smoothTime;
-                yHead = judgmentY - (diffHead * m_config.scrollSpeed);
-            }
-
-            // 宽松的视口优化：只要有一部分在屏幕附近就画
-            // yHead < -1000 表示还在屏幕上方很远的地方，暂时不画，节省性能
-            if (yTail > h || yHead < -2000) continue;
-
-            double bodyH = yHead - yTail;
-            if (bodyH > 0) {
-                QColor bodyColor = colors[note.column];
-                bodyColor.setAlpha(180);
-                p.setBrush(bodyColor);
-                p.setPen(Qt::NoPen);
-                p.drawRect(QRectF(x + 10, yTail, colWidth - 20, bodyH));
-            }
-
-            if (!note.isHolding) {
-                p.setBrush(colors[note.column]);
-                p.drawRect(QRectF(x + 2, yHead - noteHeight, colWidth - 4, noteHeight));
-            }
-            p.setBrush(colors[note.column]);
-            p.drawRect(QRectF(x + 2, yTail, colWidth - 4, 5));
-
-        } else {
-            // 普通 Note
-            double diff = note.time - smoothTime;
-            double y = judgmentY - (diff * m_config.scrollSpeed);
-
-            // 视口优化
-            if (y > h + 50 || y < -2000) continue;
-
-            p.setBrush(colors[note.column]);
-            p.setPen(Qt::NoPen);
-            p.drawRect(QRectF(x + 2, y - noteHeight, colWidth - 4, noteHeight));
-        }
-    }
+    // 每列从游标开始画，已判定的物件不再遍历
+    withKeyCount(keyCount, [&](auto k) { paintNotes<decltype(k)::value>(p, judgmentY, smoothTime); });
 
     // ==========================================
     // 5. 绘制 HUD (分数、Combo、评级)
@@ -510,14 +808,32 @@ void GameWidget::paintEvent(QPaintEvent *event) {
     fontScore.setBold(true);
     p.setFont(fontScore);
     p.setPen(Qt::white);
-    QString scoreText = QString("%1").arg(m_score, 7, 10, QChar('0'));
+    const ScoreState &score = m_engine->score();
+    QString scoreText = QString("%1").arg(score.score, 7, 10, QChar('0'));
     p.drawText(QRect(0, 10, w, 50), Qt::AlignCenter, scoreText);
 
+    if (m_rate != 1.0) {
+        QFont fontRate = fontScore;
+        fontRate.setPointSize(14);
+        p.setFont(fontRate);
+        p.setPen(QColor(255, 200, 0));
+        p.drawText(QRect(10, 10, w - 20, 30), Qt::AlignLeft | Qt::AlignTop, QString("%1x").arg(m_rate));
+        p.setFont(fontScore);
+    }
+    if (m_autoplay) {
+        QFont fontAuto = fontScore;
+        fontAuto.setPointSize(14);
+        p.setFont(fontAuto);
+        p.setPen(QColor(120, 200, 255));
+        p.drawText(QRect(10, 10, w - 20, 30), Qt::AlignRight | Qt::AlignTop, "AUTO");
+        p.setFont(fontScore);
+    }
+
     QFont fontGrade = fontScore;
     fontGrade.setPointSize(40);
     fontGrade.setItalic(true);
     p.setFont(fontGrade);
-    QString grade = getGrade();
+    QString grade = score.grade();
     QColor gradeColor = Qt::gray;
     if (grade == "S") gradeColor = QColor(255, 215, 0);
     else if (grade == "A") gradeColor = Qt::green;
@@ -525,13 +841,13 @@ void GameWidget::paintEvent(QPaintEvent *event) {
     p.setPen(gradeColor);
     p.drawText(QRect(0, 60, w, 60), Qt::AlignCenter, grade);
 
-    if (m_combo > 0) {
+    if (score.combo > 0) {
         QFont fontCombo = p.font();
         fontCombo.setPointSize(40);
         fontCombo.setBold(true);
         p.setFont(fontCombo);
         p.setPen(QColor(255, 255, 255, 60));
-        p.drawText(rect(), Qt::AlignCenter, QString::number(m_combo));
+        p.drawText(rect(), Qt::AlignCenter, QString::number(score.combo));
     }
 
     // ==========================================
@@ -539,7 +855,7 @@ void GameWidget::paintEvent(QPaintEvent *event) {
     // ==========================================
     if (m_preGameCountingDown) {
         qint64 timeLeft = m_config.preGameDelay - (m_visualTimer.elapsed() - m_preGameStartTime);
-        int secondsLeft = (timeLeft / 1000) + 1;
+        int secondsLeft = std::max<qint64>(1, (timeLeft / 1000) + 1); // 等待解码时停在 1
 
         QFont countdownFont = p.font();
         countdownFont.setFamily("Arial");
@@ -576,16 +892,27 @@ void GameWidget::loadSettings() {
 
     m_config.songFolder = settings.value("songFolder", "").toString();
     m_config.audioOffset = settings.value("audioOffset", 0).toInt();
+    m_config.hudRefreshMs = settings.value("hudRefreshMs", 16).toInt();
+    m_config.retryKey = settings.value("retryKey", (int)Qt::Key_QuoteLeft).toInt();
+    m_config.latencyCompensation = settings.value("latencyCompensation", true).toBool();
+    m_config.reloadRewind = settings.value("reloadRewind", true).toBool();
 
     m_config.judgeWindow.perfect = settings.value("judge_perfect", 40).toInt();
     m_config.judgeWindow.great = settings.value("judge_great", 80).toInt();
     m_config.judgeWindow.good = settings.value("judge_good", 120).toInt();
     m_config.judgeWindow.miss = settings.value("judge_miss", 150).toInt();
 
-    m_config.keyMapping[0] = settings.value("key1", (int)Qt::Key_D).toInt();
-    m_config.keyMapping[1] = settings.value("key2", (int)Qt::Key_F).toInt();
-    m_config.keyMapping[2] = settings.value("key3", (int)Qt::Key_J).toInt();
-    m_config.keyMapping[3] = settings.value("key4", (int)Qt::Key_K).toInt();
+    // 4K 沿用旧的 key1 ~ key4，其他键数存成 "keys7K" = "83,68,..."
+    for (int k = 1; k <= kMaxKeyCount; ++k) {
+        KeyLayout &keys = m_config.keysFor(k);
+        if (k == 4) {
+            for (int i = 0; i < 4; ++i) keys[i] = settings.value(QString("key%1").arg(i + 1), keys[i]).toInt();
+            continue;
+        }
+        const QStringList saved = settings.value(QString("keys%1K").arg(k)).toString().split(',', Qt::SkipEmptyParts);
+        if (saved.size() != k) continue; // 没保存过 / 格式不对：用默认键位
+        for (int i = 0; i < k; ++i) keys[i] = saved[i].toInt();
+    }
 }
 
 void GameWidget::saveSettings() {
@@ -596,106 +923,55 @@ void GameWidget::saveSettings() {
 
     settings.setValue("songFolder", m_config.songFolder);
     settings.setValue("audioOffset", m_config.audioOffset);
+    settings.setValue("hudRefreshMs", m_config.hudRefreshMs);
+    settings.setValue("retryKey", m_config.retryKey);
+    settings.setValue("latencyCompensation", m_config.latencyCompensation);
+    settings.setValue("reloadRewind", m_config.reloadRewind);
 
     settings.setValue("judge_perfect", m_config.judgeWindow.perfect);
     settings.setValue("judge_great", m_config.judgeWindow.great);
     settings.setValue("judge_good", m_config.judgeWindow.good);
     settings.setValue("judge_miss", m_config.judgeWindow.miss);
 
-    settings.setValue("key1", m_config.keyMapping[0]);
-    settings.setValue("key2", m_config.keyMapping[1]);
-    settings.setValue("key3", m_config.keyMapping[2]);
-    settings.setValue("key4", m_config.keyMapping[3]);
-}
-
-void GameWidget::checkRelease(int col) {
-    qint64 currentTime = getSmoothTime();
-
-    // 寻找该列正在被按住的长条
-    for (auto &note : m_notes) {
-        if (note.column == col && note.isHold && note.isHolding && !note.isMissed) {
-
-            // 计算松手时间与结束时间的差值
-            int diff = std::abs(note.endTime - (int)currentTime);
-
-            // === 1. 松手太早 (Early Release) ===
-            // 如果还没进入 Miss 窗口就松手了
-            if ((int)currentTime < note.endTime - m_config.judgeWindow.miss) {
-                note.isHolding = false;
-                note.isMissed = true; // 标记为 Miss
-
-                m_combo = 0;
-                m_countMiss++; // 增加 Miss 计数
-                m_totalHits++;
-                m_lastJudgmentText = "MISS (Early)";
-                m_lastJudgmentColor = Qt::red;
-                m_feedbackTimer = 20;
-
-                // === 修复：必须在这里更新 UI 和分数状态 ===
-                calculateScore(0); // 触发一次状态更新
-
-                // 立即告诉 UI 更新，否则玩家会觉得没反应
-                double acc = (m_totalHits == 0) ? 100.0 : (m_totalAccWeight / m_totalHits) * 100.0;
-                emit statsChanged(m_countPerfect, m_countGreat, m_countGood, m_countMiss, m_combo, m_maxCombo, m_score, acc);
-
-                return;
-            }
-
-            // === 2. 正常松手 (Hit) ===
-            note.isHolding = false; // 结束按住
-            // 只要没被上面那个 if 拦截，说明松手时间是在允许范围内的（包括稍微晚一点）
-
-            m_combo++;
-            if (m_combo > m_maxCombo) m_maxCombo = m_combo;
-            m_totalHits++;
-
-            int weight = 0;
-            if (diff <= m_config.judgeWindow.perfect) {
-                weight = 300;
-                m_lastJudgmentText = "PERFECT";
-                m_lastJudgmentColor = QColor(0, 255, 255);
-                m_countPerfect++;       // 别忘了加计数
-                m_totalAccWeight += 1.0;
-            } else if (diff <= m_config.judgeWindow.good) {
-                // 只要在 Good 范围内都给 Great 的反馈，让长条手感更宽松
-                // 或者严格按照区间分级
-                weight = 200;
-                m_lastJudgmentText = "GREAT";
-                m_lastJudgmentColor = Qt::green;
-                m_countGreat++;
-                m_totalAccWeight += 0.8;
-            } else {
-                // 勉强在 Miss 窗口边缘松手
-                weight = 50;
-                m_lastJudgmentText = "GOOD";
-                m_lastJudgmentColor = Qt::blue;
-                m_countGood++;
-                m_totalAccWeight += 0.5;
-            }
-
-            calculateScore(weight);
-            m_feedbackTimer = 20;
-
-            double acc = (m_totalHits == 0) ? 100.0 : (m_totalAccWeight / m_totalHits) * 100.0;
-            emit statsChanged(m_countPerfect, m_countGreat, m_countGood, m_countMiss, m_combo, m_maxCombo, m_score, acc);
-            return;
+    for (int k = 1; k <= kMaxKeyCount; ++k) {
+        const KeyLayout &keys = m_config.keysFor(k);
+        if (k == 4) {
+            for (int i = 0; i < 4; ++i) settings.setValue(QString("key%1").arg(i + 1), keys[i]);
+            continue;
         }
+        QStringList parts;
+        for (int i = 0; i < k; ++i) parts << QString::number(keys[i]);
+        settings.setValue(QString("keys%1K").arg(k), parts.join(','));
     }
 }
 
-void GameWidget::calculateScore(int weight) {
-    m_currentRawScore += weight;
-
-    // 归一化到 1,000,000
-    // 实时分数 = (当前获得权重 / 理论总权重) * 1,000,000
-    m_score = (int)((m_currentRawScore / m_maxPossibleScore) * 1000000.0);
+GameStats GameWidget::currentStats() const {
+    const ScoreState &score = m_engine->score();
+    GameStats stats;
+    stats.perfect = score.countPerfect;
+    stats.great = score.countGreat;
+    stats.good = score.countGood;
+    stats.miss = score.countMiss;
+    stats.combo = score.combo;
+    stats.maxCombo = score.maxCombo;
+    stats.score = score.score;
+    stats.acc = score.acc();
+    stats.currentTime = m_progressTime;
+    stats.duration = std::max<qint64>(1, m_songDuration);
+    stats.displayLatencyMs = m_latency.latencyMs();
+    stats.latencyCompensated = m_config.latencyCompensation;
+    return stats;
 }
 
-QString GameWidget::getGrade() const {
-    if (m_score >= 970000) return "S";
-    if (m_score >= 900000) return "A";
-    if (m_score >= 800000) return "B";
-    return "C";
+void GameWidget::publishStats(bool force) {
+    if (!m_statsDirty) return;
+    // 两次推送之间至少间隔 hudRefreshMs (计时器未启动时视为已到期)
+    if (!force && m_statsTimer.isValid() && m_statsTimer.elapsed() < m_config.hudRefreshMs) return;
+
+    const GameStats stats = currentStats();
+    m_statsDirty = false;
+    m_statsTimer.start();
+    emit statsUpdated(stats);
 }
 
 bool GameWidget::focusNextPrevChild(bool next) {
@@ -705,19 +981,26 @@ bool GameWidget::focusNextPrevChild(bool next) {
 }
 
 void GameWidget::saveRecord() {
+    TRACE_SCOPE("record.save");
     // 1. 构建记录对象
+    const ScoreState &score = m_engine->score();
     QJsonObject recordObj;
-    // 唯一标识：Artist + Title + Version
-    QString mapHash = m_currentArtist + m_currentTitle + m_currentVersion;
-    recordObj["hash"] = mapHash;
-    recordObj["score"] = m_score;
-    recordObj["acc"] = (m_totalHits == 0) ? 0.0 : (m_totalAccWeight / m_totalHits) * 100.0;
-    recordObj["combo"] = m_maxCombo;
-    recordObj["grade"] = getGrade();
-    recordObj["perfect"] = m_countPerfect;
-    recordObj["great"] = m_countGreat;
-    recordObj["good"] = m_countGood;
-    recordObj["miss"] = m_countMiss;
+    // 唯一标识：谱面内容哈希 (旧版标识 Artist + Title + Version 一并保留，方便人工查看)
+    recordObj["hash"] = m_currentRecordKey;
+    recordObj["legacyHash"] = m_currentArtist + m_currentTitle + m_currentVersion;
+    recordObj["score"] = score.score;
+    recordObj["acc"] = (score.totalHits == 0) ? 0.0 : score.acc();
+    recordObj["combo"] = score.maxCombo;
+    recordObj["grade"] = score.grade();
+    recordObj["perfect"] = score.countPerfect;
+    recordObj["great"] = score.countGreat;
+    recordObj["good"] = score.countGood;
+    recordObj["miss"] = score.countMiss;
+    recordObj["keys"] = m_engine->keyCount();
+    recordObj["rate"] = m_rate;
+    // 显示延迟补偿的开关和当时的估计值：用来对比两种设置下的误差分布
+    recordObj["latencyCompensation"] = m_config.latencyCompensation;
+    recordObj["displayLatencyMs"] = std::round(m_latency.latencyMs() * 10) / 10;
     recordObj["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
 
     // 记录当时用的判定区间
@@ -726,51 +1009,9 @@ void GameWidget::saveRecord() {
     judgeObj["miss"] = m_config.judgeWindow.miss;
     recordObj["judgment"] = judgeObj;
 
-    // 2. 确定保存路径: ./records/
-    QString dirPath = QCoreApplication::applicationDirPath() + "/records";
-    QDir dir(dirPath);
-    if (!dir.exists()) {
-        bool ok = dir.mkpath(".");
-        if (!ok) {
-            qDebug() << "ERROR: Failed to create records directory at:" << dirPath;
-            return;
-        }
-    }
-
-    // 文件名使用 Hash 或者时间戳，这里用 追加模式存到一个大文件 或者 单文件
-    // 为了方便读取历史，我们将所有记录存为一个 records.json 列表，或者每个谱面一个文件
-    // 这里采用：每个谱面一个 .json 文件，文件名是 hash 的 md5 (为了避开文件名非法字符)
-
-    QString safeName = QString(QCryptographicHash::hash(mapHash.toUtf8(), QCryptographicHash::Md5).toHex());
-    QString filePath = dirPath + "/" + safeName + ".json";
-
-    // 读取旧记录 (如果是列表)
-    QJsonArray history;
-    QFile file(filePath);
-    if (file.open(QIODevice::ReadOnly)) {
-        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-        history = doc.array();
-        file.close();
-    }
-
-    // 添加新记录
-    history.append(recordObj);
-
-    // 排序？取最高分？这里保留所有历史
+    // 逐个判定的误差 (紧凑编码)
+    HitErrors::writeToRecord(m_engine->hitErrors(), recordObj);
 
-    // 写入
-    if (file.open(QIODevice::WriteOnly)) {
-        QJsonDocument doc(history);
-        file.write(doc.toJson());
-        file.close();
-
-        // === 打印成功信息，方便你在 Qt Creator 的 Application Output 里看到 ===
-        qDebug() << "========================================";
-        qDebug() << "Record SAVED Successfully!";
-        qDebug() << "Path:" << filePath;
-        qDebug() << "Score:" << m_score;
-        qDebug() << "========================================";
-    } else {
-        qDebug() << "ERROR: Could not open file for writing:" << filePath;
-    }
+    // 2. 交给后台写入器：文件读写和索引更新都不在 GUI 线程做，结算画面不会卡顿
+    m_recordWriter->enqueue(m_currentRecordKey, recordObj);
 }
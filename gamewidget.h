@@ -2,13 +2,24 @@
 #define GAMEWIDGET_H
 
 #include <QOpenGLWidget> // 替换 QWidget
-#include <QMediaPlayer>
-#include <QAudioOutput>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
 #include <QTimer>
 #include <QElapsedTimer> // 必须引用
+#include <array>
+#include <memory>
 #include <vector>
-#include <QCryptographicHash>
 #include "Structs.h"
+#include "JudgeEngine.h"
+#include "Autoplay.h"
+#include "ScrollIndex.h"
+#include "RecordWriter.h"
+#include "PcmPlayer.h"
+#include "DisplayLatency.h"
+
+class QPainter;
+
+using NoteListPtr = std::shared_ptr<const std::vector<Note>>;
 
 // 继承 QOpenGLWidget 以获得硬件加速
 class GameWidget : public QOpenGLWidget {
@@ -16,10 +27,43 @@ class GameWidget : public QOpenGLWidget {
 
 public:
     explicit GameWidget(QWidget *parent = nullptr);
-    void loadBeatmap(const QString &filePath);
+    // recordKey 为谱面内容哈希 (选歌扫描时已算好)；为空时根据文件内容现算
+    void loadBeatmap(const QString &filePath, const QString &recordKey = QString());
+    // 立即重开当前谱面：复用已解析的物件和已解码的音频，不读盘、不解析，只重置状态并重新倒计时
+    void retry();
     void updateConfig(const GameConfig &config);
     GameConfig getConfig() const { return m_config; }
-    int getScore() const { return m_score; }
+    int getScore() const { return m_engine->score().score; }
+    int keyCount() const { return m_engine->keyCount(); }
+
+    // 区间练习：只判定区间内的物件，区间结束后立刻从区间开头 (提前 kPracticeLeadInMs) 再来一轮，
+    // 每轮统计单独结算、不保存成绩。[ / ] 键在游戏中标记区间起点 / 终点，\ 键退出练习
+    void startPractice(qint64 startMs, qint64 endMs);
+    void stopPractice();
+    void markLoopStart(); // 以当前时间为起点
+    void markLoopEnd();   // 以当前时间为终点并开始练习
+    const PracticeSection &practice() const { return m_practice; }
+
+    // 变速 (保持音高)：变速音频在后台渲染并按 (音频, 倍率) 缓存，用过的倍率再切回来不需要等待。
+    // 切换后从头重来 (练习中回到区间开头)
+    void setRate(double rate);
+    double rate() const { return m_rate; }
+
+    // 自动游玩：在每个物件的准确时间按下 / 松开，走真实的判定路径 (用作渲染压力测试)。
+    // 切换后从头重来；自动游玩期间轨道键不参与判定，成绩不保存
+    void setAutoplay(bool enabled);
+    bool autoplay() const { return m_autoplay; }
+
+    // 显示延迟补偿：画面要过一两个刷新间隔才真正上屏，开启后物件按预计上屏时刻的位置绘制。
+    // 关闭后可以对比两种情况下的打击误差分布 (成绩里记录了当时的开关和延迟)
+    void setLatencyCompensation(bool enabled);
+    double displayLatencyMs() const { return m_latency.latencyMs(); }
+
+    // 热重载：监视当前谱面文件 (.osz 包内的除外)，保存后在后台只重新解析 [HitObjects]，
+    // 和当前物件比对后只把改动的一段换进引擎 (JudgeEngine::splice)，音频不中断，分数和连击保留。
+    // GameConfig::reloadRewind 开启时从改动处之前 kReloadRewindMs 继续，回退区间里已判定的物件保持原判定，
+    // 只有新物件需要再打；改过的谱面这一局不保存成绩
+    static constexpr qint64 kReloadRewindMs = 3000;
 
 protected:
     void paintEvent(QPaintEvent *event) override; // 依然使用 paintEvent，Qt会自动用OpenGL处理
@@ -28,44 +72,55 @@ protected:
     bool focusNextPrevChild(bool next) override;
 
 signals:
-    // === 新增信号：通知 UI 更新 ===
-    void statsChanged(int perfect, int great, int good, int miss, int combo, int maxCombo, int score, double acc);
+    // 统计快照 (含进度)：状态变化时只标记脏位，每个显示帧最多发出一次
+    void statsUpdated(const GameStats &stats);
     void songLoaded(QString title, QString artist, qint64 duration);
-    void progressChanged(qint64 current, qint64 total);
+    // 成绩写入结果 (由后台写入器转发)
+    void recordSaved(QString filePath, int score);
+    void recordSaveFailed(QString filePath, QString error);
+    // 练习状态变化 (开始 / 退出 / 只标记了起点)
+    void practiceChanged(const PracticeSection &section);
+    // 练习区间打完一轮 (iteration 从 1 开始)
+    void practiceLoopFinished(int iteration, const GameStats &stats);
+    // 谱面热重载完成：第一个改动的时间、删掉 / 新增的物件数、从文件变化到换入的耗时
+    void chartReloaded(qint64 firstChangeMs, int removed, int added, qint64 latencyMs);
 
 private slots:
     void gameLoop();
 
 private:
-    void checkHit(int column);
-    void checkRelease(int column);
+    int columnForKey(int key) const; // 当前键数下按键对应的列，没有则为 -1
+    void showJudgment(Judgment judgment, int frames);
     void resetGame();
-    qint64 getSmoothTime() const;
 
-    QMediaPlayer *m_player;
-    QAudioOutput *m_audioOutput;
+    // 按键数特化的绘制：列数、列宽和颜色表都是编译期常量
+    template <int K> void paintLanes(QPainter &p, double judgmentY);
+    template <int K> void paintNotes(QPainter &p, double judgmentY, qint64 smoothTime);
+    qint64 getSmoothTime() const;
+    GameStats currentStats() const;
+
+    PcmPlayer *m_player;
+    QFutureWatcher<DecodedAudioPtr> m_audioWatcher; // 缓存未命中时等待后台解码
+    bool m_audioPending = false;
+    int m_lastNoteTime = 0;
+    void applyAudio(const DecodedAudioPtr &audio);
+    void requestRateAudio(); // 按 m_rate 取 m_sourceAudio 的变速版本
+    DecodedAudioPtr m_sourceAudio; // 原速 PCM (变速版本由它渲染)
+    double m_rate = 1.0;
     QTimer *m_timer;
+    RecordWriter *m_recordWriter;
 
     // === 核心修改：视觉时间同步器 ===
     QElapsedTimer m_visualTimer; // 高精度计时器
     qint64 m_visualTimeOffset = 0; // 用于暂停/继续时的偏移补偿
 
-    std::vector<Note> m_notes;
+    // 判定与计分 (物件、每列游标、统计、逐个判定误差都在引擎里)
+    std::unique_ptr<JudgeEngine> m_engine;
+    ScrollIndex m_scroll; // BPM / SV 变速：每帧只查一次当前位置
     GameConfig m_config;
 
     bool m_isPlaying = false;
-    bool m_keysPressed[4] = {false};
-
-    int m_score = 0;
-    int m_combo = 0;
-    int m_maxCombo = 0;
-    int m_totalHits = 0;
-    double m_totalAccWeight = 0;
-
-    int m_countPerfect = 0;
-    int m_countGreat = 0;
-    int m_countGood = 0;
-    int m_countMiss = 0;
+    std::array<bool, kMaxKeyCount> m_keysPressed{};
 
     QString m_lastJudgmentText;
     QColor m_lastJudgmentColor;
@@ -75,12 +130,55 @@ private:
     QString m_currentArtist;
     qint64 m_songDuration = 0;
     QString m_currentVersion = "";
-
-    void calculateScore(int weight); // 新增：统一算分函数
-    QString getGrade() const;        // 新增：获取评级字符
-
-    double m_currentRawScore = 0; // 当前累积的权重分 (Perfect=300, Miss=0)
-    double m_maxPossibleScore = 1; // 理论最大权重分 (总Note数 * 300)
+    QString m_currentRecordKey; // 成绩记录主键 (内容哈希)
+
+    // 统计推送：改动统计的地方只调用 markStatsDirty()，由 frameSwapped 统一推送
+    bool m_statsDirty = false;
+    QElapsedTimer m_statsTimer; // 距上次推送的时间
+    qint64 m_progressTime = 0;
+    void markStatsDirty() { m_statsDirty = true; }
+    void publishStats(bool force);
+
+    // 绘制时刻 / 交换时刻都用这个单调时钟 (纳秒)
+    QElapsedTimer m_frameClock;
+    DisplayLatency m_latency;
+
+    QElapsedTimer m_retryTimer; // 按下重开键到下一帧显示完成 (只用于统计耗时)
+    bool m_hasChart = false;    // 当前是否有可重开的谱面
+
+    // 区间练习：游戏时间 = m_timeBase + 计时器读数 (正常游玩时为 0)
+    static constexpr qint64 kPracticeLeadInMs = 1000;
+    PracticeSection m_practice;
+    qint64 m_practiceTailMs = 0; // 区间内最后一个判定的时间 (含跨出区间的长条尾)
+    qint64 m_loopMark = -1;      // [ 键标记的起点
+    qint64 m_timeBase = 0;
+    int m_loopIteration = 0;
+    void restartPracticeLoop();
+    void resumeAt(qint64 time); // 音频和视觉时间跳到 time (谱面时间) 继续播放
+
+    // 热重载
+    static constexpr int kReloadDebounceMs = 15; // 编辑器保存时可能连写几次
+    QString m_chartPath;                 // 被监视的谱面文件 (包内谱面为空)
+    QFileSystemWatcher m_chartWatcher;
+    QTimer m_reloadTimer;
+    QFutureWatcher<NoteListPtr> m_reloadWatcher;
+    QElapsedTimer m_reloadLatency;       // 从第一次收到文件变化开始计时
+    bool m_reloadQueued = false;         // 解析期间文件又变了
+    bool m_reloadApplied = false;        // 已换入，等下一帧显示完成 (只用于统计耗时)
+    bool m_chartEdited = false;          // 加载后谱面被改过：成绩主键已经对不上，不保存成绩
+    void watchChart(const QString &path);
+    bool rewatchChart(); // 谱面文件不在监视列表里但已存在时重新加上，返回是否加上了
+    void startReload();
+    void applyReload(const std::vector<Note> &notes);
+
+    // 自动游玩的输入序列 (按需生成) 和下一个待送入引擎的位置
+    bool m_autoplay = false;
+    std::vector<AutoplayInput> m_autoInputs;
+    size_t m_autoCursor = 0;
+    void syncAutoplay(qint64 time); // 游标跳到 time 之后的第一个输入
+    void playAutoplay(qint64 time);
+
+    void startCountdown();
 
     QElapsedTimer m_preGameTimer;
     qint64 m_preGameStartTime = 0; // 记录延迟开始的绝对时间
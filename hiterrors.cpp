@@ -0,0 +1,107 @@
+#include "HitErrors.h"
+#include <QByteArray>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QtConcurrent/QtConcurrent>
+#include <cmath>
+
+double HitErrorStats::stddev() const {
+    if (count < 2) return 0.0;
+    double m = mean();
+    double var = sumSq / count - m * m;
+    return var > 0 ? std::sqrt(var) : 0.0;
+}
+
+namespace HitErrors {
+
+void writeToRecord(const std::vector<qint16> &errors, QJsonObject &record) {
+    bool fitsInt8 = true;
+    for (qint16 e : errors) {
+        if (e < -128 || e > 127) { fitsInt8 = false; break; }
+    }
+
+    QByteArray raw;
+    if (fitsInt8) {
+        raw.resize(qsizetype(errors.size()));
+        char *out = raw.data();
+        for (size_t i = 0; i < errors.size(); ++i) out[i] = char(qint8(errors[i]));
+    } else {
+        raw.resize(qsizetype(errors.size() * 2));
+        uchar *out = reinterpret_cast<uchar *>(raw.data());
+        for (size_t i = 0; i < errors.size(); ++i) {
+            quint16 v = quint16(errors[i]);
+            out[i * 2] = uchar(v & 0xFF);
+            out[i * 2 + 1] = uchar(v >> 8);
+        }
+    }
+
+    record["hitErrors"] = QString::fromLatin1(raw.toBase64());
+    record["hitErrorBits"] = fitsInt8 ? 8 : 16;
+}
+
+std::vector<qint16> readFromRecord(const QJsonObject &record) {
+    std::vector<qint16> errors;
+    const QString encoded = record["hitErrors"].toString();
+    if (encoded.isEmpty()) return errors; // 旧记录没有逐个误差
+
+    const QByteArray raw = QByteArray::fromBase64(encoded.toLatin1());
+    const uchar *in = reinterpret_cast<const uchar *>(raw.constData());
+
+    if (record["hitErrorBits"].toInt() == 16) {
+        errors.resize(size_t(raw.size() / 2));
+        for (size_t i = 0; i < errors.size(); ++i) {
+            errors[i] = qint16(quint16(in[i * 2]) | (quint16(in[i * 2 + 1]) << 8));
+        }
+    } else {
+        errors.resize(size_t(raw.size()));
+        for (size_t i = 0; i < errors.size(); ++i) errors[i] = qint8(in[i]);
+    }
+    return errors;
+}
+
+HitErrorStats statsOf(const std::vector<qint16> &errors) {
+    HitErrorStats s;
+    for (qint16 e : errors) s.add(e);
+    return s;
+}
+
+HitErrorStats statsOfRecord(const QJsonObject &record) {
+    return statsOf(readFromRecord(record));
+}
+
+static HitErrorStats statsOfFile(const QString &path) {
+    HitErrorStats s;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return s;
+    const QJsonArray history = QJsonDocument::fromJson(file.readAll()).array();
+    for (const auto &val : history) s.merge(statsOfRecord(val.toObject()));
+    return s;
+}
+
+HitErrorStats aggregateRecordFiles(const QStringList &files) {
+    if (files.size() == 1) {
+        // 单个谱面：在该文件的记录之间并行
+        QFile file(files.first());
+        if (!file.open(QIODevice::ReadOnly)) return HitErrorStats();
+        const QJsonArray history = QJsonDocument::fromJson(file.readAll()).array();
+        QList<QJsonObject> records;
+        records.reserve(history.size());
+        for (const auto &val : history) records.append(val.toObject());
+
+        return QtConcurrent::blockingMappedReduced<HitErrorStats>(
+            records,
+            [](const QJsonObject &record) { return statsOfRecord(record); },
+            [](HitErrorStats &acc, const HitErrorStats &s) { acc.merge(s); },
+            QtConcurrent::UnorderedReduce);
+    }
+
+    // 多个谱面：每个文件一个任务 (读文件 + 解析 JSON + 解码)
+    return QtConcurrent::blockingMappedReduced<HitErrorStats>(
+        files,
+        [](const QString &path) { return statsOfFile(path); },
+        [](HitErrorStats &acc, const HitErrorStats &s) { acc.merge(s); },
+        QtConcurrent::UnorderedReduce);
+}
+
+}
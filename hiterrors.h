@@ -0,0 +1,64 @@
+#ifndef HITERRORS_H
+#define HITERRORS_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <vector>
+
+// 打击误差统计 (ms，负数 = 提前，正数 = 滞后)
+// 只存计数和累加和，可以任意合并，方便多线程汇总
+struct HitErrorStats {
+    static constexpr int kRange = 200;   // 直方图范围 [-200, 200] ms，超出部分计入两端
+    static constexpr int kBinWidth = 5;
+    static constexpr int kBins = kRange * 2 / kBinWidth;
+
+    qint64 count = 0;
+    qint64 early = 0;
+    qint64 late = 0;
+    double sum = 0;
+    double sumSq = 0;
+    std::array<qint64, kBins> histogram{};
+
+    void add(int error) {
+        count++;
+        sum += error;
+        sumSq += double(error) * error;
+        if (error < 0) early++;
+        else if (error > 0) late++;
+        int bin = (error + kRange) / kBinWidth;
+        if (bin < 0) bin = 0;
+        if (bin >= kBins) bin = kBins - 1;
+        histogram[bin]++;
+    }
+
+    void merge(const HitErrorStats &o) {
+        count += o.count;
+        early += o.early;
+        late += o.late;
+        sum += o.sum;
+        sumSq += o.sumSq;
+        for (int i = 0; i < kBins; ++i) histogram[i] += o.histogram[i];
+    }
+
+    double mean() const { return count ? sum / count : 0.0; }
+    double stddev() const;
+};
+
+namespace HitErrors {
+
+// 存储格式：全部在 int8 范围内时每个误差 1 字节，否则 2 字节 (小端)，再 base64 写入 JSON
+// record["hitErrors"] = base64, record["hitErrorBits"] = 8 / 16
+void writeToRecord(const std::vector<qint16> &errors, QJsonObject &record);
+std::vector<qint16> readFromRecord(const QJsonObject &record);
+
+HitErrorStats statsOf(const std::vector<qint16> &errors);
+HitErrorStats statsOfRecord(const QJsonObject &record);
+
+// 在全局线程池上并行汇总 (阻塞调用，请在工作线程或 QtConcurrent::run 里使用)
+HitErrorStats aggregateRecordFiles(const QStringList &files);
+
+}
+
+#endif // HITERRORS_H
@@ -0,0 +1,81 @@
+#include "HitErrorWidget.h"
+#include <QPainter>
+#include <algorithm>
+
+HitErrorWidget::HitErrorWidget(QWidget *parent) : QWidget(parent) {
+    setMinimumHeight(140);
+    m_message = "Select a play to see its hit errors";
+}
+
+void HitErrorWidget::setStats(const HitErrorStats &stats, const QString &caption) {
+    m_stats = stats;
+    m_caption = caption;
+    m_message = stats.count == 0 ? "No hit error data" : QString();
+    update();
+}
+
+void HitErrorWidget::setMessage(const QString &message) {
+    m_stats = HitErrorStats();
+    m_message = message;
+    update();
+}
+
+void HitErrorWidget::paintEvent(QPaintEvent *event) {
+    Q_UNUSED(event);
+    QPainter p(this);
+    p.fillRect(rect(), QColor(51, 51, 51));
+
+    int w = width();
+    int h = height();
+
+    if (!m_message.isEmpty()) {
+        p.setPen(QColor(150, 150, 150));
+        p.drawText(rect(), Qt::AlignCenter, m_message);
+        return;
+    }
+
+    // 1. 顶部文字：均值 / 标准差 / 提前滞后
+    double earlyPct = m_stats.count ? m_stats.early * 100.0 / m_stats.count : 0;
+    double latePct = m_stats.count ? m_stats.late * 100.0 / m_stats.count : 0;
+    QString text = QString("%1  n=%2  Mean: %3ms  SD: %4ms  Early %5% / Late %6%")
+        .arg(m_caption)
+        .arg(m_stats.count)
+        .arg(QString::number(m_stats.mean(), 'f', 1))
+        .arg(QString::number(m_stats.stddev(), 'f', 1))
+        .arg(QString::number(earlyPct, 'f', 0))
+        .arg(QString::number(latePct, 'f', 0));
+    p.setPen(Qt::white);
+    p.drawText(QRect(4, 2, w - 8, 18), Qt::AlignLeft | Qt::AlignVCenter, text);
+
+    // 2. 直方图
+    QRectF area(4, 24, w - 8, h - 40);
+    qint64 peak = *std::max_element(m_stats.histogram.begin(), m_stats.histogram.end());
+    if (peak == 0) return;
+
+    double binW = area.width() / HitErrorStats::kBins;
+    p.setPen(Qt::NoPen);
+    for (int i = 0; i < HitErrorStats::kBins; ++i) {
+        if (m_stats.histogram[i] == 0) continue;
+        double barH = area.height() * m_stats.histogram[i] / double(peak);
+        // 左半边 (提前) 偏蓝，右半边 (滞后) 偏橙
+        QColor c = (i < HitErrorStats::kBins / 2) ? QColor(0, 170, 255) : QColor(255, 170, 0);
+        p.setBrush(c);
+        p.drawRect(QRectF(area.left() + i * binW, area.bottom() - barH, std::max(1.0, binW - 1), barH));
+    }
+
+    // 3. 0ms 中线和平均值标记
+    double centerX = area.left() + area.width() / 2;
+    p.setPen(QPen(Qt::white, 1));
+    p.drawLine(QPointF(centerX, area.top()), QPointF(centerX, area.bottom()));
+
+    double meanX = centerX + m_stats.mean() / HitErrorStats::kRange * (area.width() / 2);
+    p.setPen(QPen(Qt::red, 2));
+    p.drawLine(QPointF(meanX, area.top()), QPointF(meanX, area.bottom()));
+
+    // 4. 坐标刻度
+    p.setPen(QColor(150, 150, 150));
+    QRect labels(4, h - 16, w - 8, 14);
+    p.drawText(labels, Qt::AlignLeft, QString("-%1ms").arg(HitErrorStats::kRange));
+    p.drawText(labels, Qt::AlignHCenter, "0");
+    p.drawText(labels, Qt::AlignRight, QString("+%1ms").arg(HitErrorStats::kRange));
+}
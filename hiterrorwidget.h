@@ -0,0 +1,26 @@
+#ifndef HITERRORWIDGET_H
+#define HITERRORWIDGET_H
+
+#include <QWidget>
+#include "HitErrors.h"
+
+// 打击误差分布图：直方图 + 平均值/标准差/提前滞后比例
+class HitErrorWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit HitErrorWidget(QWidget *parent = nullptr);
+
+    void setStats(const HitErrorStats &stats, const QString &caption);
+    void setMessage(const QString &message); // 例如 "Computing..." 或 "No data"
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    HitErrorStats m_stats;
+    QString m_caption;
+    QString m_message;
+};
+
+#endif // HITERRORWIDGET_H
@@ -0,0 +1,371 @@
+#include "JudgeEngine.h"
+#include <array>
+#include <cmath>
+#include <cstdlib>
+
+QString ScoreState::grade() const {
+    if (score >= 970000) return "S";
+    if (score >= 900000) return "A";
+    if (score >= 800000) return "B";
+    return "C";
+}
+
+namespace {
+
+template <int K>
+class LaneJudgeEngine final : public JudgeEngine {
+public:
+    int keyCount() const override { return K; }
+
+    void reset() override {
+        // 只重置区间内的物件 (没有区间时就是全部)，顺带重新统计区间内的判定数
+        // (热重载删掉的已判定物件在这一局里还占着满分，重开时才去掉)
+        int judgments = 0;
+        for (int c = 0; c < K; ++c) {
+            const std::vector<int> &lane = m_lanes[c];
+            for (int k = m_begin[c]; k < m_end[c]; ++k) {
+                Note &note = m_notes[lane[k]];
+                note.isHit = false;
+                note.isMissed = false;
+                note.isHolding = false;
+                judgments += note.isHold ? 2 : 1;
+            }
+        }
+        m_rangeJudgments = judgments;
+        resetScore();
+        m_head = m_begin;
+        m_holding.fill(-1);
+    }
+
+    void setRange(qint64 startMs, qint64 endMs) override {
+        m_rangeStart = startMs;
+        m_rangeEnd = endMs;
+        for (int c = 0; c < K; ++c) {
+            const std::vector<int> &lane = m_lanes[c];
+            auto boundary = [&](qint64 time) {
+                return int(std::partition_point(lane.begin(), lane.end(),
+                                                [&](int i) { return m_notes[i].time < time; }) - lane.begin());
+            };
+            m_begin[c] = boundary(startMs);
+            m_end[c] = std::max(m_begin[c], boundary(endMs));
+        }
+        reset();
+    }
+
+    Judgment press(int column, qint64 time) override {
+        if (unsigned(column) >= unsigned(K)) return Judgment::None;
+
+        // 上一个长条还没松手就又按下 (松手事件丢了 / 同列物件重叠)：先按此刻松手结算，
+        // 否则它会一直处于按住状态，既不判尾也不会被 sweep 扫到
+        if (m_holding[column] >= 0) release(column, time);
+
+        // 从该列游标开始，只看时间在 Miss 窗口内的物件，取误差最小的那个
+        const std::vector<int> &lane = m_lanes[column];
+        int target = -1;
+        int minDiff = 10000;
+        for (int k = m_head[column]; k < m_end[column]; ++k) {
+            const Note &note = m_notes[lane[k]];
+            if (note.time > time + m_span.miss) break;
+            if (note.isHit || note.isMissed) continue;
+            int diff = std::abs(note.time - int(time));
+            if (diff <= m_span.miss && diff < minDiff) {
+                minDiff = diff;
+                target = lane[k];
+            }
+        }
+        if (target < 0) return Judgment::None;
+
+        Note &note = m_notes[target];
+        note.isHit = true; // 头部被击中
+        recordHitError(time - note.time);
+        if (note.isHold) {
+            note.isHolding = true; // 如果是长条，标记为"正在按住"
+            m_holding[column] = target;
+        }
+        Judgment j = applyHeadHit(minDiff);
+        advanceHead(column);
+        return j;
+    }
+
+    Judgment release(int column, qint64 time) override {
+        if (unsigned(column) >= unsigned(K)) return Judgment::None;
+        const int index = m_holding[column];
+        if (index < 0) return Judgment::None;
+
+        Note &note = m_notes[index];
+        m_holding[column] = -1;
+        note.isHolding = false;
+
+        // 还没进入 Miss 窗口就松手了
+        if (time < note.endTime - m_span.miss) {
+            note.isMissed = true;
+            applyMiss();
+            return Judgment::MissEarly;
+        }
+
+        // 只要没被上面拦截，说明松手时间在允许范围内 (包括稍微晚一点)
+        recordHitError(time - note.endTime);
+        return applyTailRelease(std::abs(note.endTime - int(time)));
+    }
+
+    Judgment sweep(qint64 time) override {
+        Judgment last = Judgment::None;
+        for (int c = 0; c < K; ++c) {
+            // 长条按过头
+            const int held = m_holding[c];
+            if (held >= 0 && time > m_notes[held].endTime + m_span.miss) {
+                Note &note = m_notes[held];
+                note.isHolding = false;
+                note.isMissed = true;
+                m_holding[c] = -1;
+                applyMiss();
+                last = Judgment::MissOverhold;
+            }
+
+            // 头部 Miss：游标之前的物件都已处理，只需从游标往后看
+            const std::vector<int> &lane = m_lanes[c];
+            int &head = m_head[c];
+            while (head < m_end[c]) {
+                Note &note = m_notes[lane[head]];
+                if (note.isHit || note.isMissed) {
+                    ++head;
+                } else if (time > note.time + m_span.miss) {
+                    note.isMissed = true;
+                    applyMiss();
+                    last = Judgment::Miss;
+                    ++head;
+                } else {
+                    break;
+                }
+            }
+        }
+        return last;
+    }
+
+    int laneCursor(int column) const override { return m_head[column]; }
+    int laneEnd(int column) const override { return m_end[column]; }
+    int laneHolding(int column) const override { return m_holding[column]; }
+    const std::vector<int> &lane(int column) const override { return m_lanes[column]; }
+
+protected:
+    void buildLanes() override {
+        std::array<int, K> counts{};
+        for (const Note &note : m_notes) counts[note.column]++;
+        for (int c = 0; c < K; ++c) {
+            m_lanes[c].clear();
+            m_lanes[c].reserve(counts[c]);
+        }
+        for (int i = 0; i < int(m_notes.size()); ++i) m_lanes[m_notes[i].column].push_back(i);
+        for (int c = 0; c < K; ++c) {
+            m_begin[c] = 0;
+            m_end[c] = int(m_lanes[c].size());
+        }
+    }
+
+    void spliceLanes(int first, int removeCount, int insertCount) override {
+        const int last = first + removeCount;
+        const int delta = insertCount - removeCount;
+        std::array<std::vector<int>, K> added;
+        for (int i = first; i < first + insertCount; ++i) added[m_notes[i].column].push_back(i);
+
+        for (int c = 0; c < K; ++c) {
+            // 按住的长条被删掉就作废 (不判定)；在改动之后的下标跟着移动
+            int &held = m_holding[c];
+            if (held >= last) held += delta;
+            else if (held >= first) held = -1;
+
+            // 列里的下标是递增的，改动落在 [lo, hi) 这一段
+            std::vector<int> &lane = m_lanes[c];
+            const int lo = int(std::lower_bound(lane.begin(), lane.end(), first) - lane.begin());
+            const int hi = int(std::lower_bound(lane.begin() + lo, lane.end(), last) - lane.begin());
+            if (delta != 0) {
+                for (int k = hi; k < int(lane.size()); ++k) lane[k] += delta;
+            }
+            if (lo == hi && added[c].empty()) continue; // 这一列的物件没变，游标不用动
+
+            lane.erase(lane.begin() + lo, lane.begin() + hi);
+            lane.insert(lane.begin() + lo, added[c].begin(), added[c].end());
+            const int grow = int(added[c].size()) - (hi - lo);
+            auto boundary = [&](qint64 time) {
+                return int(std::partition_point(lane.begin(), lane.end(),
+                                                [&](int i) { return m_notes[i].time < time; }) - lane.begin());
+            };
+            m_begin[c] = boundary(m_rangeStart);
+            m_end[c] = std::max(m_begin[c], boundary(m_rangeEnd));
+            // 游标在改动之后就跟着平移，落在改动之内就退回改动开头；有新物件时 (可能排在已提前判定的
+            // 物件前面) 也退回改动开头。最后跳过已处理的物件
+            int &head = m_head[c];
+            if (head > hi) head += grow;
+            else if (head > lo) head = lo;
+            if (!added[c].empty()) head = std::min(head, lo);
+            head = std::clamp(head, m_begin[c], m_end[c]);
+            advanceHead(c);
+        }
+    }
+
+private:
+    void advanceHead(int column) {
+        const std::vector<int> &lane = m_lanes[column];
+        int &head = m_head[column];
+        while (head < m_end[column] && (m_notes[lane[head]].isHit || m_notes[lane[head]].isMissed)) ++head;
+    }
+
+    std::array<std::vector<int>, K> m_lanes; // 列 -> 按时间排序的物件下标
+    std::array<int, K> m_head{};             // 列 -> m_lanes 中第一个未处理物件的位置
+    std::array<int, K> m_holding{};          // 列 -> 正在按住的长条下标 (-1 表示没有)
+    std::array<int, K> m_begin{};            // 列 -> 区间在 m_lanes 中的 [begin, end)
+    std::array<int, K> m_end{};
+};
+
+}
+
+std::unique_ptr<JudgeEngine> JudgeEngine::create(int keyCount) {
+    return withKeyCount(keyCount, [](auto k) -> std::unique_ptr<JudgeEngine> {
+        return std::make_unique<LaneJudgeEngine<decltype(k)::value>>();
+    });
+}
+
+void JudgeEngine::load(const std::vector<Note> &notes) {
+    m_notes = notes;
+    const int keys = keyCount();
+    m_totalJudgments = 0;
+    for (Note &note : m_notes) {
+        note.column = std::clamp(note.column, 0, keys - 1);
+        m_totalJudgments++;                 // 头部
+        if (note.isHold) m_totalJudgments++; // 尾部
+    }
+    m_rangeStart = std::numeric_limits<qint64>::min();
+    m_rangeEnd = std::numeric_limits<qint64>::max();
+    m_hitErrors.reserve(m_totalJudgments);
+    buildLanes();
+    reset();
+}
+
+void JudgeEngine::splice(int first, int removeCount, const std::vector<Note> &inserted, qint64 skipBefore) {
+    first = std::clamp(first, 0, int(m_notes.size()));
+    removeCount = std::clamp(removeCount, 0, int(m_notes.size()) - first);
+    const int keys = keyCount();
+
+    // 删掉的物件：还没判定过的从满分里扣掉；已经判定过的计分保留，满分也不扣
+    for (int i = first; i < first + removeCount; ++i) {
+        const Note &note = m_notes[i];
+        const int weight = note.isHold ? 2 : 1;
+        m_totalJudgments -= weight;
+        if (inRange(note) && !note.isHit && !note.isMissed) m_rangeJudgments -= weight;
+    }
+
+    auto at = m_notes.erase(m_notes.begin() + first, m_notes.begin() + first + removeCount);
+    at = m_notes.insert(at, inserted.begin(), inserted.end());
+    for (auto end = at + inserted.size(); at != end; ++at) {
+        Note &note = *at;
+        note.column = std::clamp(note.column, 0, keys - 1);
+        note.isHolding = false;
+        note.isMissed = false;
+        note.isHit = note.time < skipBefore; // 已经过去的新物件直接当作处理过
+        const int weight = note.isHold ? 2 : 1;
+        m_totalJudgments += weight;
+        if (inRange(note) && !note.isHit) m_rangeJudgments += weight;
+    }
+    spliceLanes(first, removeCount, int(inserted.size()));
+
+    // 分数按新的满分重新归一化 (已得的权重分不变)
+    m_score.maxPossibleScore = (m_rangeJudgments == 0) ? 1 : m_rangeJudgments * 300.0;
+    m_score.score = int(m_score.rawScore / m_score.maxPossibleScore * 1000000.0);
+    m_hitErrors.reserve(m_totalJudgments);
+}
+
+void JudgeEngine::setWindow(const JudgmentWindow &window) {
+    m_window = window;
+    setRate(m_rate);
+}
+
+void JudgeEngine::setRate(double rate) {
+    m_rate = std::clamp(rate, 0.25, 4.0);
+    auto scale = [&](int ms) { return int(std::lround(ms * m_rate)); };
+    m_span.perfect = scale(m_window.perfect);
+    m_span.great = scale(m_window.great);
+    m_span.good = scale(m_window.good);
+    m_span.miss = scale(m_window.miss);
+}
+
+void JudgeEngine::resetScore() {
+    m_score = ScoreState();
+    m_score.maxPossibleScore = (m_rangeJudgments == 0) ? 1 : m_rangeJudgments * 300.0;
+    m_hitErrors.clear(); // 保留容量
+}
+
+void JudgeEngine::applyMiss() {
+    m_score.combo = 0;
+    m_score.countMiss++;
+    m_score.totalHits++;
+    addScore(0);
+}
+
+Judgment JudgeEngine::applyHeadHit(int diff) {
+    ScoreState &s = m_score;
+    s.combo++;
+    if (s.combo > s.maxCombo) s.maxCombo = s.combo;
+    s.totalHits++;
+
+    if (diff <= m_span.perfect) {
+        s.countPerfect++;
+        s.totalAccWeight += 1.0;
+        addScore(300);
+        return Judgment::Perfect;
+    }
+    if (diff <= m_span.great) {
+        s.countGreat++;
+        s.totalAccWeight += 0.8;
+        addScore(200);
+        return Judgment::Great;
+    }
+    if (diff <= m_span.good) {
+        s.countGood++;
+        s.totalAccWeight += 0.5;
+        addScore(50);
+        return Judgment::Good;
+    }
+    s.combo = 0;
+    s.countMiss++; // Bad 视为断连但给了0分
+    addScore(0);
+    return Judgment::Bad;
+}
+
+Judgment JudgeEngine::applyTailRelease(int diff) {
+    ScoreState &s = m_score;
+    s.combo++;
+    if (s.combo > s.maxCombo) s.maxCombo = s.combo;
+    s.totalHits++;
+
+    if (diff <= m_span.perfect) {
+        s.countPerfect++;
+        s.totalAccWeight += 1.0;
+        addScore(300);
+        return Judgment::Perfect;
+    }
+    if (diff <= m_span.good) {
+        // 只要在 Good 范围内都给 Great，让长条手感更宽松
+        s.countGreat++;
+        s.totalAccWeight += 0.8;
+        addScore(200);
+        return Judgment::Great;
+    }
+    // 勉强在 Miss 窗口边缘松手
+    s.countGood++;
+    s.totalAccWeight += 0.5;
+    addScore(50);
+    return Judgment::Good;
+}
+
+void JudgeEngine::addScore(int weight) {
+    m_score.rawScore += weight;
+    // 实时分数 = (当前获得权重 / 理论总权重) * 1,000,000
+    m_score.score = int(m_score.rawScore / m_score.maxPossibleScore * 1000000.0);
+}
+
+void JudgeEngine::recordHitError(qint64 error) {
+    // 换回实际毫秒；判定窗口最大也就几百 ms，这里只是防御性截断
+    if (m_rate != 1.0) error = std::llround(error / m_rate);
+    error = std::clamp<qint64>(error, -32768, 32767);
+    m_hitErrors.push_back(qint16(error));
+}
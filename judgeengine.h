@@ -0,0 +1,146 @@
+#ifndef JUDGEENGINE_H
+#define JUDGEENGINE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "Structs.h"
+
+// 一次判定的结果
+enum class Judgment {
+    None = 0,     // 没有判定 (空按 / 没有到期的物件)
+    Perfect,
+    Great,
+    Good,
+    Bad,          // 打到了但误差超出 Good，断连不得分
+    Miss,         // 头部没打
+    MissEarly,    // 长条松手太早
+    MissOverhold  // 长条按过头
+};
+
+// 计分状态 (与界面无关，GameWidget / 命令行工具共用)
+struct ScoreState {
+    int countPerfect = 0;
+    int countGreat = 0;
+    int countGood = 0;
+    int countMiss = 0;
+    int combo = 0;
+    int maxCombo = 0;
+    int totalHits = 0;
+    double totalAccWeight = 0;
+    double rawScore = 0;         // 当前累积的权重分 (Perfect=300, Miss=0)
+    double maxPossibleScore = 1; // 理论最大权重分 (判定总数 * 300)
+    int score = 0;               // 归一化到 1,000,000
+
+    double acc() const { return totalHits == 0 ? 100.0 : totalAccWeight / totalHits * 100.0; }
+    QString grade() const;
+};
+
+// 判定引擎：按列建立物件下标，每列维护一个"第一个未处理物件"的游标，
+// 按键只在该列游标附近查找，每帧的 Miss 扫描也只看各列游标，不再遍历全部物件。
+// 具体实现按键数 (1K ~ 10K) 做模板特化，列数组为定长，列循环可以展开。
+class JudgeEngine {
+public:
+    virtual ~JudgeEngine() = default;
+
+    // keyCount 超出 1 ~ BeatmapInfo::kMaxKeys 时截断
+    static std::unique_ptr<JudgeEngine> create(int keyCount);
+
+    virtual int keyCount() const = 0;
+
+    // notes 需按时间排序，列号在 [0, keyCount) 内
+    void load(const std::vector<Note> &notes);
+    void setWindow(const JudgmentWindow &window);
+    const JudgmentWindow &window() const { return m_window; }
+    // 变速 (rate > 1 变快)：传入的时间和物件时间都是谱面时间，判定窗口按实际毫秒换算成谱面时间，
+    // 记录的判定误差换回实际毫秒，所以不同倍率下窗口宽度和误差图的含义不变
+    void setRate(double rate);
+    double rate() const { return m_rate; }
+    // 换算到谱面时间的判定窗口 (和传入的时间比较时用它，而不是 window())
+    const JudgmentWindow &span() const { return m_span; }
+    // 重新开始：清空物件状态和计分 (保留物件和列索引)；设置了区间时只重置区间内的物件
+    virtual void reset() = 0;
+
+    // 练习区间：只判定开始时间在 [startMs, endMs) 内的物件，之前的物件视为跳过。
+    // 每列二分查找区间边界，区间外的物件一个都不访问；会顺带调用 reset()
+    virtual void setRange(qint64 startMs, qint64 endMs) = 0;
+    void clearRange() { setRange(std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max()); }
+
+    // 热重载：把 notes()[first, first + removeCount) 换成 inserted (按时间排序，且和前后的物件保持有序)。
+    // 只改动涉及的列；其余物件的判定状态、计分和连击都保留，满分按新的判定数重新计算。
+    // 时间早于 skipBefore 的新物件视为已跳过 (不判定、不计入满分)，被删掉的正在按住的长条直接作废
+    void splice(int first, int removeCount, const std::vector<Note> &inserted, qint64 skipBefore);
+
+    virtual Judgment press(int column, qint64 time) = 0;
+    virtual Judgment release(int column, qint64 time) = 0;
+    // 处理到 time 为止已经超出 Miss 窗口的物件，返回最后一个判定 (没有则为 None)
+    virtual Judgment sweep(qint64 time) = 0;
+
+    // lane(column) 中第一个未处理物件的位置 (绘制时从这里开始)
+    virtual int laneCursor(int column) const = 0;
+    // 每列正在按住的长条下标，没有则为 -1
+    virtual int laneHolding(int column) const = 0;
+    // lane(column) 中区间结束的位置 (绘制到这里为止)
+    virtual int laneEnd(int column) const = 0;
+    // 某列按时间排序的物件下标
+    virtual const std::vector<int> &lane(int column) const = 0;
+
+    const std::vector<Note> &notes() const { return m_notes; }
+    const ScoreState &score() const { return m_score; }
+    const std::vector<qint16> &hitErrors() const { return m_hitErrors; }
+    int totalJudgments() const { return m_totalJudgments; }
+    int rangeJudgments() const { return m_rangeJudgments; } // 当前区间内的判定数 (决定满分)
+
+protected:
+    virtual void buildLanes() = 0;
+    // splice 换完 m_notes 之后调用：新物件的下标是 [first, first + insertCount)，之后的下标整体移动
+    virtual void spliceLanes(int first, int removeCount, int insertCount) = 0;
+
+    // 物件的开始时间是否在当前区间内 (和 setRange 的二分边界一致)
+    bool inRange(const Note &note) const { return note.time >= m_rangeStart && note.time < m_rangeEnd; }
+
+    // 清空计分，满分按当前区间的判定数计算
+    void resetScore();
+
+    // 计分：所有判定都经过这里
+    void applyMiss();
+    Judgment applyHeadHit(int diff);
+    Judgment applyTailRelease(int diff);
+    void addScore(int weight);
+    void recordHitError(qint64 error);
+
+    std::vector<Note> m_notes;
+    JudgmentWindow m_window;
+    JudgmentWindow m_span; // 换算到谱面时间的判定窗口 (= m_window * m_rate)
+    double m_rate = 1.0;
+    ScoreState m_score;
+    std::vector<qint16> m_hitErrors; // 加载时按判定总数预分配，游戏中不再分配内存
+    int m_totalJudgments = 0;
+    int m_rangeJudgments = 0;
+    qint64 m_rangeStart = std::numeric_limits<qint64>::min();
+    qint64 m_rangeEnd = std::numeric_limits<qint64>::max();
+};
+
+// 把运行时的键数转成编译期常量：fn(std::integral_constant<int, K>())
+// 判定和绘制的列循环都通过它进入按 K 特化的代码
+template <typename Fn>
+decltype(auto) withKeyCount(int keyCount, Fn &&fn) {
+    switch (std::clamp(keyCount, 1, BeatmapInfo::kMaxKeys)) {
+    case 1: return fn(std::integral_constant<int, 1>());
+    case 2: return fn(std::integral_constant<int, 2>());
+    case 3: return fn(std::integral_constant<int, 3>());
+    case 5: return fn(std::integral_constant<int, 5>());
+    case 6: return fn(std::integral_constant<int, 6>());
+    case 7: return fn(std::integral_constant<int, 7>());
+    case 8: return fn(std::integral_constant<int, 8>());
+    case 9: return fn(std::integral_constant<int, 9>());
+    case 10: return fn(std::integral_constant<int, 10>());
+    default: return fn(std::integral_constant<int, 4>());
+    }
+}
+
+#endif // JUDGEENGINE_H
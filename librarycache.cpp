@@ -0,0 +1,118 @@
+#include "LibraryCache.h"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDebug>
+
+// 文件格式变化时递增版本号，旧缓存会被直接丢弃重建
+static const quint32 kCacheMagic = 0x4F514C43; // "OQLC"
+static const quint32 kCacheVersion = 5;
+
+// 难度统计按字段顺序写入 (float 用单精度保存)
+static QDataStream &operator<<(QDataStream &out, const ChartMetrics &m) {
+    out << m.valid << qint32(m.noteCount) << qint32(m.holdCount) << qint32(m.durationMs)
+        << m.holdRatio << m.avgNps << m.peakNps << m.chordDensity << m.jackDensity << m.stars;
+    for (float jacks : m.columnJacks) out << jacks;
+    return out;
+}
+
+static QDataStream &operator>>(QDataStream &in, ChartMetrics &m) {
+    qint32 noteCount = 0, holdCount = 0, durationMs = 0;
+    in >> m.valid >> noteCount >> holdCount >> durationMs
+       >> m.holdRatio >> m.avgNps >> m.peakNps >> m.chordDensity >> m.jackDensity >> m.stars;
+    for (float &jacks : m.columnJacks) in >> jacks;
+    m.noteCount = noteCount;
+    m.holdCount = holdCount;
+    m.durationMs = durationMs;
+    return in;
+}
+
+LibraryCache::LibraryCache(const QString &cacheFile) : m_cacheFile(cacheFile) {}
+
+QString LibraryCache::defaultPath() {
+    return QCoreApplication::applicationDirPath() + "/cache/library.dat";
+}
+
+bool LibraryCache::load() {
+    m_entries.clear();
+    m_dirty = false;
+
+    QFile file(m_cacheFile);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    quint32 magic = 0, version = 0, count = 0;
+    in >> magic >> version >> count;
+    if (magic != kCacheMagic || version != kCacheVersion) {
+        qDebug() << "Library cache outdated, rebuilding:" << m_cacheFile;
+        return false;
+    }
+
+    m_entries.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Entry e;
+        in >> e.info.filePath >> e.size >> e.mtime >> e.info.contentHash
+           >> e.info.title >> e.info.artist >> e.info.titleRomanised >> e.info.artistRomanised
+           >> e.info.version >> e.info.audioFilename >> e.info.previewTime >> e.info.keyCount >> e.info.metrics;
+        m_entries.insert(e.info.filePath, e);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        // 文件被截断：当作没有缓存
+        m_entries.clear();
+        return false;
+    }
+    return true;
+}
+
+bool LibraryCache::save() {
+    QDir().mkpath(QFileInfo(m_cacheFile).absolutePath());
+
+    QSaveFile file(m_cacheFile);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    out << kCacheMagic << kCacheVersion << quint32(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        const Entry &e = it.value();
+        out << e.info.filePath << e.size << e.mtime << e.info.contentHash
+            << e.info.title << e.info.artist << e.info.titleRomanised << e.info.artistRomanised
+            << e.info.version << e.info.audioFilename << qint32(e.info.previewTime) << qint32(e.info.keyCount) << e.info.metrics;
+    }
+
+    if (!file.commit()) return false;
+    m_dirty = false;
+    return true;
+}
+
+bool LibraryCache::lookup(const QString &path, qint64 size, qint64 mtime, BeatmapInfo &info) const {
+    auto it = m_entries.constFind(path);
+    if (it == m_entries.cend() || it->size != size || it->mtime != mtime) return false;
+    info = it->info;
+    return true;
+}
+
+void LibraryCache::insert(const QString &path, qint64 size, qint64 mtime, const BeatmapInfo &info) {
+    Entry &e = m_entries[path];
+    e.size = size;
+    e.mtime = mtime;
+    e.info = info;
+    e.info.filePath = path;
+    m_dirty = true;
+}
+
+void LibraryCache::retainOnly(const QString &root, const QSet<QString> &paths) {
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it.key().startsWith(root) && !paths.contains(it.key())) {
+            it = m_entries.erase(it);
+            m_dirty = true;
+        } else {
+            ++it;
+        }
+    }
+}
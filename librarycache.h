@@ -0,0 +1,42 @@
+#ifndef LIBRARYCACHE_H
+#define LIBRARYCACHE_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include "Structs.h"
+
+// 谱面库缓存：文件路径 -> (大小, 修改时间, 解析结果 + 内容哈希 + 难度统计)
+// 文件没变就直接复用，重新扫描时不需要再读取、哈希和分析 .osu 文件
+class LibraryCache {
+public:
+    explicit LibraryCache(const QString &cacheFile = defaultPath());
+
+    static QString defaultPath();
+
+    bool load();
+    bool save();
+
+    // 大小和修改时间都一致才算命中
+    bool lookup(const QString &path, qint64 size, qint64 mtime, BeatmapInfo &info) const;
+    void insert(const QString &path, qint64 size, qint64 mtime, const BeatmapInfo &info);
+
+    // 删除 root 目录下本次扫描没有见到的文件 (已被删除或移走)，其它目录的缓存不受影响
+    void retainOnly(const QString &root, const QSet<QString> &paths);
+
+    bool isDirty() const { return m_dirty; }
+    int size() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        qint64 mtime = 0;
+        BeatmapInfo info;
+    };
+
+    QString m_cacheFile;
+    QHash<QString, Entry> m_entries;
+    bool m_dirty = false;
+};
+
+#endif // LIBRARYCACHE_H
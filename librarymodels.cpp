@@ -0,0 +1,198 @@
+#include "LibraryModels.h"
+#include <QColor>
+#include <algorithm>
+#include <numeric>
+
+// 评级徽章：没玩过的谱面显示 "-"
+static QString gradeBadge(const RecordSummary &s) {
+    return s.playCount > 0 ? s.bestGrade : QString("-");
+}
+
+static QColor gradeColor(const QString &grade) {
+    if (grade == "S") return QColor(255, 215, 0);
+    if (grade == "A") return Qt::green;
+    if (grade == "B") return Qt::cyan;
+    if (grade == "C") return Qt::gray;
+    return QColor(120, 120, 120);
+}
+
+static QString summaryToolTip(const RecordSummary &s) {
+    if (s.playCount == 0) return "Not played yet";
+    return QString("Best: %1 (%2)\nBest Acc: %3%\nPlays: %4\nLast: %5")
+        .arg(s.bestScore).arg(s.bestGrade)
+        .arg(QString::number(s.bestAcc, 'f', 2))
+        .arg(s.playCount)
+        .arg(s.lastPlayed.toString("yyyy-MM-dd hh:mm"));
+}
+
+static QString metricsToolTip(const ChartMetrics &m) {
+    if (!m.valid) return QString();
+    return QString("\n\nStars: %1\nNotes: %2 (%3% holds)\nNPS: %4 avg / %5 peak\nChord: %6  Jack: %7/s")
+        .arg(QString::number(m.stars, 'f', 2))
+        .arg(m.noteCount)
+        .arg(QString::number(m.holdRatio * 100, 'f', 0))
+        .arg(QString::number(m.avgNps, 'f', 1))
+        .arg(QString::number(m.peakNps, 'f', 1))
+        .arg(QString::number(m.chordDensity, 'f', 2))
+        .arg(QString::number(m.jackDensity, 'f', 2));
+}
+
+// 排序比较：返回 a 是否应排在 b 前面 (没玩过的统一排在最后)
+static bool lessBySort(LibrarySort sort, const RecordSummary &a, const RecordSummary &b) {
+    if ((a.playCount > 0) != (b.playCount > 0)) return a.playCount > 0;
+    if (sort == LibrarySort::BestScore) return a.bestScore > b.bestScore;
+    if (sort == LibrarySort::Recent) return a.lastPlayed > b.lastPlayed;
+    return false;
+}
+
+// ================= FolderListModel =================
+
+FolderListModel::FolderListModel(QObject *parent) : QAbstractListModel(parent) {
+    rebuildOrder();
+}
+
+void FolderListModel::reload() {
+    beginResetModel();
+    rebuildOrder();
+    endResetModel();
+}
+
+void FolderListModel::setSort(LibrarySort sort) {
+    if (m_sort == sort) return;
+    m_sort = sort;
+    reload();
+}
+
+void FolderListModel::setFilter(LibraryFilterPtr filter) {
+    m_filter = std::move(filter);
+    reload();
+}
+
+void FolderListModel::rebuildOrder() {
+    const BeatmapLibrary &lib = BeatmapLibrary::instance();
+    m_order.clear();
+    if (m_filter && int(m_filter->folderMatch.size()) == lib.folderCount()) {
+        for (int i = 0; i < lib.folderCount(); ++i) {
+            if (m_filter->folderMatch[i]) m_order.push_back(i);
+        }
+    } else {
+        m_order.resize(lib.folderCount());
+        // 扁平表本身就是按文件夹名排好的
+        std::iota(m_order.begin(), m_order.end(), 0);
+    }
+    if (m_sort == LibrarySort::Stars) {
+        // 按文件夹里最难的难度从高到低
+        std::stable_sort(m_order.begin(), m_order.end(), [&](int a, int b) {
+            return lib.folder(a).maxStars > lib.folder(b).maxStars;
+        });
+    } else if (m_sort != LibrarySort::Name) {
+        std::stable_sort(m_order.begin(), m_order.end(), [&](int a, int b) {
+            return lessBySort(m_sort, lib.folderSummary(a), lib.folderSummary(b));
+        });
+    }
+}
+
+int FolderListModel::rowOfFolder(int folderIndex) const {
+    auto it = std::find(m_order.begin(), m_order.end(), folderIndex);
+    return it == m_order.end() ? -1 : int(it - m_order.begin());
+}
+
+int FolderListModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : int(m_order.size());
+}
+
+QVariant FolderListModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= int(m_order.size())) return QVariant();
+
+    const BeatmapLibrary &lib = BeatmapLibrary::instance();
+    int folderIndex = m_order[index.row()];
+
+    switch (role) {
+    case Qt::DisplayRole: {
+        const RecordSummary &s = lib.folderSummary(folderIndex);
+        return QString("[%1] %2").arg(gradeBadge(s), lib.folder(folderIndex).name);
+    }
+    case Qt::ForegroundRole: {
+        const RecordSummary &s = lib.folderSummary(folderIndex);
+        if (s.playCount > 0) return gradeColor(s.bestGrade);
+        return QVariant();
+    }
+    case Qt::ToolTipRole:
+        return summaryToolTip(lib.folderSummary(folderIndex));
+    case FolderIndexRole:
+        return folderIndex;
+    }
+    return QVariant();
+}
+
+// ================= SongListModel =================
+
+SongListModel::SongListModel(QObject *parent) : QAbstractListModel(parent) {}
+
+void SongListModel::setFolder(int folderIndex) {
+    beginResetModel();
+    m_folder = folderIndex;
+    rebuildOrder();
+    endResetModel();
+}
+
+void SongListModel::setSort(LibrarySort sort) {
+    if (m_sort == sort) return;
+    m_sort = sort;
+    setFolder(m_folder);
+}
+
+void SongListModel::setFilter(LibraryFilterPtr filter) {
+    m_filter = std::move(filter);
+    setFolder(m_folder);
+}
+
+void SongListModel::rebuildOrder() {
+    m_order.clear();
+    const BeatmapLibrary &lib = BeatmapLibrary::instance();
+    if (m_folder < 0 || m_folder >= lib.folderCount()) return;
+
+    // 名称排序时保持难度名顺序 (扫描时已排好)
+    const FolderGroup &group = lib.folder(m_folder);
+    const bool filtered = m_filter && int(m_filter->mapMatch.size()) == lib.beatmapCount();
+    for (int id = group.first; id < group.first + group.count; ++id) {
+        if (!filtered || m_filter->mapMatch[id]) m_order.push_back(id);
+    }
+    if (m_sort == LibrarySort::Stars) {
+        std::stable_sort(m_order.begin(), m_order.end(), [&](int a, int b) {
+            return lib.metrics(a).stars > lib.metrics(b).stars;
+        });
+    } else if (m_sort != LibrarySort::Name) {
+        std::stable_sort(m_order.begin(), m_order.end(), [&](int a, int b) {
+            return lessBySort(m_sort, lib.mapSummary(a), lib.mapSummary(b));
+        });
+    }
+}
+
+int SongListModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : int(m_order.size());
+}
+
+QVariant SongListModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= int(m_order.size())) return QVariant();
+
+    const BeatmapLibrary &lib = BeatmapLibrary::instance();
+    int id = m_order[index.row()];
+
+    switch (role) {
+    case Qt::DisplayRole: {
+        return QString("[%1] [%2] %3  (%4*)").arg(gradeBadge(lib.mapSummary(id)), lib.version(id), lib.title(id),
+                                                QString::number(lib.metrics(id).stars, 'f', 2));
+    }
+    case Qt::ForegroundRole: {
+        const RecordSummary &s = lib.mapSummary(id);
+        if (s.playCount > 0) return gradeColor(s.bestGrade);
+        return QVariant();
+    }
+    case Qt::ToolTipRole:
+        return summaryToolTip(lib.mapSummary(id)) + metricsToolTip(lib.metrics(id));
+    case BeatmapIdRole:
+        return id;
+    }
+    return QVariant();
+}
@@ -0,0 +1,73 @@
+#ifndef LIBRARYMODELS_H
+#define LIBRARYMODELS_H
+
+#include <QAbstractListModel>
+#include <memory>
+#include <vector>
+#include "BeatmapLibrary.h"
+
+// 与选歌界面 comboSort 的下拉项顺序一致
+enum class LibrarySort { Name = 0, BestScore, Recent, Stars };
+
+// 搜索结果过滤：按谱面下标 / 文件夹下标标记是否匹配 (两个模型共享同一份)
+struct LibraryFilter {
+    std::vector<char> mapMatch;
+    std::vector<char> folderMatch;
+    int matchCount = 0;
+};
+using LibraryFilterPtr = std::shared_ptr<const LibraryFilter>;
+
+// 模型只保存一个下标排列 (int 数组)，显示文字在 data() 中按需生成，
+// 视图只对可见行调用 data()，切换文件夹 / 重新排序只需要重排这个数组
+class FolderListModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    // Qt::UserRole 返回文件夹在 BeatmapLibrary 中的下标
+    static constexpr int FolderIndexRole = Qt::UserRole;
+
+    explicit FolderListModel(QObject *parent = nullptr);
+
+    void reload(); // 谱面库重新扫描后调用
+    void setSort(LibrarySort sort);
+    void setFilter(LibraryFilterPtr filter); // nullptr 表示不过滤
+    int rowOfFolder(int folderIndex) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    void rebuildOrder();
+
+    LibrarySort m_sort = LibrarySort::Name;
+    LibraryFilterPtr m_filter;
+    std::vector<int> m_order; // 行 -> 文件夹下标
+};
+
+class SongListModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    // Qt::UserRole 返回谱面在 BeatmapLibrary 中的下标
+    static constexpr int BeatmapIdRole = Qt::UserRole;
+
+    explicit SongListModel(QObject *parent = nullptr);
+
+    void setFolder(int folderIndex); // -1 表示清空
+    void setSort(LibrarySort sort);
+    void setFilter(LibraryFilterPtr filter);
+    int folder() const { return m_folder; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    void rebuildOrder();
+
+    LibrarySort m_sort = LibrarySort::Name;
+    LibraryFilterPtr m_filter;
+    int m_folder = -1;
+    std::vector<int> m_order; // 行 -> 谱面下标
+};
+
+#endif // LIBRARYMODELS_H
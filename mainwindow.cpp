@@ -1,9 +1,29 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 #include "SettingsDialog.h"
+#include <QActionGroup>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QLabel>
+#include <QMenu>
+#include <QMenuBar>
+#include <QStatusBar>
 #include <QVBoxLayout>
+#include <algorithm>
 #include "SongSelectWindow.h"
+#include "RecordStore.h"
+#include "AudioCache.h"
+#include "Trace.h"
+
+// 将毫秒转为 mm:ss (练习区间需要精确到毫秒：mm:ss.zzz)
+static QString formatTime(qint64 ms, bool withMs = false) {
+    qint64 s = ms / 1000;
+    qint64 m = s / 60;
+    s = s % 60;
+    QString text = QString("%1:%2").arg(m, 2, 10, QChar('0')).arg(s, 2, 10, QChar('0'));
+    if (withMs) text += QString(".%1").arg(ms % 1000, 3, 10, QChar('0'));
+    return text;
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -11,6 +31,9 @@ MainWindow::MainWindow(QWidget *parent)
 {
     ui->setupUi(this);
 
+    // 0. 启动时加载一次成绩摘要索引 (选歌界面的评级徽章/排序都依赖它)
+    RecordStore::instance().load();
+
     // 1. 创建游戏控件
     m_gameWidget = new GameWidget(this);
 
@@ -28,15 +51,114 @@ MainWindow::MainWindow(QWidget *parent)
 
     // 3. 连接信号槽
     // 游戏逻辑 -> 界面更新
-    connect(m_gameWidget, &GameWidget::statsChanged, this, &MainWindow::updateStats);
+    connect(m_gameWidget, &GameWidget::statsUpdated, this, &MainWindow::updateStats);
     connect(m_gameWidget, &GameWidget::songLoaded, this, &MainWindow::updateSongInfo);
-    connect(m_gameWidget, &GameWidget::progressChanged, this, &MainWindow::updateProgress);
+    connect(m_gameWidget, &GameWidget::recordSaved, this, [this](QString filePath, int score) {
+        statusBar()->showMessage(QString("Record saved: %1 (%2)").arg(score).arg(QFileInfo(filePath).fileName()), 5000);
+    });
+    connect(m_gameWidget, &GameWidget::recordSaveFailed, this, [this](QString filePath, QString error) {
+        statusBar()->showMessage(QString("Failed to save record: %1 (%2)").arg(error, filePath));
+    });
+
+    // 区间练习：每轮结算显示在状态栏
+    connect(m_gameWidget, &GameWidget::practiceChanged, this, [this](const PracticeSection &section) {
+        if (section.active) {
+            statusBar()->showMessage(QString("Practice: %1 - %2").arg(formatTime(section.startMs, true),
+                                                                     formatTime(section.endMs, true)));
+        } else if (section.startMs >= 0) {
+            statusBar()->showMessage(QString("Loop start: %1 (press ] to set end)").arg(formatTime(section.startMs, true)));
+        } else {
+            statusBar()->showMessage("Practice stopped", 3000);
+        }
+    });
+    connect(m_gameWidget, &GameWidget::practiceLoopFinished, this, [this](int iteration, const GameStats &stats) {
+        statusBar()->showMessage(QString("Loop #%1: %2  %3%  (%4 / %5 / %6 / %7)")
+                                 .arg(iteration).arg(stats.score)
+                                 .arg(QString::number(stats.acc, 'f', 2))
+                                 .arg(stats.perfect).arg(stats.great).arg(stats.good).arg(stats.miss));
+    });
 
     // 按钮 -> 功能
     connect(ui->btnOpen, &QPushButton::clicked, this, &MainWindow::onOpenTriggered);
     connect(ui->btnSettings, &QPushButton::clicked, this, &MainWindow::onSettingsTriggered);
     connect(ui->actionOpen, &QAction::triggered, this, &MainWindow::onOpenTriggered);
     connect(ui->actionSettings, &QAction::triggered, this, &MainWindow::onSettingsTriggered);
+    connect(ui->actionLoopStart, &QAction::triggered, m_gameWidget, &GameWidget::markLoopStart);
+    connect(ui->actionLoopEnd, &QAction::triggered, m_gameWidget, &GameWidget::markLoopEnd);
+    connect(ui->actionStopPractice, &QAction::triggered, m_gameWidget, &GameWidget::stopPractice);
+
+    // 显示延迟补偿开关 (测得的延迟常驻在状态栏右侧)
+    m_latencyLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_latencyLabel);
+    ui->menuEdit->addSeparator();
+    QAction *latencyAction = ui->menuEdit->addAction("Display Latency Compensation");
+    latencyAction->setCheckable(true);
+    latencyAction->setChecked(m_gameWidget->getConfig().latencyCompensation);
+    connect(latencyAction, &QAction::toggled, this, [this](bool on) {
+        m_gameWidget->setLatencyCompensation(on);
+        m_gameWidget->setFocus();
+    });
+
+    // 谱面热重载：结果显示在状态栏；回退开关存进设置
+    connect(m_gameWidget, &GameWidget::chartReloaded, this, [this](qint64 firstChangeMs, int removed, int added, qint64 latencyMs) {
+        statusBar()->showMessage(QString("Chart reloaded: -%1 / +%2 notes from %3 (%4 ms)")
+                                 .arg(removed).arg(added).arg(formatTime(firstChangeMs, true)).arg(latencyMs), 5000);
+    });
+    QAction *rewindAction = ui->menuEdit->addAction("Rewind on Chart Reload");
+    rewindAction->setCheckable(true);
+    rewindAction->setChecked(m_gameWidget->getConfig().reloadRewind);
+    connect(rewindAction, &QAction::toggled, this, [this](bool on) {
+        GameConfig config = m_gameWidget->getConfig();
+        config.reloadRewind = on;
+        m_gameWidget->updateConfig(config);
+        m_gameWidget->setFocus();
+    });
+
+    // 自动游玩 (从头重来，不保存成绩)
+    ui->menuPractice->addSeparator();
+    QAction *autoplayAction = ui->menuPractice->addAction("Autoplay");
+    autoplayAction->setCheckable(true);
+    connect(autoplayAction, &QAction::toggled, this, [this](bool on) {
+        m_gameWidget->setAutoplay(on);
+        m_gameWidget->setFocus();
+        statusBar()->showMessage(on ? "Autoplay on" : "Autoplay off", 3000);
+    });
+
+    // 变速：同一首歌切回用过的倍率时直接命中缓存
+    QMenu *menuRate = menuBar()->addMenu("Rate");
+    QActionGroup *rateGroup = new QActionGroup(this);
+    for (double rate : {0.5, 0.75, 1.0, 1.25, 1.5, 2.0}) {
+        QAction *action = menuRate->addAction(QString("%1x").arg(rate));
+        action->setCheckable(true);
+        action->setChecked(rate == 1.0);
+        rateGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [this, rate]() {
+            m_gameWidget->setRate(rate);
+            m_gameWidget->setFocus();
+            statusBar()->showMessage(QString("Rate: %1x").arg(rate), 3000);
+        });
+    }
+
+    // 埋点：运行时开关 (环境变量 OSU_TRACE=1 时启动即开始记录)，随时导出最近的事件
+    if (Trace::compiledIn()) {
+        Trace::setEnabled(qEnvironmentVariableIntValue("OSU_TRACE") != 0);
+        QMenu *menuTrace = menuBar()->addMenu("Trace");
+        QAction *recordAction = menuTrace->addAction("Record Trace");
+        recordAction->setCheckable(true);
+        recordAction->setChecked(Trace::isEnabled());
+        connect(recordAction, &QAction::toggled, this, [](bool on) { Trace::setEnabled(on); });
+        QAction *clearAction = menuTrace->addAction("Clear Trace");
+        connect(clearAction, &QAction::triggered, this, []() { Trace::clear(); });
+        QAction *saveAction = menuTrace->addAction("Save Trace...");
+        connect(saveAction, &QAction::triggered, this, [this]() {
+            const QString path = QFileDialog::getSaveFileName(this, "Save Trace", "osu-trace.json", "Trace (*.json)");
+            if (path.isEmpty()) return;
+            QString error;
+            const int events = Trace::dump(path, &error);
+            statusBar()->showMessage(events < 0 ? QString("Trace save failed: %1").arg(error)
+                                                : QString("Trace: %1 events saved (open in ui.perfetto.dev)").arg(events), 5000);
+        });
+    }
 
     // 设置默认窗口标题
     setWindowTitle("MugDiffusion Player");
@@ -58,16 +180,18 @@ void MainWindow::onOpenTriggered() {
         // 如果用户在选歌界面改了文件夹，这里会通过引用更新 config
         m_gameWidget->updateConfig(config);
 
-        QString path = dlg.getSelectedBeatmapPath();
-        if (!path.isEmpty()) {
-            m_gameWidget->loadBeatmap(path);
+        BeatmapInfo info = dlg.getSelectedBeatmap();
+        if (!info.filePath.isEmpty()) {
+            // 把扫描时算好的内容哈希一起传过去，作为成绩记录的主键
+            m_gameWidget->loadBeatmap(info.filePath, info.getHash());
             m_gameWidget->setFocus();
+            statusBar()->showMessage(AudioCache::instance().statsText(), 5000);
         }
     }
 }
 
 void MainWindow::onSettingsTriggered() {
-    SettingsDialog dlg(m_gameWidget->getConfig(), this);
+    SettingsDialog dlg(m_gameWidget->getConfig(), m_gameWidget->keyCount(), this);
     if (dlg.exec() == QDialog::Accepted) {
         GameConfig config = dlg.getConfig();
         m_gameWidget->updateConfig(config);
@@ -76,16 +200,44 @@ void MainWindow::onSettingsTriggered() {
     }
 }
 
-void MainWindow::updateStats(int perfect, int great, int good, int miss, int combo, int maxCombo, int score, double acc) {
-    // 直接操作 ui 指针里的控件
-    ui->lblPerfect->setText(QString::number(perfect));
-    ui->lblGreat->setText(QString::number(great));
-    ui->lblGood->setText(QString::number(good));
-    ui->lblMiss->setText(QString::number(miss));
-    ui->lblCombo->setText(QString::number(combo));
-    ui->lblScore->setText(QString("%1").arg(score, 7, 10, QChar('0')));
-    ui->lblAcc->setText(QString::number(acc, 'f', 2) + "%");
-    ui->lblMaxCombo->setText(QString::number(maxCombo));
+void MainWindow::updateStats(const GameStats &stats) {
+    // 与上次显示的值逐项比较，没变的控件不动
+    const bool all = !m_statsShown;
+    const GameStats &old = m_shownStats;
+
+    if (all || stats.perfect != old.perfect) ui->lblPerfect->setText(QString::number(stats.perfect));
+    if (all || stats.great != old.great) ui->lblGreat->setText(QString::number(stats.great));
+    if (all || stats.good != old.good) ui->lblGood->setText(QString::number(stats.good));
+    if (all || stats.miss != old.miss) ui->lblMiss->setText(QString::number(stats.miss));
+    if (all || stats.combo != old.combo) ui->lblCombo->setText(QString::number(stats.combo));
+    if (all || stats.maxCombo != old.maxCombo) ui->lblMaxCombo->setText(QString::number(stats.maxCombo));
+    if (all || stats.score != old.score) ui->lblScore->setText(QString("%1").arg(stats.score, 7, 10, QChar('0')));
+    // 准确率按显示精度比较 (两位小数)
+    if (all || qRound(stats.acc * 100) != qRound(old.acc * 100)) {
+        ui->lblAcc->setText(QString::number(stats.acc, 'f', 2) + "%");
+    }
+
+    // 进度条以 100ms 为单位刷新，时间文字以秒为单位刷新
+    const qint64 current = std::min(stats.currentTime, stats.duration);
+    const qint64 oldCurrent = std::min(old.currentTime, old.duration);
+    if (all || stats.duration != old.duration) ui->progressBar->setMaximum(int(stats.duration));
+    if (all || current / 100 != oldCurrent / 100 || stats.duration != old.duration) {
+        ui->progressBar->setValue(int(current / 100 * 100));
+    }
+    if (all || current / 1000 != oldCurrent / 1000 || stats.duration / 1000 != old.duration / 1000) {
+        ui->lblTime->setText(QString("%1 / %2").arg(formatTime(current)).arg(formatTime(stats.duration)));
+    }
+
+    // 显示延迟按 0.1ms 比较
+    if (all || qRound(stats.displayLatencyMs * 10) != qRound(old.displayLatencyMs * 10)
+        || stats.latencyCompensated != old.latencyCompensated) {
+        m_latencyLabel->setText(QString("Display latency: %1 ms%2")
+                                .arg(QString::number(stats.displayLatencyMs, 'f', 1),
+                                     stats.latencyCompensated ? " (compensated)" : ""));
+    }
+
+    m_shownStats = stats;
+    m_statsShown = true;
 }
 
 void MainWindow::updateSongInfo(QString title, QString artist, qint64 duration) {
@@ -93,20 +245,3 @@ void MainWindow::updateSongInfo(QString title, QString artist, qint64 duration)
     ui->lblArtist->setText(artist);
     ui->progressBar->setMaximum(duration);
 }
-
-void MainWindow::updateProgress(qint64 current, qint64 total) {
-    if (current > total) current = total;
-
-    ui->progressBar->setMaximum(total);
-    ui->progressBar->setValue(current);
-
-    // 辅助 lambda：将毫秒转为 mm:ss
-    auto formatTime = [](qint64 ms) {
-        qint64 s = ms / 1000;
-        qint64 m = s / 60;
-        s = s % 60;
-        return QString("%1:%2").arg(m, 2, 10, QChar('0')).arg(s, 2, 10, QChar('0'));
-    };
-
-    ui->lblTime->setText(QString("%1 / %2").arg(formatTime(current)).arg(formatTime(total)));
-}
@@ -4,6 +4,8 @@
 #include <QMainWindow>
 #include "GameWidget.h"
 
+class QLabel;
+
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
@@ -20,12 +22,15 @@ private slots:
     void onSettingsTriggered();
 
     // 槽函数：接收 GameWidget 发来的数据更新界面
-    void updateStats(int perfect, int great, int good, int miss, int combo, int maxCombo, int score, double acc);
+    void updateStats(const GameStats &stats);
     void updateSongInfo(QString title, QString artist, qint64 duration);
-    void updateProgress(qint64 current, qint64 total);
 
 private:
     Ui::MainWindow *ui;
+    // 当前显示的统计：只有数值变化的标签才 setText，避免无谓的重新布局
+    GameStats m_shownStats;
+    bool m_statsShown = false;
     GameWidget *m_gameWidget; // 我们将在代码中把这个塞进 ui->gameContainer
+    QLabel *m_latencyLabel;   // 状态栏右侧：估计的显示延迟
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,158 @@
+#include "OsuParser.h"
+#include <QByteArrayView>
+#include <QString>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace OsuParser {
+
+// "Key:Value" -> Value (去掉首尾空白)
+static QString valueOf(QByteArrayView line, qsizetype keyLen) {
+    return QString::fromUtf8(line.sliced(keyLen).trimmed());
+}
+
+// 逐行遍历 (不复制数据)，回调返回 false 时停止
+template <typename Fn>
+static void forEachLine(const QByteArray &data, Fn fn) {
+    QByteArrayView all(data);
+    qsizetype pos = 0;
+    while (pos < all.size()) {
+        qsizetype nl = all.indexOf('\n', pos);
+        if (nl < 0) nl = all.size();
+        QByteArrayView line = all.sliced(pos, nl - pos).trimmed();
+        pos = nl + 1;
+        if (!line.isEmpty() && !fn(line)) return;
+    }
+}
+
+void parseHeader(const QByteArray &data, BeatmapInfo &info) {
+    forEachLine(data, [&info](QByteArrayView line) {
+        if (line.startsWith('[')) {
+            // 头部信息都在 [Events] 之前，后面是大量的时间点和物件，不必再读
+            return !(line.startsWith("[Events]") || line.startsWith("[TimingPoints]") || line.startsWith("[HitObjects]"));
+        }
+
+        if (line.startsWith("Title:")) {
+            info.titleRomanised = valueOf(line, 6);
+            info.title = info.titleRomanised;
+        }
+        else if (line.startsWith("TitleUnicode:")) info.title = valueOf(line, 13); // 优先用 Unicode
+        else if (line.startsWith("Artist:")) {
+            info.artistRomanised = valueOf(line, 7);
+            info.artist = info.artistRomanised;
+        }
+        else if (line.startsWith("ArtistUnicode:")) info.artist = valueOf(line, 14);
+        else if (line.startsWith("Version:")) info.version = valueOf(line, 8);
+        else if (line.startsWith("AudioFilename:")) info.audioFilename = valueOf(line, 14);
+        else if (line.startsWith("PreviewTime:")) info.previewTime = line.sliced(12).trimmed().toInt();
+        else if (line.startsWith("CircleSize:")) {
+            int keys = int(std::lround(line.sliced(11).trimmed().toDouble()));
+            info.keyCount = std::clamp(keys, 1, BeatmapInfo::kMaxKeys);
+        }
+        return true;
+    });
+}
+
+void parseTimingPoints(const QByteArray &data, std::vector<TimingPoint> &points) {
+    points.clear();
+    bool inTimingPoints = false;
+    forEachLine(data, [&](QByteArrayView line) {
+        if (line.startsWith('[')) {
+            if (inTimingPoints) return false;
+            inTimingPoints = line.startsWith("[TimingPoints]");
+            return true;
+        }
+        if (!inTimingPoints) return true;
+
+        // 只需要前 7 个字段：time, beatLength, ..., uninherited (旧格式没有这一列，默认为红线)
+        QByteArrayView fields[7];
+        int count = 0;
+        qsizetype start = 0;
+        while (count < 7) {
+            qsizetype comma = line.indexOf(',', start);
+            fields[count++] = (comma < 0) ? line.sliced(start) : line.sliced(start, comma - start);
+            if (comma < 0) break;
+            start = comma + 1;
+        }
+        if (count < 2) return true;
+
+        TimingPoint p;
+        p.time = int(std::lround(fields[0].toDouble())); // 部分谱面的时间带小数
+        p.beatLength = fields[1].toDouble();
+        p.uninherited = (count < 7) ? true : fields[6].toInt() != 0;
+        points.push_back(p);
+        return true;
+    });
+}
+
+void parseHitObjects(const QByteArray &data, int keyCount, std::vector<Note> &notes, ParseReport *report) {
+    notes.clear();
+    keyCount = std::clamp(keyCount, 1, BeatmapInfo::kMaxKeys);
+
+    ParseReport unused;
+    ParseReport &r = report ? *report : unused;
+    r = ParseReport();
+    int lastTime = std::numeric_limits<int>::min();
+    bool inHitObjects = false;
+    forEachLine(data, [&](QByteArrayView line) {
+        if (line.startsWith('[')) {
+            // [HitObjects] 一般是最后一段，之后再出现段落就结束
+            if (inHitObjects) return false;
+            inHitObjects = line.startsWith("[HitObjects]");
+            return true;
+        }
+        if (!inHitObjects) return true;
+        r.objectLines++;
+
+        // x,y,time,type,hitSound,extras —— 只切出前 6 个字段
+        QByteArrayView fields[6];
+        int count = 0;
+        qsizetype start = 0;
+        while (count < 6) {
+            qsizetype comma = line.indexOf(',', start);
+            if (comma < 0 || count == 5) {
+                fields[count++] = line.sliced(start);
+                break;
+            }
+            fields[count++] = line.sliced(start, comma - start);
+            start = comma + 1;
+        }
+        if (count < 4) {
+            r.malformedLines++;
+            return true;
+        }
+
+        double x = fields[0].toDouble();
+        int time = fields[2].toInt();
+        int type = fields[3].toInt();
+
+        if (time < lastTime && r.unsortedCount++ == 0) r.firstUnsortedTime = time;
+        lastTime = time;
+
+        int col = int(std::floor(x * keyCount / 512));
+        col = std::clamp(col, 0, keyCount - 1);
+
+        // 长条格式: x,y,time,type,hitSound,endTime:extras (type 第 7 位)
+        bool isHold = (type & 128) != 0;
+        int endTime = time;
+        if (isHold && count > 5) {
+            QByteArrayView extra = fields[5];
+            qsizetype colon = extra.indexOf(':');
+            endTime = (colon < 0 ? extra : extra.first(colon)).toInt();
+            if (endTime < time) {
+                if (r.reversedHolds++ == 0) r.firstReversedTime = time;
+                endTime = time;
+            }
+        }
+
+        notes.push_back({col, time, endTime, isHold, false, false, false});
+        return true;
+    });
+
+    std::sort(notes.begin(), notes.end(), [](const Note &a, const Note &b) {
+        return a.time != b.time ? a.time < b.time : a.column < b.column;
+    });
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef OSUPARSER_H
+#define OSUPARSER_H
+
+#include <QByteArray>
+#include <vector>
+#include "Structs.h"
+#include "ScrollIndex.h"
+
+// .osu 文本解析 (不依赖 GUI，选歌扫描 / 游戏加载共用)
+namespace OsuParser {
+
+// 解析 [General] / [Metadata] / [Difficulty] 中的谱面信息，读到 [Events] 之后的段落即停止
+// 不会修改 info.filePath 和 info.contentHash
+void parseHeader(const QByteArray &data, BeatmapInfo &info);
+
+// 解析 [TimingPoints] (time,beatLength,meter,sampleSet,sampleIndex,volume,uninherited,effects)
+void parseTimingPoints(const QByteArray &data, std::vector<TimingPoint> &points);
+
+// 解析过程中发现、但已被自动修正的问题 (供命令行工具校验谱面)
+struct ParseReport {
+    int objectLines = 0;   // [HitObjects] 中的行数
+    int malformedLines = 0; // 字段不足被跳过的行
+    int unsortedCount = 0;  // 时间比上一行早的物件 (结果会重新排序)
+    int reversedHolds = 0;  // endTime < time 的长条 (已截断成 endTime = time)
+    int firstUnsortedTime = -1;
+    int firstReversedTime = -1;
+};
+
+// 解析 [HitObjects]：x 坐标按 keyCount 映射到列，结果按 (时间, 列) 排序
+// report 不为空时记录原始数据中的问题
+void parseHitObjects(const QByteArray &data, int keyCount, std::vector<Note> &notes,
+                     ParseReport *report = nullptr);
+
+}
+
+#endif // OSUPARSER_H
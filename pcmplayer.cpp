@@ -0,0 +1,86 @@
+#include "PcmPlayer.h"
+#include <QAudioSink>
+#include <QMediaDevices>
+#include <cstring>
+
+qint64 PcmPlayer::Source::readData(char *data, qint64 maxlen) {
+    const qint64 n = std::min(maxlen, m_pcm.size() - m_pos);
+    if (n <= 0) return 0;
+    std::memcpy(data, m_pcm.constData() + m_pos, size_t(n));
+    m_pos += n;
+    return n;
+}
+
+PcmPlayer::PcmPlayer(QObject *parent) : QObject(parent) {
+    m_source.open(QIODevice::ReadOnly);
+}
+
+PcmPlayer::~PcmPlayer() {
+    if (m_sink) m_sink->stop();
+}
+
+void PcmPlayer::setAudio(DecodedAudioPtr audio) {
+    stop();
+    m_audio = std::move(audio);
+    m_source.setData(m_audio ? m_audio->pcm : QByteArray());
+}
+
+void PcmPlayer::ensureSink() {
+    // 只有格式变化时才重建输出设备
+    if (m_sink && m_sinkFormat == m_audio->format) return;
+    delete m_sink;
+    m_sinkFormat = m_audio->format;
+    m_sink = new QAudioSink(QMediaDevices::defaultAudioOutput(), m_sinkFormat, this);
+    m_sink->setVolume(m_volume);
+    connect(m_sink, &QAudioSink::stateChanged, this, &PcmPlayer::onSinkStateChanged);
+}
+
+void PcmPlayer::play() {
+    if (!m_audio || m_playing) return;
+    ensureSink();
+    m_startMs = m_audio->format.durationForBytes(m_source.bytePos()) / 1000;
+    m_playing = true;
+    m_sink->start(&m_source);
+}
+
+void PcmPlayer::stop() {
+    m_playing = false;
+    if (m_sink) m_sink->stop();
+    m_source.seekBytes(0);
+    m_startMs = 0;
+}
+
+void PcmPlayer::setPosition(qint64 ms) {
+    if (!m_audio) return;
+    const bool wasPlaying = m_playing;
+    if (wasPlaying) {
+        m_playing = false;
+        m_sink->stop();
+    }
+    const QAudioFormat &format = m_audio->format;
+    qint64 bytes = format.bytesForDuration(std::max<qint64>(0, ms) * 1000);
+    bytes -= bytes % format.bytesPerFrame();
+    m_source.seekBytes(bytes);
+    m_startMs = format.durationForBytes(m_source.bytePos()) / 1000;
+    if (wasPlaying) play();
+}
+
+qint64 PcmPlayer::position() const {
+    if (!m_playing || !m_sink) return m_startMs;
+    return m_startMs + m_sink->processedUSecs() / 1000;
+}
+
+void PcmPlayer::setVolume(float volume) {
+    m_volume = volume;
+    if (m_sink) m_sink->setVolume(volume);
+}
+
+void PcmPlayer::onSinkStateChanged(QAudio::State state) {
+    // 数据读完后设备进入 Idle；中途缓冲不足也会 Idle，那时数据源还没到结尾
+    if (state == QAudio::IdleState && m_playing && m_source.atEnd()) {
+        m_playing = false;
+        m_sink->stop();
+        m_startMs = duration();
+        emit finished();
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef PCMPLAYER_H
+#define PCMPLAYER_H
+
+#include <QObject>
+#include <QIODevice>
+#include <QAudioFormat>
+#include <QAudio>
+#include "AudioCache.h"
+
+class QAudioSink;
+
+// 直接从内存中的 PCM 播放 (替代 QMediaPlayer)：
+// 不经过解码器，换歌 / 重来 / 跳转只是改一下读取位置
+class PcmPlayer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit PcmPlayer(QObject *parent = nullptr);
+    ~PcmPlayer();
+
+    void setAudio(DecodedAudioPtr audio); // 会先停止播放并回到开头
+    DecodedAudioPtr audio() const { return m_audio; }
+    bool hasAudio() const { return m_audio != nullptr; }
+
+    void play();
+    void stop(); // 停止并回到开头
+    void setPosition(qint64 ms);
+    qint64 position() const; // ms
+    qint64 duration() const { return m_audio ? m_audio->durationMs : 0; }
+    bool isPlaying() const { return m_playing; }
+    void setVolume(float volume);
+
+signals:
+    void finished(); // 播放到结尾
+
+private:
+    // 拉模式数据源：QAudioSink 需要数据时直接从共享的 PCM 拷贝
+    class Source : public QIODevice {
+    public:
+        void setData(const QByteArray &pcm) { m_pcm = pcm; m_pos = 0; }
+        void seekBytes(qint64 pos) { m_pos = qBound<qint64>(0, pos, m_pcm.size()); }
+        qint64 bytePos() const { return m_pos; }
+        bool atEnd() const override { return m_pos >= m_pcm.size(); }
+        bool isSequential() const override { return true; }
+        qint64 bytesAvailable() const override { return m_pcm.size() - m_pos + QIODevice::bytesAvailable(); }
+
+    protected:
+        qint64 readData(char *data, qint64 maxlen) override;
+        qint64 writeData(const char *, qint64) override { return -1; }
+
+    private:
+        QByteArray m_pcm; // 隐式共享，不复制
+        qint64 m_pos = 0;
+    };
+
+    void ensureSink();
+    void onSinkStateChanged(QAudio::State state);
+
+    DecodedAudioPtr m_audio;
+    QAudioSink *m_sink = nullptr;
+    QAudioFormat m_sinkFormat;
+    Source m_source;
+    float m_volume = 1.0f;
+    bool m_playing = false;
+    qint64 m_startMs = 0; // 本次 start() 时的播放位置，position() = m_startMs + 已处理时长
+};
+
+#endif // PCMPLAYER_H
@@ -0,0 +1,190 @@
+#include "PreviewPlayer.h"
+#include "AudioDecode.h"
+#include "AudioCache.h"
+#include <QAudioSink>
+#include <QMediaDevices>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QList>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+static const qint64 kSnippetMs = 12000;             // 每段预览的长度
+static const qint64 kFadeInMs = 150;
+static const qint64 kFadeOutMs = 1500;
+static const qint64 kCacheLimit = 48 * 1024 * 1024; // 片段缓存上限 (约 20 段)
+static const float kPreviewVolume = 0.6f;
+
+namespace {
+
+// 按字节数淘汰的 LRU (最近使用的在最前)，解码线程和 GUI 线程都会访问
+class SnippetCache {
+public:
+    static SnippetCache &instance() {
+        static SnippetCache cache;
+        return cache;
+    }
+
+    PreviewSnippetPtr get(const QString &key) {
+        QMutexLocker locker(&m_mutex);
+        for (qsizetype i = 0; i < m_entries.size(); ++i) {
+            if (m_entries[i]->key == key) {
+                m_entries.move(i, 0);
+                return m_entries.first();
+            }
+        }
+        return nullptr;
+    }
+
+    void put(const PreviewSnippetPtr &snippet) {
+        QMutexLocker locker(&m_mutex);
+        m_entries.prepend(snippet);
+        m_bytes += snippet->pcm.size();
+        while (m_bytes > kCacheLimit && m_entries.size() > 1) {
+            m_bytes -= m_entries.last()->pcm.size();
+            m_entries.removeLast();
+        }
+    }
+
+    qint64 bytes() const { QMutexLocker locker(&m_mutex); return m_bytes; }
+    int count() const { QMutexLocker locker(&m_mutex); return int(m_entries.size()); }
+
+private:
+    mutable QMutex m_mutex;
+    QList<PreviewSnippetPtr> m_entries;
+    qint64 m_bytes = 0;
+};
+
+}
+
+// 16 位 PCM 开头淡入、结尾淡出，避免从歌曲中间切入时的爆音
+static void applyFades(QByteArray &pcm, const QAudioFormat &format) {
+    if (format.sampleFormat() != QAudioFormat::Int16 || format.channelCount() <= 0) return;
+    const int channels = format.channelCount();
+    qint16 *samples = reinterpret_cast<qint16 *>(pcm.data());
+    const qint64 frames = pcm.size() / format.bytesPerFrame();
+    const qint64 fadeIn = std::min<qint64>(frames, format.framesForDuration(kFadeInMs * 1000));
+    const qint64 fadeOut = std::min<qint64>(frames, format.framesForDuration(kFadeOutMs * 1000));
+
+    for (qint64 f = 0; f < fadeIn; ++f) {
+        const float gain = float(f) / fadeIn;
+        for (int c = 0; c < channels; ++c) samples[f * channels + c] = qint16(samples[f * channels + c] * gain);
+    }
+    for (qint64 f = frames - fadeOut; f < frames; ++f) {
+        const float gain = float(frames - f) / fadeOut;
+        for (int c = 0; c < channels; ++c) samples[f * channels + c] = qint16(samples[f * channels + c] * gain);
+    }
+}
+
+// 工作线程：解码一段预览并放进缓存 (取消或失败返回 nullptr)
+// 整首已经在 AudioCache 里时 (预读或玩过)，直接截取一段，不经过解码器
+static bool sliceFromCache(const QString &audioPath, qint64 startMs, AudioDecode::Result &r) {
+    DecodedAudioPtr audio = AudioCache::instance().peek(audioPath);
+    if (!audio) return false;
+
+    const QAudioFormat &format = audio->format;
+    if (startMs >= audio->durationMs) startMs = 0;
+    qint64 begin = format.bytesForDuration(startMs * 1000);
+    begin -= begin % format.bytesPerFrame();
+    const qint64 length = std::min<qint64>(format.bytesForDuration(kSnippetMs * 1000), audio->pcm.size() - begin);
+
+    r.ok = length > 0;
+    r.format = format;
+    r.pcm = audio->pcm.mid(begin, length);
+    return r.ok;
+}
+
+static PreviewSnippetPtr decodeSnippet(const QString &key, const QString &audioPath, qint64 startMs,
+                                       std::shared_ptr<std::atomic_bool> cancelled) {
+    AudioDecode::Result r;
+    if (!sliceFromCache(audioPath, startMs, r)) r = AudioDecode::decode(audioPath, startMs, kSnippetMs, cancelled.get());
+    if (!r.ok) {
+        // 预览点超出音频长度之类的情况，退回从头播放
+        if (cancelled->load() || startMs == 0) return nullptr;
+        r = AudioDecode::decode(audioPath, 0, kSnippetMs, cancelled.get());
+        if (!r.ok) return nullptr;
+    }
+
+    auto snippet = std::make_shared<PreviewSnippet>();
+    snippet->key = key;
+    snippet->format = r.format;
+    snippet->pcm = std::move(r.pcm);
+    applyFades(snippet->pcm, snippet->format);
+    SnippetCache::instance().put(snippet);
+    return snippet;
+}
+
+PreviewPlayer::PreviewPlayer(QObject *parent) : QObject(parent) {
+    connect(&m_watcher, &QFutureWatcher<PreviewSnippetPtr>::finished, this, &PreviewPlayer::onDecodeFinished);
+}
+
+PreviewPlayer::~PreviewPlayer() {
+    stop();
+}
+
+qint64 PreviewPlayer::cacheBytes() {
+    return SnippetCache::instance().bytes();
+}
+
+int PreviewPlayer::cacheCount() {
+    return SnippetCache::instance().count();
+}
+
+void PreviewPlayer::play(const QString &audioPath, qint64 previewTimeMs) {
+    if (audioPath.isEmpty()) {
+        stop();
+        return;
+    }
+    const qint64 startMs = std::max<qint64>(0, previewTimeMs);
+    const QString key = QString("%1|%2").arg(audioPath).arg(startMs);
+    if (key == m_requestKey) return; // 同一首歌的其他难度：继续放，不重新开始
+
+    if (m_cancel) m_cancel->store(true);
+    m_cancel.reset();
+    m_requestKey = key;
+
+    if (PreviewSnippetPtr snippet = SnippetCache::instance().get(key)) {
+        startPlayback(snippet);
+        return;
+    }
+
+    // 解码期间先停掉上一首，避免两首歌的预览交替出现
+    if (m_sink) m_sink->stop();
+
+    auto cancel = std::make_shared<std::atomic_bool>(false);
+    m_cancel = cancel;
+    m_watcher.setFuture(QtConcurrent::run(decodeSnippet, key, audioPath, startMs, cancel));
+}
+
+void PreviewPlayer::stop() {
+    if (m_cancel) m_cancel->store(true);
+    m_cancel.reset();
+    m_requestKey.clear();
+    if (m_sink) m_sink->stop();
+    m_buffer.close();
+    m_current.reset();
+}
+
+void PreviewPlayer::onDecodeFinished() {
+    PreviewSnippetPtr snippet = m_watcher.result();
+    if (!snippet || snippet->key != m_requestKey) return; // 已经切到别的歌了
+    startPlayback(snippet);
+}
+
+void PreviewPlayer::startPlayback(const PreviewSnippetPtr &snippet) {
+    // 只有格式变化时才重建输出设备，平时一直复用同一个 QAudioSink
+    if (!m_sink || m_sinkFormat != snippet->format) {
+        delete m_sink;
+        m_sinkFormat = snippet->format;
+        m_sink = new QAudioSink(QMediaDevices::defaultAudioOutput(), m_sinkFormat, this);
+        m_sink->setVolume(kPreviewVolume);
+    }
+
+    m_sink->stop();
+    m_buffer.close();
+    m_current = snippet;
+    m_buffer.setData(snippet->pcm); // 隐式共享，不复制 PCM
+    m_buffer.open(QIODevice::ReadOnly);
+    m_sink->start(&m_buffer);
+}
@@ -0,0 +1,54 @@
+#ifndef PREVIEWPLAYER_H
+#define PREVIEWPLAYER_H
+
+#include <QObject>
+#include <QBuffer>
+#include <QAudioFormat>
+#include <QFutureWatcher>
+#include <atomic>
+#include <memory>
+
+class QAudioSink;
+
+// 解码好的一段预览 PCM (只读，在线程间共享)
+struct PreviewSnippet {
+    QString key; // 音频路径 + 起点
+    QAudioFormat format;
+    QByteArray pcm;
+};
+using PreviewSnippetPtr = std::shared_ptr<const PreviewSnippet>;
+
+// 选歌预览：从 PreviewTime 开始解码一小段 PCM (工作线程)，放进按内存上限淘汰的 LRU，
+// 再用同一个 QAudioSink 播放。快速切换时旧的解码任务会被取消，回到听过的歌直接命中缓存。
+class PreviewPlayer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit PreviewPlayer(QObject *parent = nullptr);
+    ~PreviewPlayer();
+
+    // previewTimeMs < 0 时从开头播放
+    void play(const QString &audioPath, qint64 previewTimeMs);
+    void stop();
+
+    // 进程内共享的片段缓存状态 (调试用)
+    static qint64 cacheBytes();
+    static int cacheCount();
+
+private slots:
+    void onDecodeFinished();
+
+private:
+    void startPlayback(const PreviewSnippetPtr &snippet);
+
+    QAudioSink *m_sink = nullptr;
+    QAudioFormat m_sinkFormat;
+    QBuffer m_buffer;
+    PreviewSnippetPtr m_current; // 正在播放的片段 (保证缓冲区数据有效)
+
+    QString m_requestKey; // 最近一次请求，只有它的解码结果会被播放
+    std::shared_ptr<std::atomic_bool> m_cancel;
+    QFutureWatcher<PreviewSnippetPtr> m_watcher;
+};
+
+#endif // PREVIEWPLAYER_H
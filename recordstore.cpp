@@ -0,0 +1,218 @@
+#include "RecordStore.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QDebug>
+#include <algorithm>
+
+static const char *kIndexFileName = "index.json";
+
+RecordStore &RecordStore::instance() {
+    static RecordStore store;
+    return store;
+}
+
+QString RecordStore::recordsDir() {
+    return QCoreApplication::applicationDirPath() + "/records";
+}
+
+QString RecordStore::legacyKey(const QString &legacyHash) {
+    return QString(QCryptographicHash::hash(legacyHash.toUtf8(), QCryptographicHash::Md5).toHex());
+}
+
+QString RecordStore::recordFilePath(const QString &key) {
+    return recordsDir() + "/" + key + ".json";
+}
+
+QStringList RecordStore::recordFiles() {
+    QDir dir(recordsDir());
+    QStringList files;
+    const QStringList names = dir.entryList(QStringList() << "*.json", QDir::Files);
+    for (const QString &name : names) {
+        if (name == kIndexFileName) continue;
+        files.append(dir.filePath(name));
+    }
+    return files;
+}
+
+void RecordStore::countLegacy() {
+    m_legacyCount = 0;
+    for (auto it = m_index.cbegin(); it != m_index.cend(); ++it) {
+        if (isLegacyKey(it.key())) m_legacyCount++;
+    }
+}
+
+void RecordStore::mergeRecord(RecordSummary &s, const QJsonObject &record) {
+    int score = record["score"].toInt();
+    double acc = record["acc"].toDouble();
+    QDateTime date = QDateTime::fromString(record["date"].toString(), Qt::ISODate);
+
+    if (s.playCount == 0 || score > s.bestScore) {
+        s.bestScore = score;
+        s.bestGrade = record["grade"].toString();
+    }
+    if (acc > s.bestAcc) s.bestAcc = acc;
+    if (!s.lastPlayed.isValid() || date > s.lastPlayed) s.lastPlayed = date;
+    s.playCount++;
+}
+
+void RecordStore::load() {
+    QMutexLocker locker(&m_mutex);
+    if (m_loaded) return;
+    m_loaded = true;
+
+    QFile file(recordsDir() + "/" + kIndexFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        // 第一次使用索引：从已有的记录文件重建
+        rebuild();
+        return;
+    }
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+
+    m_index.clear();
+    m_index.reserve(root.size());
+    for (auto it = root.begin(); it != root.end(); ++it) {
+        QJsonObject obj = it.value().toObject();
+        RecordSummary s;
+        s.bestScore = obj["best"].toInt();
+        s.bestGrade = obj["grade"].toString();
+        s.bestAcc = obj["acc"].toDouble();
+        s.playCount = obj["plays"].toInt();
+        s.lastPlayed = QDateTime::fromString(obj["last"].toString(), Qt::ISODate);
+        m_index.insert(it.key(), s);
+    }
+    countLegacy();
+}
+
+void RecordStore::rebuild() {
+    m_index.clear();
+
+    const QStringList files = recordFiles();
+    for (const QString &path : files) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) continue;
+        QJsonArray history = QJsonDocument::fromJson(file.readAll()).array();
+        file.close();
+
+        RecordSummary s;
+        for (const auto &val : history) mergeRecord(s, val.toObject());
+        if (s.playCount > 0) m_index.insert(QFileInfo(path).completeBaseName(), s);
+    }
+
+    countLegacy();
+    qDebug() << "Record index rebuilt:" << m_index.size() << "maps";
+    saveIndex();
+}
+
+bool RecordStore::saveIndex() const {
+    QJsonObject root;
+    for (auto it = m_index.begin(); it != m_index.end(); ++it) {
+        const RecordSummary &s = it.value();
+        QJsonObject obj;
+        obj["best"] = s.bestScore;
+        obj["grade"] = s.bestGrade;
+        obj["acc"] = s.bestAcc;
+        obj["plays"] = s.playCount;
+        obj["last"] = s.lastPlayed.toString(Qt::ISODate);
+        root[it.key()] = obj;
+    }
+
+    QDir dir(recordsDir());
+    if (!dir.exists() && !dir.mkpath(".")) return false;
+
+    // QSaveFile 先写临时文件再替换，避免写到一半崩溃导致索引损坏
+    QSaveFile file(dir.filePath(kIndexFileName));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "ERROR: Could not open record index for writing:" << file.fileName();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+void RecordStore::addRecord(const QString &key, const QJsonObject &record) {
+    QMutexLocker locker(&m_mutex);
+    mergeRecord(m_index[key], record);
+    saveIndex();
+}
+
+bool RecordStore::hasSummary(const QString &key) const {
+    QMutexLocker locker(&m_mutex);
+    return m_index.contains(key);
+}
+
+RecordSummary RecordStore::summary(const QString &key) const {
+    QMutexLocker locker(&m_mutex);
+    return m_index.value(key);
+}
+
+bool RecordStore::hasLegacyRecords() const {
+    QMutexLocker locker(&m_mutex);
+    return m_legacyCount > 0;
+}
+
+bool RecordStore::migrateLegacy(const QString &legacyHash, const QString &key) {
+    QMutexLocker locker(&m_mutex);
+    if (m_legacyCount == 0) return false;
+
+    QString oldKey = legacyKey(legacyHash);
+    auto it = m_index.find(oldKey);
+    if (it == m_index.end()) return false;
+
+    QString oldPath = recordFilePath(oldKey);
+    QString newPath = recordFilePath(key);
+
+    if (!QFile::exists(newPath)) {
+        // 新文件还不存在：直接改名
+        if (!QFile::rename(oldPath, newPath)) {
+            qDebug() << "ERROR: Failed to migrate record file" << oldPath << "->" << newPath;
+            return false;
+        }
+    } else {
+        // 两边都有记录：把旧记录追加到新文件里
+        QJsonArray merged;
+        QFile newFile(newPath);
+        if (newFile.open(QIODevice::ReadOnly)) {
+            merged = QJsonDocument::fromJson(newFile.readAll()).array();
+            newFile.close();
+        }
+        QFile oldFile(oldPath);
+        if (oldFile.open(QIODevice::ReadOnly)) {
+            const QJsonArray old = QJsonDocument::fromJson(oldFile.readAll()).array();
+            oldFile.close();
+            for (const auto &val : old) merged.append(val);
+        }
+
+        QSaveFile out(newPath);
+        if (!out.open(QIODevice::WriteOnly)) return false;
+        out.write(QJsonDocument(merged).toJson());
+        if (!out.commit()) return false;
+        QFile::remove(oldPath);
+    }
+
+    // 合并摘要
+    RecordSummary old = it.value();
+    m_index.erase(it);
+    m_legacyCount--;
+
+    RecordSummary &s = m_index[key];
+    if (s.playCount == 0 || old.bestScore > s.bestScore) {
+        s.bestScore = old.bestScore;
+        s.bestGrade = old.bestGrade;
+    }
+    s.bestAcc = std::max(s.bestAcc, old.bestAcc);
+    if (!s.lastPlayed.isValid() || old.lastPlayed > s.lastPlayed) s.lastPlayed = old.lastPlayed;
+    s.playCount += old.playCount;
+
+    saveIndex();
+    qDebug() << "Migrated legacy record" << oldKey << "->" << key;
+    return true;
+}
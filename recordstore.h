@@ -0,0 +1,55 @@
+#ifndef RECORDSTORE_H
+#define RECORDSTORE_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMutex>
+#include <QJsonObject>
+#include "Structs.h"
+
+// 成绩存储：负责记录文件的路径规则，以及维护一份全局的成绩摘要索引
+// 索引在启动时加载一次，之后每保存一条记录就增量更新并写回
+class RecordStore {
+public:
+    static RecordStore &instance();
+
+    // ./records 目录
+    static QString recordsDir();
+    // 记录文件路径：key 为谱面内容哈希 (BeatmapInfo::getHash())
+    static QString recordFilePath(const QString &key);
+    // 旧版记录文件名：Artist + Title + Version 的 md5
+    static QString legacyKey(const QString &legacyHash);
+    // records 目录下所有记录文件的完整路径 (不含索引文件)
+    static QStringList recordFiles();
+
+    // 启动时调用；索引文件不存在时会从现有记录文件重建一次
+    void load();
+
+    // 新增一条记录后调用，更新对应谱面的摘要并写回索引文件
+    void addRecord(const QString &key, const QJsonObject &record);
+
+    bool hasSummary(const QString &key) const;
+    RecordSummary summary(const QString &key) const;
+
+    // 索引里是否还有旧版 (md5 命名) 的记录，没有的话扫描时可以完全跳过迁移
+    bool hasLegacyRecords() const;
+    // 把旧版记录文件改名/合并到内容哈希命名，返回是否发生了迁移。
+    // 会改写记录文件，只在 RecordWriter 的线程上调用 (见 RecordWriter::enqueueMigrations)
+    bool migrateLegacy(const QString &legacyHash, const QString &key);
+
+private:
+    RecordStore() = default;
+    static void mergeRecord(RecordSummary &s, const QJsonObject &record);
+    static bool isLegacyKey(const QString &key) { return key.size() == 32; }
+    void countLegacy();
+    void rebuild();
+    bool saveIndex() const;
+
+    mutable QMutex m_mutex;
+    QHash<QString, RecordSummary> m_index; // key: 记录文件名 (不含 .json)
+    int m_legacyCount = 0;
+    bool m_loaded = false;
+};
+
+#endif // RECORDSTORE_H
@@ -0,0 +1,142 @@
+#include "RecordWriter.h"
+#include "RecordStore.h"
+#include "Trace.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <algorithm>
+
+RecordWriter &RecordWriter::instance() {
+    static RecordWriter writer;
+    return writer;
+}
+
+RecordWriter::RecordWriter(int capacity)
+    : m_capacity(std::max(1, capacity)) {
+    m_thread = QThread::create([this] { run(); });
+    m_thread->setObjectName("RecordWriter");
+    m_thread->start(QThread::LowPriority);
+
+    // 程序正常退出时先把队列写完，避免丢掉最后一局的成绩
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &RecordWriter::flush);
+    }
+}
+
+RecordWriter::~RecordWriter() {
+    flush();
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_hasWork.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+}
+
+bool RecordWriter::enqueue(const QString &key, const QJsonObject &record) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_queue.size() < m_capacity) {
+            m_queue.enqueue({key, record, {}});
+            m_hasWork.wakeOne();
+            return true;
+        }
+    }
+    // 队列满说明磁盘已经卡住很久了，宁可报告失败也不能让游戏线程等待
+    emit saveFailed(RecordStore::recordsDir(), "Record queue is full, record dropped");
+    return false;
+}
+
+void RecordWriter::enqueueMigrations(const QList<LegacyMigration> &migrations) {
+    if (migrations.isEmpty()) return;
+    QMutexLocker locker(&m_mutex);
+    m_queue.enqueue({QString(), QJsonObject(), migrations});
+    m_hasWork.wakeOne();
+}
+
+void RecordWriter::flush() {
+    QMutexLocker locker(&m_mutex);
+    while (!m_queue.isEmpty() || m_busy) {
+        m_drained.wait(&m_mutex);
+    }
+}
+
+void RecordWriter::run() {
+    forever {
+        Job job;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.isEmpty() && !m_stopping) {
+                m_hasWork.wait(&m_mutex);
+            }
+            if (m_queue.isEmpty()) return; // 正在退出且没有剩余工作
+            job = m_queue.dequeue();
+            m_busy = true;
+        }
+
+        QString filePath;
+        QString error;
+        if (!job.migrations.isEmpty()) {
+            TRACE_SCOPE("record.migrate");
+            RecordStore &store = RecordStore::instance();
+            int migrated = 0;
+            for (const LegacyMigration &m : job.migrations) {
+                if (store.migrateLegacy(m.legacyHash, m.key)) migrated++;
+            }
+            emit legacyMigrated(migrated);
+        } else if (writeRecord(job, filePath, error)) {
+            emit recordSaved(filePath, job.record["score"].toInt());
+        } else {
+            emit saveFailed(filePath, error);
+        }
+
+        QMutexLocker locker(&m_mutex);
+        m_busy = false;
+        if (m_queue.isEmpty()) m_drained.wakeAll();
+    }
+}
+
+bool RecordWriter::writeRecord(const Job &job, QString &filePath, QString &error) {
+    TRACE_SCOPE("record.write");
+    // 1. 确定保存路径: ./records/
+    QString dirPath = RecordStore::recordsDir();
+    QDir dir(dirPath);
+    if (!dir.exists() && !dir.mkpath(".")) {
+        filePath = dirPath;
+        error = "Failed to create records directory";
+        return false;
+    }
+
+    // 每个谱面一个 .json 文件，文件名是谱面内容哈希
+    filePath = RecordStore::recordFilePath(job.key);
+
+    // 2. 读取旧记录 (保留所有历史)
+    QJsonArray history;
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadOnly)) {
+        history = QJsonDocument::fromJson(file.readAll()).array();
+        file.close();
+    }
+    history.append(job.record);
+
+    // 3. 写入：QSaveFile 写完再替换，写到一半失败不会毁掉旧记录
+    QSaveFile out(filePath);
+    if (!out.open(QIODevice::WriteOnly)) {
+        error = out.errorString();
+        return false;
+    }
+    out.write(QJsonDocument(history).toJson());
+    if (!out.commit()) {
+        error = out.errorString();
+        return false;
+    }
+
+    // 4. 增量更新成绩摘要索引，选歌界面不需要再打开记录文件
+    RecordStore::instance().addRecord(job.key, job.record);
+    return true;
+}
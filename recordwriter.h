@@ -0,0 +1,66 @@
+#ifndef RECORDWRITER_H
+#define RECORDWRITER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QList>
+#include <QJsonObject>
+
+// 后台成绩写入器：游戏结束时只把记录放进有界队列，
+// JSON 读写、mkpath 和索引更新都在工作线程完成，GUI 线程不碰磁盘。
+// 进程内共享一个：所有改动记录文件的操作 (新成绩、旧记录迁移) 都排在同一个线程上，不会互相覆盖
+class RecordWriter : public QObject {
+    Q_OBJECT
+
+public:
+    // 一条旧版记录迁移：Artist + Title + Version 的 md5 命名 -> 内容哈希命名
+    struct LegacyMigration {
+        QString legacyHash; // BeatmapInfo::legacyHash()
+        QString key;        // BeatmapInfo::getHash()
+    };
+
+    static RecordWriter &instance();
+    ~RecordWriter(); // 析构时会先 flush
+
+    // 非阻塞：队列已满时直接返回 false 并发出 saveFailed，绝不等待磁盘
+    bool enqueue(const QString &key, const QJsonObject &record);
+
+    // 非阻塞：一次扫描的迁移作为一个任务排队 (不占成绩队列的容量)，完成后发出 legacyMigrated
+    void enqueueMigrations(const QList<LegacyMigration> &migrations);
+
+    // 阻塞直到队列中所有记录写完 (程序退出时调用)
+    void flush();
+
+signals:
+    // 从工作线程发出，连接到 GUI 对象时自动走队列连接
+    void recordSaved(QString filePath, int score);
+    void saveFailed(QString filePath, QString error);
+    // 一批迁移完成，count 为实际迁移的谱面数 (成绩摘要已更新)
+    void legacyMigrated(int count);
+
+private:
+    explicit RecordWriter(int capacity = 16);
+
+    struct Job {
+        QString key; // 谱面内容哈希，同时是记录文件名
+        QJsonObject record;
+        QList<LegacyMigration> migrations; // 非空时是一批旧记录迁移，不是新成绩
+    };
+
+    void run();
+    bool writeRecord(const Job &job, QString &filePath, QString &error);
+
+    QThread *m_thread = nullptr;
+    QMutex m_mutex;
+    QWaitCondition m_hasWork;
+    QWaitCondition m_drained;
+    QQueue<Job> m_queue;
+    int m_capacity;
+    bool m_busy = false;     // 工作线程正在写一条记录
+    bool m_stopping = false;
+};
+
+#endif // RECORDWRITER_H
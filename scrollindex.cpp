@@ -0,0 +1,103 @@
+#include "ScrollIndex.h"
+#include <algorithm>
+#include <map>
+
+void ScrollIndex::clear() {
+    m_times.clear();
+    m_positions.clear();
+    m_velocities.clear();
+    m_baseBeatLength = 500;
+}
+
+void ScrollIndex::build(std::vector<TimingPoint> points, int endTime) {
+    clear();
+    std::stable_sort(points.begin(), points.end(), [](const TimingPoint &a, const TimingPoint &b) {
+        return a.time < b.time;
+    });
+
+    // 1. 基准 BPM：各非继承点持续时间最长的那个 (和 osu! 的"主 BPM"一致)
+    std::map<double, double> durations;
+    const TimingPoint *firstRed = nullptr;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (!points[i].uninherited || points[i].beatLength <= 0) continue;
+        if (!firstRed) firstRed = &points[i];
+        int next = endTime;
+        for (size_t j = i + 1; j < points.size(); ++j) {
+            if (points[j].uninherited && points[j].beatLength > 0) { next = points[j].time; break; }
+        }
+        durations[points[i].beatLength] += std::max(0, next - std::max(points[i].time, 0));
+    }
+    if (!firstRed) return; // 没有 BPM 信息：保持匀速
+    m_baseBeatLength = firstRed->beatLength;
+    double longest = -1;
+    for (const auto &d : durations) {
+        if (d.second > longest) {
+            longest = d.second;
+            m_baseBeatLength = d.first;
+        }
+    }
+
+    // 2. 分段速度 = (基准拍长 / 当前拍长) * SV；同一时间点上继承点覆盖非继承点的 SV
+    double beatLength = firstRed->beatLength;
+    double sv = 1.0;
+    auto pushSegment = [this](double time, double velocity) {
+        if (!m_times.empty() && m_times.back() == time) {
+            m_velocities.back() = velocity; // 同一时刻的多个点只保留最后的状态
+        } else if (m_velocities.empty() || m_velocities.back() != velocity) {
+            m_times.push_back(time);
+            m_velocities.push_back(velocity);
+        }
+    };
+    for (const TimingPoint &p : points) {
+        if (p.uninherited) {
+            if (p.beatLength <= 0) continue;
+            beatLength = p.beatLength;
+            sv = 1.0; // 新的红线重置 SV
+        } else {
+            // osu! 把 SV 限制在 0.01x ~ 10x
+            sv = (p.beatLength < 0) ? std::clamp(-100.0 / p.beatLength, 0.01, 10.0) : 1.0;
+        }
+        pushSegment(p.time, m_baseBeatLength / beatLength * sv);
+    }
+    if (m_times.empty()) return;
+
+    // 3. 前缀和：每段起点的位置。第一段从 0 时刻按第一段速度外推，使 position(0) = 0
+    m_positions.resize(m_times.size());
+    m_positions[0] = m_times[0] * m_velocities[0];
+    for (size_t i = 1; i < m_times.size(); ++i) {
+        m_positions[i] = m_positions[i - 1] + (m_times[i] - m_times[i - 1]) * m_velocities[i - 1];
+    }
+
+    // 全程只有一种速度且就是基准速度：等价于匀速滚动，不需要查表
+    if (m_times.size() == 1 && m_velocities[0] == 1.0) {
+        m_times.clear();
+        m_positions.clear();
+        m_velocities.clear();
+    }
+}
+
+double ScrollIndex::positionAt(double time) const {
+    if (m_times.empty()) return time;
+    // 最后一个起点 <= time 的分段
+    auto it = std::upper_bound(m_times.begin(), m_times.end(), time);
+    const size_t i = (it == m_times.begin()) ? 0 : size_t(it - m_times.begin()) - 1;
+    return m_positions[i] + (time - m_times[i]) * m_velocities[i];
+}
+
+void ScrollIndex::applyTo(std::vector<Note> &notes) const {
+    if (m_times.empty()) {
+        for (Note &note : notes) {
+            note.headPos = note.time;
+            note.tailPos = note.endTime;
+        }
+        return;
+    }
+    // 头部按时间排序：分段游标只前进不后退
+    size_t seg = 0;
+    for (Note &note : notes) {
+        while (seg + 1 < m_times.size() && m_times[seg + 1] <= note.time) ++seg;
+        const double t = note.time;
+        note.headPos = (t < m_times[0]) ? positionAt(t) : m_positions[seg] + (t - m_times[seg]) * m_velocities[seg];
+        note.tailPos = note.isHold ? positionAt(note.endTime) : note.headPos;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef SCROLLINDEX_H
+#define SCROLLINDEX_H
+
+#include <vector>
+#include "Structs.h"
+
+// [TimingPoints] 中的一行
+struct TimingPoint {
+    int time = 0;
+    double beatLength = 500; // 非继承点：每拍毫秒数；继承点：负数，-100 / beatLength = SV 倍率
+    bool uninherited = true;
+};
+
+// 滚动位置索引：把 BPM 变化和 SV (scroll velocity) 预先积分成分段线性的"视觉位置"表。
+// 位置的单位是"基准速度下的毫秒"，没有任何变速时 position(t) == t，与匀速滚动完全一致。
+// 物件的位置在加载时算好 (Note::headPos / tailPos)，每帧只需对当前时间二分查找一次，
+// 绘制时每个物件只剩一次减法和乘法。
+class ScrollIndex {
+public:
+    // points 按时间排序 (乱序也可以，内部会稳定排序)；endTime 用于确定基准 BPM (持续最久的那个)
+    void build(std::vector<TimingPoint> points, int endTime);
+    void clear();
+
+    // 二分查找所在分段 + 一次线性插值；早于第一个分段时按第一段速度外推
+    double positionAt(double time) const;
+    // 按时间顺序填充 notes 的 headPos / tailPos (头部顺序扫描，尾部二分)
+    void applyTo(std::vector<Note> &notes) const;
+
+    bool isConstant() const { return m_times.size() <= 1; }
+    int segmentCount() const { return int(m_times.size()); }
+    double baseBeatLength() const { return m_baseBeatLength; }
+
+private:
+    // 分段 i 覆盖 [m_times[i], m_times[i + 1])，起点位置为 m_positions[i]，速度为 m_velocities[i]
+    std::vector<double> m_times;
+    std::vector<double> m_positions;
+    std::vector<double> m_velocities;
+    double m_baseBeatLength = 500;
+};
+
+#endif // SCROLLINDEX_H
@@ -0,0 +1,164 @@
+#include "SearchIndex.h"
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <algorithm>
+#include <iterator>
+
+// 每处理这么多个候选检查一次是否已取消
+static const int kCancelCheckInterval = 1024;
+
+static bool isCancelled(const std::atomic_bool *cancelled) {
+    return cancelled && cancelled->load(std::memory_order_relaxed);
+}
+
+// 在有序数组中插入 / 删除 (增量更新时保持倒排表有序)
+static void insertSorted(std::vector<int> &list, int id) {
+    auto it = std::lower_bound(list.begin(), list.end(), id);
+    if (it == list.end() || *it != id) list.insert(it, id);
+}
+
+static void eraseSorted(std::vector<int> &list, int id) {
+    auto it = std::lower_bound(list.begin(), list.end(), id);
+    if (it != list.end() && *it == id) list.erase(it);
+}
+
+QString SearchIndex::normalize(const QString &text) {
+    return text.toCaseFolded();
+}
+
+quint64 SearchIndex::trigramKey(const QChar *p) {
+    return (quint64(p[0].unicode()) << 32) | (quint64(p[1].unicode()) << 16) | quint64(p[2].unicode());
+}
+
+void SearchIndex::clear() {
+    QWriteLocker locker(&m_lock);
+    m_postings.clear();
+    m_docs.clear();
+    m_allIds.clear();
+}
+
+int SearchIndex::documentCount() const {
+    QReadLocker locker(&m_lock);
+    return int(m_allIds.size());
+}
+
+void SearchIndex::addDocument(int id, const QStringList &fields) {
+    if (id < 0) return;
+    // 字段之间用换行分隔，查询词里不会出现换行，所以跨字段的三元组不会被误命中
+    QString doc = normalize(fields.join('\n'));
+
+    QWriteLocker locker(&m_lock);
+    if (id >= int(m_docs.size())) m_docs.resize(id + 1);
+
+    const bool appending = m_allIds.empty() || m_allIds.back() < id;
+    if (!m_docs[id].isEmpty()) {
+        // 已存在：先删除旧内容 (锁已持有，直接内联处理)
+        const QString &old = m_docs[id];
+        for (qsizetype i = 0; i + 3 <= old.size(); ++i) {
+            auto it = m_postings.find(trigramKey(old.constData() + i));
+            if (it != m_postings.end()) eraseSorted(it.value(), id);
+        }
+    } else if (appending) {
+        m_allIds.push_back(id);
+    } else {
+        insertSorted(m_allIds, id);
+    }
+
+    // 扫描时 id 递增，倒排表直接追加即可；乱序插入时才走二分
+    for (qsizetype i = 0; i + 3 <= doc.size(); ++i) {
+        std::vector<int> &list = m_postings[trigramKey(doc.constData() + i)];
+        if (list.empty() || list.back() < id) list.push_back(id);
+        else if (list.back() != id) insertSorted(list, id);
+    }
+    m_docs[id] = std::move(doc);
+}
+
+void SearchIndex::removeDocument(int id) {
+    QWriteLocker locker(&m_lock);
+    if (id < 0 || id >= int(m_docs.size()) || m_docs[id].isEmpty()) return;
+
+    const QString &doc = m_docs[id];
+    for (qsizetype i = 0; i + 3 <= doc.size(); ++i) {
+        auto it = m_postings.find(trigramKey(doc.constData() + i));
+        if (it == m_postings.end()) continue;
+        eraseSorted(it.value(), id);
+        if (it.value().empty()) m_postings.erase(it);
+    }
+    m_docs[id].clear();
+    eraseSorted(m_allIds, id);
+}
+
+std::vector<int> SearchIndex::query(const QString &text, const std::atomic_bool *cancelled) const {
+    const QStringList terms = normalize(text).split(' ', Qt::SkipEmptyParts);
+
+    QReadLocker locker(&m_lock);
+    if (terms.isEmpty()) return m_allIds;
+
+    // 长的关键词选择性更好，先算，短词只在已有候选里线性确认
+    QStringList ordered = terms;
+    std::stable_sort(ordered.begin(), ordered.end(), [](const QString &a, const QString &b) {
+        return a.size() > b.size();
+    });
+
+    std::vector<int> result;
+    bool first = true;
+    for (const QString &term : ordered) {
+        result = queryTerm(term, first ? nullptr : &result, cancelled);
+        first = false;
+        if (result.empty() || isCancelled(cancelled)) return {};
+    }
+    return result;
+}
+
+// 调用方已持有读锁
+std::vector<int> SearchIndex::queryTerm(const QString &term, const std::vector<int> *candidates,
+                                        const std::atomic_bool *cancelled) const {
+    std::vector<int> out;
+
+    // 1. 确定候选集合
+    std::vector<int> fromIndex;
+    if (term.size() >= 3) {
+        // 收集该词所有三元组的倒排表，从最短的开始求交集
+        std::vector<const std::vector<int> *> lists;
+        for (qsizetype i = 0; i + 3 <= term.size(); ++i) {
+            auto it = m_postings.constFind(trigramKey(term.constData() + i));
+            if (it == m_postings.cend()) return out; // 有一个三元组不存在就不可能匹配
+            lists.push_back(&it.value());
+        }
+        std::sort(lists.begin(), lists.end(), [](const std::vector<int> *a, const std::vector<int> *b) {
+            return a->size() < b->size();
+        });
+
+        fromIndex = *lists.front();
+        if (candidates) {
+            std::vector<int> tmp;
+            std::set_intersection(fromIndex.begin(), fromIndex.end(),
+                                  candidates->begin(), candidates->end(), std::back_inserter(tmp));
+            fromIndex.swap(tmp);
+        }
+        for (size_t k = 1; k < lists.size() && !fromIndex.empty(); ++k) {
+            std::vector<int> tmp;
+            tmp.reserve(fromIndex.size());
+            std::set_intersection(fromIndex.begin(), fromIndex.end(),
+                                  lists[k]->begin(), lists[k]->end(), std::back_inserter(tmp));
+            fromIndex.swap(tmp);
+            if (isCancelled(cancelled)) return {};
+        }
+        candidates = &fromIndex;
+    } else if (!candidates) {
+        // 1~2 个字符：没有三元组可用，只能对全部文档线性扫描
+        candidates = &m_allIds;
+    }
+
+    // 2. 子串确认 (三元组都命中不代表它们连续出现)
+    out.reserve(candidates->size());
+    int counter = 0;
+    for (int id : *candidates) {
+        if (++counter == kCancelCheckInterval) {
+            counter = 0;
+            if (isCancelled(cancelled)) return {};
+        }
+        if (m_docs[id].contains(term)) out.push_back(id);
+    }
+    return out;
+}
@@ -0,0 +1,40 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <vector>
+
+// 谱面搜索的三元组 (trigram) 倒排索引
+// 每个文档是一个谱面的若干字段 (标题/Unicode 标题/艺术家/难度名/文件夹名)，统一转成小写。
+// 查询：每个关键词拆成三元组，按倒排表从短到长求交集，再对候选做一次子串确认。
+// 读写锁保护：查询在工作线程里跑，扫描/增量更新在 GUI 线程。
+class SearchIndex {
+public:
+    void clear();
+
+    // 增量更新：id 可以是任意非负整数 (通常为 BeatmapLibrary 下标)
+    void addDocument(int id, const QStringList &fields);
+    void removeDocument(int id);
+
+    int documentCount() const;
+
+    // 返回匹配所有关键词的文档 id (升序)。cancelled 被置位时尽快返回空结果。
+    std::vector<int> query(const QString &text, const std::atomic_bool *cancelled = nullptr) const;
+
+private:
+    static QString normalize(const QString &text);
+    static quint64 trigramKey(const QChar *p);
+    std::vector<int> queryTerm(const QString &term, const std::vector<int> *candidates,
+                               const std::atomic_bool *cancelled) const;
+
+    mutable QReadWriteLock m_lock;
+    QHash<quint64, std::vector<int>> m_postings; // 三元组 -> 升序文档 id
+    std::vector<QString> m_docs;                 // id -> 归一化后的文本 (空串表示不存在)
+    std::vector<int> m_allIds;                   // 所有存在的文档 id (升序)
+};
+
+#endif // SEARCHINDEX_H
@@ -1,9 +1,12 @@
 #include "SettingsDialog.h"
 #include "ui_SettingsDialog.h"
 #include <QKeyEvent>
+#include <QPushButton>
+#include <algorithm>
 
-SettingsDialog::SettingsDialog(GameConfig currentConfig, QWidget *parent)
-    : QDialog(parent), ui(new Ui::SettingsDialog), m_config(currentConfig) {
+SettingsDialog::SettingsDialog(GameConfig currentConfig, int keyCount, QWidget *parent)
+    : QDialog(parent), ui(new Ui::SettingsDialog), m_config(currentConfig),
+      m_keyCount(std::clamp(keyCount, 1, kMaxKeyCount)) {
     ui->setupUi(this);
 
     // 绑定数据到 UI
@@ -18,11 +21,12 @@ SettingsDialog::SettingsDialog(GameConfig currentConfig, QWidget *parent)
     ui->spinJ_Good->setValue(m_config.judgeWindow.good);
     ui->spinMissWindow->setValue(m_config.judgeWindow.miss);
 
-    // 连接信号
-    connect(ui->btnKey1, &QPushButton::clicked, this, &SettingsDialog::onKeyButtonClicked);
-    connect(ui->btnKey2, &QPushButton::clicked, this, &SettingsDialog::onKeyButtonClicked);
-    connect(ui->btnKey3, &QPushButton::clicked, this, &SettingsDialog::onKeyButtonClicked);
-    connect(ui->btnKey4, &QPushButton::clicked, this, &SettingsDialog::onKeyButtonClicked);
+    // 键数选择：每种键数单独一套键位，按钮按键数动态生成
+    for (int k = 1; k <= kMaxKeyCount; ++k) ui->comboKeyCount->addItem(QString("%1K").arg(k));
+    ui->comboKeyCount->setCurrentIndex(m_keyCount - 1);
+    connect(ui->comboKeyCount, &QComboBox::currentIndexChanged, this, &SettingsDialog::onKeyCountChanged);
+    rebuildKeyButtons();
+    connect(ui->btnRetryKey, &QPushButton::clicked, this, &SettingsDialog::onKeyButtonClicked);
 
     // === 核心修复方案 A ===
     // 我们直接给 Dialog 本身安装过滤器，这样无论焦点在哪个按钮上，Dialog 都能拦截按键
@@ -30,12 +34,30 @@ SettingsDialog::SettingsDialog(GameConfig currentConfig, QWidget *parent)
 
     connect(ui->buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
     connect(ui->buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
-
-    updateButtonLabels();
 }
 
 SettingsDialog::~SettingsDialog() { delete ui; }
 
+void SettingsDialog::onKeyCountChanged(int index) {
+    m_keyCount = index + 1;
+    rebuildKeyButtons();
+}
+
+void SettingsDialog::rebuildKeyButtons() {
+    m_waitingButton = nullptr;
+    qDeleteAll(m_keyButtons);
+    m_keyButtons.clear();
+
+    for (int i = 0; i < m_keyCount; ++i) {
+        QPushButton *btn = new QPushButton(ui->groupBox);
+        btn->setMinimumWidth(36);
+        connect(btn, &QPushButton::clicked, this, &SettingsDialog::onKeyButtonClicked);
+        ui->horizontalLayout->addWidget(btn);
+        m_keyButtons.append(btn);
+    }
+    updateButtonLabels();
+}
+
 void SettingsDialog::onKeyButtonClicked() {
     QPushButton *btn = qobject_cast<QPushButton*>(sender());
     if (btn) {
@@ -62,16 +84,20 @@ bool SettingsDialog::eventFilter(QObject *watched, QEvent *event) {
         QKeyEvent *ke = static_cast<QKeyEvent*>(event);
         int key = ke->key();
 
+        // 重开键
+        if (m_waitingButton == ui->btnRetryKey) {
+            m_config.retryKey = key;
+            m_waitingButton = nullptr;
+            updateButtonLabels();
+            return true;
+        }
+
         // 找到对应的索引
-        int idx = -1;
-        if (m_waitingButton == ui->btnKey1) idx = 0;
-        else if (m_waitingButton == ui->btnKey2) idx = 1;
-        else if (m_waitingButton == ui->btnKey3) idx = 2;
-        else if (m_waitingButton == ui->btnKey4) idx = 3;
+        int idx = m_keyButtons.indexOf(m_waitingButton);
 
         if (idx != -1) {
-            // 保存键值
-            m_config.keyMapping[idx] = key;
+            // 保存键值 (只改当前键数那一套)
+            m_config.keysFor(m_keyCount)[idx] = key;
 
             // 状态复位
             m_waitingButton = nullptr;
@@ -85,10 +111,11 @@ bool SettingsDialog::eventFilter(QObject *watched, QEvent *event) {
 
 void SettingsDialog::updateButtonLabels() {
     // 将 int 键值转换为可读的字符串 (例如 68 -> "D")
-    ui->btnKey1->setText(QKeySequence((Qt::Key)m_config.keyMapping[0]).toString());
-    ui->btnKey2->setText(QKeySequence((Qt::Key)m_config.keyMapping[1]).toString());
-    ui->btnKey3->setText(QKeySequence((Qt::Key)m_config.keyMapping[2]).toString());
-    ui->btnKey4->setText(QKeySequence((Qt::Key)m_config.keyMapping[3]).toString());
+    ui->btnRetryKey->setText(QKeySequence((Qt::Key)m_config.retryKey).toString());
+    const KeyLayout &keys = m_config.keysFor(m_keyCount);
+    for (int i = 0; i < m_keyButtons.size(); ++i) {
+        m_keyButtons[i]->setText(QKeySequence((Qt::Key)keys[i]).toString());
+    }
 }
 
 GameConfig SettingsDialog::getConfig() const {
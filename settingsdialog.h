@@ -2,24 +2,32 @@
 #define SETTINGSDIALOG_H
 
 #include <QDialog>
+#include <QList>
 #include "Structs.h"
 
+class QPushButton;
+
 namespace Ui { class SettingsDialog; }
 
 class SettingsDialog : public QDialog {
     Q_OBJECT
 public:
-    explicit SettingsDialog(GameConfig currentConfig, QWidget *parent = nullptr);
+    // keyCount：默认打开哪种键数的键位 (一般是当前谱面的键数)
+    explicit SettingsDialog(GameConfig currentConfig, int keyCount = 4, QWidget *parent = nullptr);
     ~SettingsDialog();
     GameConfig getConfig() const;
 
 private slots:
     void onKeyButtonClicked();
+    void onKeyCountChanged(int index);
 
 private:
     Ui::SettingsDialog *ui;
     GameConfig m_config;
     void updateButtonLabels();
+    void rebuildKeyButtons(); // 按当前键数重新生成按钮
+    int m_keyCount = 4;
+    QList<QPushButton*> m_keyButtons;
     bool eventFilter(QObject *watched, QEvent *event) override;
     QPushButton* m_waitingButton = nullptr; // 正在等待输入的按钮
 };
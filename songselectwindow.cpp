@@ -1,15 +1,21 @@
 #include "SongSelectWindow.h"
 #include "ui_SongSelectWindow.h"
 #include <QFileDialog>
-#include <QDirIterator>
+#include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QCryptographicHash>
-#include <QCoreApplication>
 #include <QMessageBox>
 #include <QDateTime>
 #include <algorithm>
+#include "RecordStore.h"
+#include "RecordWriter.h"
+#include "BeatmapLibrary.h"
+#include "LibraryModels.h"
+#include "HitErrorWidget.h"
+#include "ChartPrefetcher.h"
+#include "PreviewPlayer.h"
+#include <QtConcurrent/QtConcurrent>
 
 SongSelectWindow::SongSelectWindow(GameConfig &config, QWidget *parent)
     : QDialog(parent), ui(new Ui::SongSelectWindow), m_config(config) {
@@ -26,15 +32,52 @@ SongSelectWindow::SongSelectWindow(GameConfig &config, QWidget *parent)
     ui->tableHistory->setColumnWidth(2, 60); // Acc
     ui->tableHistory->setColumnWidth(8, 110); // Date
 
+    // 打击误差分布图放在表格下面
+    m_hitErrorView = new HitErrorWidget(this);
+    ui->verticalLayout_3->insertWidget(ui->verticalLayout_3->indexOf(ui->tableHistory) + 1, m_hitErrorView);
+
+    m_preview = new PreviewPlayer(this);
+
+    // 模型/视图：列表只为可见行生成显示内容
+    m_folderModel = new FolderListModel(this);
+    m_songModel = new SongListModel(this);
+    ui->listFolders->setModel(m_folderModel);
+    ui->listSongs->setModel(m_songModel);
+    ui->listFolders->setUniformItemSizes(true);
+    ui->listSongs->setUniformItemSizes(true);
+
     // 连接信号
     connect(ui->btnScan, &QPushButton::clicked, this, &SongSelectWindow::onScanClicked);
-    connect(ui->listFolders, &QListWidget::itemClicked, this, &SongSelectWindow::onFolderClicked);
-    connect(ui->listSongs, &QListWidget::itemClicked, this, &SongSelectWindow::onSongClicked);
+    connect(ui->listFolders, &QListView::clicked, this, &SongSelectWindow::onFolderClicked);
+    connect(ui->listSongs, &QListView::clicked, this, &SongSelectWindow::onSongClicked);
     connect(ui->btnPlay, &QPushButton::clicked, this, &SongSelectWindow::onPlayClicked);
+    connect(ui->comboSort, &QComboBox::currentIndexChanged, this, &SongSelectWindow::onSortChanged);
+    connect(ui->tableHistory, &QTableWidget::itemSelectionChanged, this, &SongSelectWindow::onHistorySelectionChanged);
+    connect(ui->btnErrorsMap, &QPushButton::clicked, this, &SongSelectWindow::onMapErrorsClicked);
+    connect(ui->btnErrorsAll, &QPushButton::clicked, this, &SongSelectWindow::onAllErrorsClicked);
+    connect(ui->editSearch, &QLineEdit::textChanged, this, &SongSelectWindow::onSearchTextChanged);
+    connect(&m_searchWatcher, &QFutureWatcher<std::vector<int>>::finished, this, &SongSelectWindow::onSearchFinished);
+    connect(&m_errorWatcher, &QFutureWatcher<HitErrorStats>::finished, this, [this]() {
+        m_hitErrorView->setStats(m_errorWatcher.result(), m_errorCaption);
+    });
+    // 扫描时排队的旧记录迁移在写入线程上完成后，刷新成绩徽章 (保持当前文件夹)
+    connect(&RecordWriter::instance(), &RecordWriter::legacyMigrated, this, [this](int count) {
+        if (count == 0) return;
+        BeatmapLibrary::instance().refreshSummaries();
+        const int currentFolder = m_songModel->folder();
+        m_folderModel->reload();
+        m_songModel->setFolder(currentFolder);
+        const int row = m_folderModel->rowOfFolder(currentFolder);
+        if (row >= 0) ui->listFolders->setCurrentIndex(m_folderModel->index(row));
+    });
 
-    // 自动扫描
-    if (!m_config.songFolder.isEmpty()) {
+    // 自动扫描：谱面库在进程内共享，目录没变时直接复用上次的结果
+    BeatmapLibrary &lib = BeatmapLibrary::instance();
+    if (!m_config.songFolder.isEmpty() && lib.rootFolder() != m_config.songFolder) {
         scanSongs(m_config.songFolder);
+    } else {
+        lib.refreshSummaries(); // 上次打开后可能又玩过，刷新成绩徽章
+        reloadModels();
     }
 }
 
@@ -42,6 +85,18 @@ SongSelectWindow::~SongSelectWindow() {
     delete ui;
 }
 
+void SongSelectWindow::onSortChanged(int index) {
+    LibrarySort sort = static_cast<LibrarySort>(index);
+    int currentFolder = m_songModel->folder();
+    m_folderModel->setSort(sort);
+    m_songModel->setSort(sort);
+    m_selectedId = -1;
+
+    // 保持当前文件夹的选中状态
+    int row = m_folderModel->rowOfFolder(currentFolder);
+    if (row >= 0) ui->listFolders->setCurrentIndex(m_folderModel->index(row));
+}
+
 void SongSelectWindow::onScanClicked() {
     QString dir = QFileDialog::getExistingDirectory(this, "Select Song Folder", m_config.songFolder);
     if (!dir.isEmpty()) {
@@ -51,111 +106,122 @@ void SongSelectWindow::onScanClicked() {
 }
 
 void SongSelectWindow::scanSongs(const QString &folder) {
-    ui->listFolders->clear();
-    ui->listSongs->clear();
     ui->tableHistory->setRowCount(0);
-    m_folderMap.clear();
-    m_selectedMap = nullptr;
-
-    QDirIterator it(folder, QStringList() << "*.osu", QDir::Files, QDirIterator::Subdirectories);
-
-    while (it.hasNext()) {
-        QString path = it.next();
-        QFileInfo fileInfo(path);
-
-        // 解析 .osu 文件
-        QFile f(path);
-        if (f.open(QIODevice::ReadOnly)) {
-            QTextStream in(&f);
-            BeatmapInfo info;
-            info.filePath = path;
-
-            int lines = 0;
-            while (!in.atEnd() && lines < 50) {
-                QString line = in.readLine().trimmed();
-                if (line.startsWith("Title:")) info.title = line.mid(6).trimmed();
-                else if (line.startsWith("TitleUnicode:")) info.title = line.mid(13).trimmed();
-                else if (line.startsWith("Artist:")) info.artist = line.mid(7).trimmed();
-                else if (line.startsWith("ArtistUnicode:")) info.artist = line.mid(14).trimmed();
-                else if (line.startsWith("Version:")) info.version = line.mid(8).trimmed();
-                lines++;
-            }
-            f.close();
-
-            if (!info.title.isEmpty()) {
-                // 使用父文件夹名称作为分组 Key
-                QString folderName = fileInfo.dir().dirName();
-                m_folderMap[folderName].append(info);
-            }
-        }
-    }
+    m_selectedId = -1;
 
-    // 填充左侧文件夹列表 (Map 自动按 Key 排序)
-    for (auto it = m_folderMap.begin(); it != m_folderMap.end(); ++it) {
-        // 对文件夹内的歌曲按难度/标题排序
-        QList<BeatmapInfo> &maps = it.value();
-        std::sort(maps.begin(), maps.end(), [](const BeatmapInfo& a, const BeatmapInfo& b) {
-            return a.version < b.version;
-        });
+    // 还在跑的查询持有索引的读锁，扫描要更新索引：先让它尽快返回并等它结束
+    if (m_searchCancel) m_searchCancel->store(true);
+    m_searchCancel.reset();
+    m_searchWatcher.cancel();
+    m_searchWatcher.waitForFinished();
 
-        ui->listFolders->addItem(it.key());
-    }
+    BeatmapLibrary::instance().scan(folder);
+    reloadModels();
+}
 
-    if (m_folderMap.isEmpty()) {
-        ui->listFolders->addItem("No songs found.");
+void SongSelectWindow::reloadModels() {
+    m_songModel->setFolder(-1);
+    m_folderModel->setFilter(nullptr);
+    m_songModel->setFilter(nullptr);
+
+    const BeatmapLibrary &lib = BeatmapLibrary::instance();
+    ui->groupFolders->setTitle(QString("1. Folders (%1)").arg(lib.folderCount()));
+    ui->groupFolders->setToolTip(lib.memoryText());
+
+    // 重新扫描后旧的搜索结果已失效，按当前输入重新查询
+    if (!ui->editSearch->text().trimmed().isEmpty()) onSearchTextChanged(ui->editSearch->text());
+}
+
+// 每次输入都在线程池上发起一次新查询，并取消仍在运行的旧查询
+void SongSelectWindow::onSearchTextChanged(const QString &text) {
+    if (m_searchCancel) m_searchCancel->store(true);
+    m_searchCancel.reset();
+
+    const BeatmapLibrary &lib = BeatmapLibrary::instance();
+    QString query = text.trimmed();
+    if (query.isEmpty()) {
+        m_searchWatcher.cancel(); // 只是让旧结果不再被接收
+        m_folderModel->setFilter(nullptr);
+        m_songModel->setFilter(nullptr);
+        ui->groupFolders->setTitle(QString("1. Folders (%1)").arg(lib.folderCount()));
+        return;
     }
+
+    auto cancel = std::make_shared<std::atomic_bool>(false);
+    m_searchCancel = cancel;
+    m_searchGeneration = lib.generation();
+
+    const SearchIndex *index = &lib.searchIndex();
+    m_searchWatcher.setFuture(QtConcurrent::run([index, query, cancel]() {
+        return index->query(query, cancel.get());
+    }));
 }
 
-// 点击文件夹 -> 填充中间的歌曲列表
-void SongSelectWindow::onFolderClicked(QListWidgetItem *item) {
-    ui->listSongs->clear();
-    ui->tableHistory->setRowCount(0);
-    m_selectedMap = nullptr;
-    ui->lblBestScore->setText("Best: -");
+void SongSelectWindow::onSearchFinished() {
+    if (m_searchWatcher.isCanceled() || !m_searchCancel || m_searchCancel->load()) return;
 
-    QString folderName = item->text();
-    if (m_folderMap.contains(folderName)) {
-        const QList<BeatmapInfo> &maps = m_folderMap[folderName];
+    const BeatmapLibrary &lib = BeatmapLibrary::instance();
+    if (m_searchGeneration != lib.generation()) return; // 查询期间谱面库被重新扫描过
 
-        // 遍历该文件夹下的所有谱面
-        for (int i = 0; i < maps.size(); ++i) {
-            const BeatmapInfo &info = maps[i];
-            QString label = QString("[%1] %2").arg(info.version, info.title);
+    const std::vector<int> ids = m_searchWatcher.result();
 
-            QListWidgetItem *songItem = new QListWidgetItem(label);
-            // 存储该歌曲在 m_folderMap[folderName] 列表中的索引
-            songItem->setData(Qt::UserRole, i);
-            ui->listSongs->addItem(songItem);
-        }
+    auto filter = std::make_shared<LibraryFilter>();
+    filter->mapMatch.assign(lib.beatmapCount(), 0);
+    filter->folderMatch.assign(lib.folderCount(), 0);
+    for (int doc : ids) {
+        const int id = lib.mapOfDocument(doc);
+        if (id < 0) continue;
+        filter->mapMatch[id] = 1;
+        filter->folderMatch[lib.folderOf(id)] = 1;
+        filter->matchCount++;
     }
+
+    int currentFolder = m_songModel->folder();
+    m_folderModel->setFilter(filter);
+    m_songModel->setFilter(filter);
+    ui->groupFolders->setTitle(QString("1. Folders (%1 maps found)").arg(filter->matchCount));
+
+    int row = m_folderModel->rowOfFolder(currentFolder);
+    if (row >= 0) ui->listFolders->setCurrentIndex(m_folderModel->index(row));
+}
+
+// 点击文件夹 -> 中间的歌曲列表切换到该文件夹的下标范围
+void SongSelectWindow::onFolderClicked(const QModelIndex &index) {
+    ui->tableHistory->setRowCount(0);
+    m_selectedId = -1;
+    ui->lblBestScore->setText("Best: -");
+    ChartPrefetcher::instance().cancel();
+
+    m_songModel->setFolder(index.data(FolderListModel::FolderIndexRole).toInt());
 }
 
 // 点击歌曲 -> 填充右侧评分表
-void SongSelectWindow::onSongClicked(QListWidgetItem *item) {
-    // 找到当前选中的文件夹
-    if (!ui->listFolders->currentItem()) return;
-    QString folderName = ui->listFolders->currentItem()->text();
-
-    // 获取歌曲索引
-    int idx = item->data(Qt::UserRole).toInt();
-
-    if (m_folderMap.contains(folderName) && idx < m_folderMap[folderName].size()) {
-        // 获取实际数据的指针
-        // 注意：这里取地址，因为 m_selectedMap 是指针
-        m_selectedMap = &m_folderMap[folderName][idx];
-        loadHistory(m_selectedMap->getHash());
-    }
+void SongSelectWindow::onSongClicked(const QModelIndex &index) {
+    int id = index.data(SongListModel::BeatmapIdRole).toInt();
+    if (id < 0 || id >= BeatmapLibrary::instance().beatmapCount()) return;
+
+    m_selectedId = id;
+    const BeatmapInfo info = BeatmapLibrary::instance().beatmap(id);
+    // 趁玩家看成绩的时候在后台解析谱面、预热音频 (会取消上一个选中项的预读)
+    ChartPrefetcher::instance().prefetch(info.filePath);
+
+    // 预览从 PreviewTime 开始；谱面没写的话取谱面长度的 40% 处
+    qint64 previewTime = info.previewTime >= 0 ? info.previewTime : qint64(info.metrics.durationMs) * 2 / 5;
+    m_preview->play(ChartPrefetcher::resolveAudioPath(info.filePath, info.audioFilename), previewTime);
+
+    loadHistory(info.getHash());
 }
 
 void SongSelectWindow::loadHistory(const QString &hash) {
     ui->tableHistory->setRowCount(0);
     ui->lblBestScore->setText("Best: 0");
+    m_records.clear();
+    m_hitErrorView->setMessage("Select a play to see its hit errors");
 
-    QString dirPath = QCoreApplication::applicationDirPath() + "/records";
-    QString safeName = QString(QCryptographicHash::hash(hash.toUtf8(), QCryptographicHash::Md5).toHex());
-    QString filePath = dirPath + "/" + safeName + ".json";
+    // 索引里没有的谱面肯定没有记录文件，直接跳过磁盘读取
+    if (!RecordStore::instance().hasSummary(hash)) return;
 
-    QFile file(filePath);
+    QFile file(RecordStore::recordFilePath(hash));
     if (!file.open(QIODevice::ReadOnly)) return;
 
     QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
@@ -181,6 +247,8 @@ void SongSelectWindow::loadHistory(const QString &hash) {
         ui->lblBestScore->setText(QString("Best: %1").arg(best));
     }
 
+    m_records = records;
+
     // 填充表格
     for (const auto &r : records) {
         int row = ui->tableHistory->rowCount();
@@ -215,8 +283,40 @@ void SongSelectWindow::loadHistory(const QString &hash) {
     }
 }
 
+// 选中表格中的一局 -> 显示该局的误差分布
+void SongSelectWindow::onHistorySelectionChanged() {
+    int row = ui->tableHistory->currentRow();
+    if (row < 0 || row >= m_records.size()) return;
+
+    const RecordData &r = m_records[row];
+    m_hitErrorView->setStats(HitErrors::statsOfRecord(r.json), r.date.toString("MM-dd hh:mm"));
+}
+
+void SongSelectWindow::onMapErrorsClicked() {
+    if (m_selectedId < 0) {
+        QMessageBox::warning(this, "Info", "Please select a song first.");
+        return;
+    }
+    const BeatmapLibrary &lib = BeatmapLibrary::instance();
+    startErrorAggregation(QStringList() << RecordStore::recordFilePath(lib.recordKey(m_selectedId)),
+                          QString("[%1] all plays").arg(lib.version(m_selectedId)));
+}
+
+void SongSelectWindow::onAllErrorsClicked() {
+    startErrorAggregation(RecordStore::recordFiles(), "All maps");
+}
+
+// 汇总在线程池上进行，完成后由 m_errorWatcher 回到 GUI 线程显示
+// 连续点击时新的 future 会替换旧的，旧结果直接丢弃
+void SongSelectWindow::startErrorAggregation(const QStringList &files, const QString &caption) {
+    m_errorCaption = caption;
+    m_hitErrorView->setMessage(QString("Computing %1 (%2 files)...").arg(caption).arg(files.size()));
+    m_errorWatcher.setFuture(QtConcurrent::run(HitErrors::aggregateRecordFiles, files));
+}
+
 void SongSelectWindow::onPlayClicked() {
-    if (m_selectedMap) {
+    if (m_selectedId >= 0) {
+        m_preview->stop();
         accept(); // 返回 Accepted，主窗口会读取 getSelectedBeatmapPath
     } else {
         QMessageBox::warning(this, "Info", "Please select a song first.");
@@ -224,6 +324,11 @@ void SongSelectWindow::onPlayClicked() {
 }
 
 QString SongSelectWindow::getSelectedBeatmapPath() const {
-    if (m_selectedMap) return m_selectedMap->filePath;
+    if (m_selectedId >= 0) return BeatmapLibrary::instance().filePath(m_selectedId);
     return "";
 }
+
+BeatmapInfo SongSelectWindow::getSelectedBeatmap() const {
+    if (m_selectedId >= 0) return BeatmapLibrary::instance().beatmap(m_selectedId);
+    return BeatmapInfo();
+}
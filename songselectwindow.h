@@ -2,11 +2,20 @@
 #define SONGSELECTWINDOW_H
 
 #include <QDialog>
-#include <QMap>
 #include <QList>
-#include <QListWidgetItem>
+#include <QModelIndex>
 #include <QJsonObject>
+#include <QFutureWatcher>
 #include "Structs.h"
+#include "HitErrors.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class HitErrorWidget;
+class PreviewPlayer;
+class FolderListModel;
+class SongListModel;
 
 namespace Ui {
 class SongSelectWindow;
@@ -20,16 +29,25 @@ public:
     ~SongSelectWindow();
 
     QString getSelectedBeatmapPath() const;
+    BeatmapInfo getSelectedBeatmap() const;
 
 private slots:
     void onScanClicked();
-    void onFolderClicked(QListWidgetItem *item);
-    void onSongClicked(QListWidgetItem *item);
+    void onFolderClicked(const QModelIndex &index);
+    void onSongClicked(const QModelIndex &index);
     void onPlayClicked();
+    void onSortChanged(int index);
+    void onHistorySelectionChanged();
+    void onMapErrorsClicked();
+    void onAllErrorsClicked();
+    void onSearchTextChanged(const QString &text);
+    void onSearchFinished();
 
 private:
     void scanSongs(const QString &folder);
+    void reloadModels();
     void loadHistory(const QString &hash);
+    void startErrorAggregation(const QStringList &files, const QString &caption);
 
     // 辅助结构：用于表格排序
     struct RecordData {
@@ -40,11 +58,26 @@ private:
     Ui::SongSelectWindow *ui;
     GameConfig &m_config;
 
-    // 数据结构：文件夹名 -> 该文件夹下的歌曲列表
-    QMap<QString, QList<BeatmapInfo>> m_folderMap;
+    // 列表模型 (数据在 BeatmapLibrary 的扁平表里)
+    FolderListModel *m_folderModel;
+    SongListModel *m_songModel;
+
+    // 当前选中的谱面在 BeatmapLibrary 中的下标
+    int m_selectedId = -1;
+
+    // 异步搜索：每次输入都取消上一次查询，只接受最新一次的结果
+    QFutureWatcher<std::vector<int>> m_searchWatcher;
+    std::shared_ptr<std::atomic_bool> m_searchCancel;
+    int m_searchGeneration = 0; // 发起查询时的谱面库版本
+
+    // 当前表格中的记录 (与表格行一一对应)
+    QList<RecordData> m_records;
 
-    // 当前选中的谱面指针
-    const BeatmapInfo *m_selectedMap = nullptr;
+    // 打击误差分布
+    HitErrorWidget *m_hitErrorView;
+    PreviewPlayer *m_preview; // 选中歌曲时播放预览
+    QFutureWatcher<HitErrorStats> m_errorWatcher;
+    QString m_errorCaption;
 };
 
 #endif // SONGSELECTWINDOW_H
@@ -0,0 +1,106 @@
+// 压力谱面生成器：写出合法的 .osu 和对应的无声音频，放进歌曲目录即可被扫描和游玩。
+//
+//   osu_stress_gen <输出目录> [--keys 7] [--bpm 240] [--snap 4] [--length 120000] [--notes N]
+//                  [--holds 0.2] [--chords 0.2] [--chord-size 2] [--pattern random|chords|jacks|holds]
+//                  [--seed N] [--title Stress]
+//
+// 每次调用生成一个谱面文件夹 <输出目录>/<title>/，同一个 title 多次调用会作为多个难度放在一起。
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include "ChartGenerator.h"
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("osu_stress_gen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generate synthetic stress-test charts with silent audio.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("out", "Output song folder.");
+    QCommandLineOption keysOption("keys", "Key count 1-10 (default 4).", "k", "4");
+    QCommandLineOption bpmOption("bpm", "BPM (default 180).", "bpm", "180");
+    QCommandLineOption snapOption("snap", "Rows per beat (default 4).", "n", "4");
+    QCommandLineOption lengthOption("length", "Chart length in ms (default 120000).", "ms", "120000");
+    QCommandLineOption notesOption("notes", "Stop after this many notes (overrides --length).", "n");
+    QCommandLineOption holdsOption("holds", "Hold note ratio 0-1 (default 0.2).", "ratio", "0.2");
+    QCommandLineOption chordsOption("chords", "Chord row ratio 0-1 for the random pattern (default 0.2).", "ratio", "0.2");
+    QCommandLineOption chordSizeOption("chord-size", "Notes per chord row / jack width (default 2).", "n", "2");
+    QCommandLineOption patternOption("pattern", "random, chords, jacks or holds (default random).", "name", "random");
+    QCommandLineOption seedOption("seed", "Random seed (default 12345).", "n", "12345");
+    QCommandLineOption titleOption("title", "Song title / folder name (default Stress).", "text", "Stress");
+    parser.addOptions({keysOption, bpmOption, snapOption, lengthOption, notesOption, holdsOption,
+                       chordsOption, chordSizeOption, patternOption, seedOption, titleOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1) {
+        err << "usage: osu_stress_gen <out> [options]  (see --help)\n";
+        return 1;
+    }
+
+    ChartGenerator::Params params;
+    params.keyCount = parser.value(keysOption).toInt();
+    params.bpm = parser.value(bpmOption).toDouble();
+    params.snap = parser.value(snapOption).toInt();
+    params.lengthMs = parser.value(lengthOption).toInt();
+    if (parser.isSet(notesOption)) params.maxNotes = parser.value(notesOption).toLongLong();
+    params.holdRatio = parser.value(holdsOption).toDouble();
+    params.chordRatio = parser.value(chordsOption).toDouble();
+    params.chordSize = parser.value(chordSizeOption).toInt();
+    params.seed = parser.value(seedOption).toUInt();
+    params.title = parser.value(titleOption);
+    if (!ChartGenerator::parsePattern(parser.value(patternOption), params.pattern)) {
+        err << "unknown pattern: " << parser.value(patternOption) << "\n";
+        return 1;
+    }
+    if (params.keyCount < 1 || params.keyCount > 10 || params.bpm <= 0 || params.snap <= 0) {
+        err << "invalid --keys / --bpm / --snap\n";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const ChartGenerator::Result chart = ChartGenerator::generate(params);
+    const qint64 generateMs = timer.elapsed();
+
+    // 文件名带上参数，同一文件夹下的多个难度不会互相覆盖
+    const QDir dir(QDir(args.first()).filePath(params.title));
+    QDir().mkpath(dir.path());
+    const QString osuName = QString("ChartGenerator - %1 [%2K %3 %4 seed%5].osu")
+        .arg(params.title).arg(params.keyCount)
+        .arg(ChartGenerator::patternName(params.pattern)).arg(chart.noteCount).arg(params.seed);
+    const QString osuPath = dir.filePath(osuName);
+
+    timer.start();
+    QSaveFile file(osuPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(chart.osu) != chart.osu.size() || !file.commit()) {
+        err << "failed to write " << osuPath << "\n";
+        return 1;
+    }
+    // 音频比最后一个物件多 3 秒；已存在且够长就不重写 (多个难度共用)
+    const QString audioPath = dir.filePath(params.audioFilename);
+    const int audioMs = chart.endTime + 3000;
+    const qint64 wantedSize = 44 + qint64(audioMs) * 8;
+    if (QFileInfo(audioPath).size() < wantedSize && !ChartGenerator::writeSilentWav(audioPath, audioMs)) {
+        err << "failed to write " << audioPath << "\n";
+        return 1;
+    }
+    const qint64 writeMs = timer.elapsed();
+
+    out << osuPath << "\n"
+        << "notes:    " << chart.noteCount << " (" << chart.holdCount << " holds)\n"
+        << "length:   " << chart.endTime << " ms\n"
+        << "size:     " << QString::number(chart.osu.size() / (1024.0 * 1024.0), 'f', 2) << " MB\n"
+        << "generate: " << generateMs << " ms\n"
+        << "write:    " << writeMs << " ms\n";
+    return 0;
+}
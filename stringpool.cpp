@@ -0,0 +1,42 @@
+#include "StringPool.h"
+
+StringPool::StringPool() {
+    clear();
+}
+
+StringPool::Id StringPool::intern(const QString &text) {
+    if (text.isEmpty()) return 0;
+    if (m_lookup.isEmpty() && m_strings.size() > 1) {
+        for (size_t i = 1; i < m_strings.size(); ++i) m_lookup.insert(m_strings[i], Id(i));
+    }
+    auto it = m_lookup.constFind(text);
+    if (it != m_lookup.constEnd()) return it.value();
+
+    const Id id = Id(m_strings.size());
+    QString stored = text;
+    stored.squeeze(); // 解析时截出来的子串可能带着多余容量
+    m_strings.push_back(stored);
+    m_lookup.insert(stored, id);
+    return id;
+}
+
+void StringPool::clear() {
+    m_strings.clear();
+    m_lookup.clear();
+    m_strings.push_back(QString());
+}
+
+void StringPool::squeeze() {
+    m_lookup = QHash<QString, Id>();
+    m_strings.shrink_to_fit();
+}
+
+qint64 StringPool::memoryBytes() const {
+    qint64 bytes = qint64(m_strings.capacity()) * qint64(sizeof(QString));
+    for (const QString &s : m_strings) {
+        if (!s.isEmpty()) bytes += kArrayHeaderBytes + qint64(s.capacity()) * qint64(sizeof(QChar));
+    }
+    // 哈希表的键与数组共享字符数据，只计节点本身
+    bytes += qint64(m_lookup.size()) * qint64(sizeof(QString) + sizeof(Id) + sizeof(void *));
+    return bytes;
+}
@@ -0,0 +1,34 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QHash>
+#include <QString>
+#include <vector>
+
+// 字符串驻留池：相同内容只存一份，外部用 32 位下标引用 (下标 0 固定为空串)。
+// 构建期间用哈希表去重；建完后调用 squeeze() 释放哈希表，只留下标 -> 字符串的数组，
+// 按下标取字符串是 O(1)。squeeze() 之后再 intern 会先重建哈希表。
+class StringPool {
+public:
+    using Id = quint32;
+    // QArrayData 头部的大致开销 (引用计数、标志、容量)：所有 Qt 容器的内存估算共用
+    static constexpr qint64 kArrayHeaderBytes = 24;
+
+    StringPool();
+
+    Id intern(const QString &text);
+    const QString &at(Id id) const { return m_strings[id]; }
+    int size() const { return int(m_strings.size()); }
+
+    void clear();
+    void squeeze();
+
+    // 估算占用的内存 (字符串数据 + 下标数组 + 未释放的哈希表)
+    qint64 memoryBytes() const;
+
+private:
+    std::vector<QString> m_strings;
+    QHash<QString, Id> m_lookup;
+};
+
+#endif // STRINGPOOL_H
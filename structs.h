@@ -4,16 +4,24 @@
 #include <Qt>
 #include <QString>
 #include <QDateTime>
+#include <QList>
+#include <algorithm>
+#include <array>
+
+// 支持的最大键数 (1K ~ 10K)
+constexpr int kMaxKeyCount = 10;
 
 // 单个音符结构
 struct Note {
-    int column;      // 轨道 0-3
+    int column;      // 轨道 0 ~ 键数-1
     int time;        // 开始时间 (ms)
     int endTime;     // 结束时间 (如果是普通 Note，这里等于 time)
     bool isHold;     // 是否是长条
     bool isHit;      // 是否被打击
     bool isHolding;  // 是否正在按住中 (且头部已击中)
     bool isMissed;   // 是否已错过
+    double headPos = 0; // 头部 / 尾部的滚动位置 (ScrollIndex 预计算，匀速时等于时间)
+    double tailPos = 0;
 };
 
 // ... (JudgmentWindow 和 GameConfig 保持不变) ...
@@ -42,6 +50,57 @@ struct PlayRecord {
     QDateTime timestamp;
 };
 
+// 单个谱面的成绩摘要 (保存在 records/index.json，选歌界面直接读取，不再逐个打开记录文件)
+struct RecordSummary {
+    int bestScore = 0;
+    QString bestGrade;   // 最高分那一次的评级
+    double bestAcc = 0;  // 历史最高准确率 (不一定与最高分同一局)
+    int playCount = 0;
+    QDateTime lastPlayed;
+};
+
+// 侧边栏显示的统计快照：GameWidget 只标记脏位，每个显示帧最多推送一次
+struct GameStats {
+    int perfect = 0;
+    int great = 0;
+    int good = 0;
+    int miss = 0;
+    int combo = 0;
+    int maxCombo = 0;
+    int score = 0;
+    double acc = 100.0;
+    qint64 currentTime = 0; // 进度 (ms)
+    qint64 duration = 1;
+    double displayLatencyMs = 0; // 估计的绘制到上屏延迟
+    bool latencyCompensated = false;
+};
+
+// 练习区间：循环游玩 [startMs, endMs) 内开始的物件 (未激活时 startMs >= 0 表示只标记了起点)
+struct PracticeSection {
+    qint64 startMs = -1;
+    qint64 endMs = 0;
+    bool active = false;
+};
+
+// 一种键数下各列的按键 (只用前 K 个)
+using KeyLayout = std::array<int, kMaxKeyCount>;
+
+// 各键数的默认键位，下标为 键数 - 1
+inline constexpr std::array<KeyLayout, kMaxKeyCount> kDefaultKeyLayouts = {{
+    KeyLayout{Qt::Key_Space},
+    KeyLayout{Qt::Key_F, Qt::Key_J},
+    KeyLayout{Qt::Key_F, Qt::Key_Space, Qt::Key_J},
+    KeyLayout{Qt::Key_D, Qt::Key_F, Qt::Key_J, Qt::Key_K},
+    KeyLayout{Qt::Key_D, Qt::Key_F, Qt::Key_Space, Qt::Key_J, Qt::Key_K},
+    KeyLayout{Qt::Key_S, Qt::Key_D, Qt::Key_F, Qt::Key_J, Qt::Key_K, Qt::Key_L},
+    KeyLayout{Qt::Key_S, Qt::Key_D, Qt::Key_F, Qt::Key_Space, Qt::Key_J, Qt::Key_K, Qt::Key_L},
+    KeyLayout{Qt::Key_A, Qt::Key_S, Qt::Key_D, Qt::Key_F, Qt::Key_J, Qt::Key_K, Qt::Key_L, Qt::Key_Semicolon},
+    KeyLayout{Qt::Key_A, Qt::Key_S, Qt::Key_D, Qt::Key_F, Qt::Key_Space, Qt::Key_J, Qt::Key_K, Qt::Key_L,
+              Qt::Key_Semicolon},
+    KeyLayout{Qt::Key_A, Qt::Key_S, Qt::Key_D, Qt::Key_F, Qt::Key_V, Qt::Key_N, Qt::Key_J, Qt::Key_K, Qt::Key_L,
+              Qt::Key_Semicolon},
+}};
+
 struct GameConfig {
     double scrollSpeed = 0.9;
     int gameWidth = 500;
@@ -49,18 +108,55 @@ struct GameConfig {
     QString songFolder = "";
 
     int preGameDelay = 2000; // 默认 2000ms (2秒)
-    int keyMapping[4] = { Qt::Key_D, Qt::Key_F, Qt::Key_J, Qt::Key_K };
+    int hudRefreshMs = 16;   // 侧边栏统计的最短刷新间隔 (0 = 每个显示帧)
+    // 每种键数一套键位：keyMapping[键数 - 1][列]
+    std::array<KeyLayout, kMaxKeyCount> keyMapping = kDefaultKeyLayouts;
+    int retryKey = Qt::Key_QuoteLeft; // 立即重开当前谱面
+    bool latencyCompensation = true;  // 按预计上屏时刻 (而不是绘制时刻) 摆放物件
+    bool reloadRewind = true;         // 谱面热重载后从改动处之前几秒继续 (否则原地继续)
     JudgmentWindow judgeWindow;
+
+    KeyLayout &keysFor(int keyCount) { return keyMapping[std::clamp(keyCount, 1, kMaxKeyCount) - 1]; }
+    const KeyLayout &keysFor(int keyCount) const { return keyMapping[std::clamp(keyCount, 1, kMaxKeyCount) - 1]; }
+};
+
+// 谱面难度统计 (扫描时由 ChartAnalysis 计算，随库缓存保存)
+struct ChartMetrics {
+    bool valid = false;      // false 表示还没算过 (例如旧缓存)
+    int noteCount = 0;
+    int holdCount = 0;
+    int durationMs = 0;      // 第一个物件到最后一个物件结束
+    float holdRatio = 0;     // 长条占比
+    float avgNps = 0;        // 平均每秒物件数
+    float peakNps = 0;       // 1 秒滑动窗口内的最大物件数
+    float chordDensity = 0;  // 平均每个时间点的物件数 (1 = 全是单点)
+    float jackDensity = 0;   // 各列中最大的 jack 密度
+    float stars = 0;         // 类 osu!mania 的 strain 星级
+    // 每列的 jack 密度 (同列短间隔连打 / 秒)，只有前 keyCount 列有意义。
+    // 定长数组而不是 QList：库里每个难度一份，不为它单独分配堆内存
+    std::array<float, kMaxKeyCount> columnJacks{};
 };
 
 struct BeatmapInfo {
     QString filePath;
-    QString title;
+    QString title;   // 显示用标题 (有 TitleUnicode 时优先用 Unicode)
     QString artist;
+    QString titleRomanised;  // [Metadata] Title: 原文 (用于搜索)
+    QString artistRomanised; // [Metadata] Artist: 原文
     QString version; // 难度名
     QString audioFilename;
-    // 生成一个唯一ID用于关联成绩
-    QString getHash() const { return artist + title + version; }
+    int previewTime = -1;    // [General] PreviewTime (ms)，-1 表示谱面没有指定
+    static constexpr int kMaxKeys = kMaxKeyCount;
+    int keyCount = 4;        // [Difficulty] CircleSize (mania 下即键数，1 ~ kMaxKeys)
+    quint64 contentHash = 0; // .osu 文件内容的 XXH64，扫描时计算一次并缓存
+
+    ChartMetrics metrics;
+
+    // 唯一ID用于关联成绩：内容哈希的 16 位十六进制 (也是记录文件名)
+    QString getHash() const { return hashToKey(contentHash); }
+    static QString hashToKey(quint64 hash) { return QString("%1").arg(hash, 16, 16, QChar('0')); }
+    // 旧版标识 (Artist + Title + Version)，仅用于迁移旧记录
+    QString legacyHash() const { return artist + title + version; }
 };
 
 #endif // STRUCTS_H
@@ -0,0 +1,128 @@
+#include "TimeStretch.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace TimeStretch {
+
+namespace {
+
+// 帧长约 23ms (44.1kHz)，50% 重叠；最多前后挪动约 6ms 去对齐波形
+constexpr int kFrame = 1024;
+constexpr int kHop = kFrame / 2;        // 输出步长
+constexpr int kOverlap = kFrame - kHop; // 相邻两帧的重叠长度
+constexpr int kTolerance = 256;         // 相似度搜索范围 (帧)
+constexpr int kCoarseStep = 4;          // 粗搜索时位置和样本都隔 4 取 1
+constexpr double kPi = 3.14159265358979323846;
+
+inline float toFloat(quint8 v) { return (int(v) - 128) / 128.0f; }
+inline float toFloat(qint16 v) { return v / 32768.0f; }
+inline float toFloat(qint32 v) { return float(v / 2147483648.0); }
+inline float toFloat(float v) { return v; }
+
+inline void store(float v, quint8 &out) { out = quint8(std::lround(std::clamp(v, -1.0f, 1.0f) * 127.0f) + 128); }
+inline void store(float v, qint16 &out) { out = qint16(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f)); }
+inline void store(float v, qint32 &out) { out = qint32(std::llround(std::clamp<double>(v, -1.0, 1.0) * 2147483647.0)); }
+inline void store(float v, float &out) { out = v; }
+
+template <typename T>
+QByteArray stretch(const T *in, qint64 frames, int channels, double rate, const std::atomic_bool *cancelled) {
+    const qint64 outFrames = qint64(std::ceil(frames / rate));
+    std::vector<float> out(size_t(outFrames + kFrame) * channels, 0.0f);
+
+    // 周期 Hann 窗：50% 重叠时逐点相加恰好为 1，不需要再归一化
+    std::array<float, kFrame> window;
+    for (int n = 0; n < kFrame; ++n) window[n] = float(0.5 - 0.5 * std::cos(2.0 * kPi * n / kFrame));
+
+    // 相似度只看各声道之和
+    auto mono = [&](qint64 frame) {
+        const T *p = in + frame * channels;
+        float sum = 0;
+        for (int c = 0; c < channels; ++c) sum += toFloat(p[c]);
+        return sum;
+    };
+    // 候选位置 pos 与目标片段的归一化互相关
+    auto similarity = [&](qint64 pos, qint64 target, int step) {
+        double dot = 0, energy = 0;
+        for (int n = 0; n < kOverlap; n += step) {
+            const float a = mono(pos + n);
+            dot += double(a) * mono(target + n);
+            energy += double(a) * a;
+        }
+        return dot / std::sqrt(energy + 1e-9);
+    };
+
+    qint64 prev = 0;
+    for (qint64 k = 0;; ++k) {
+        if ((k & 63) == 0 && cancelled && cancelled->load()) return QByteArray();
+        const qint64 outPos = k * kHop;
+        if (outPos >= outFrames) break;
+
+        qint64 pos = qint64(std::llround(k * kHop * rate));
+        const qint64 target = prev + kHop; // 上一帧在输入中的自然延续
+        if (k > 0 && target + kOverlap <= frames) {
+            const qint64 lo = std::max<qint64>(0, pos - kTolerance);
+            const qint64 hi = std::min<qint64>(frames - kOverlap, pos + kTolerance);
+            if (lo <= hi) {
+                // 先隔 kCoarseStep 粗搜，再在最好的点附近逐个细搜
+                qint64 best = lo;
+                double bestScore = -1e300;
+                for (qint64 p = lo; p <= hi; p += kCoarseStep) {
+                    const double s = similarity(p, target, kCoarseStep);
+                    if (s > bestScore) { bestScore = s; best = p; }
+                }
+                const qint64 fineLo = std::max(lo, best - kCoarseStep + 1);
+                const qint64 fineHi = std::min(hi, best + kCoarseStep - 1);
+                bestScore = -1e300;
+                for (qint64 p = fineLo; p <= fineHi; ++p) {
+                    const double s = similarity(p, target, 1);
+                    if (s > bestScore) { bestScore = s; best = p; }
+                }
+                pos = best;
+            }
+        }
+        if (pos >= frames) break;
+
+        // 加窗叠加；第一帧的前半段没有前一帧可叠，直接用原样本
+        const int len = int(std::min<qint64>(kFrame, frames - pos));
+        const T *src = in + pos * channels;
+        float *dst = out.data() + outPos * channels;
+        for (int n = 0; n < len; ++n) {
+            const float w = (k == 0 && n < kHop) ? 1.0f : window[n];
+            for (int c = 0; c < channels; ++c) dst[n * channels + c] += w * toFloat(src[n * channels + c]);
+        }
+        prev = pos;
+    }
+
+    QByteArray result(qsizetype(outFrames * channels * qint64(sizeof(T))), Qt::Uninitialized);
+    T *dst = reinterpret_cast<T *>(result.data());
+    for (qint64 i = 0; i < outFrames * channels; ++i) store(out[size_t(i)], dst[i]);
+    return result;
+}
+
+}
+
+QByteArray render(const QByteArray &pcm, const QAudioFormat &format, double rate, const std::atomic_bool *cancelled) {
+    const int channels = format.channelCount();
+    const int bytesPerFrame = format.bytesPerFrame();
+    if (channels <= 0 || bytesPerFrame <= 0 || rate <= 0) return QByteArray();
+    const qint64 frames = pcm.size() / bytesPerFrame;
+    if (frames == 0) return QByteArray();
+
+    const char *data = pcm.constData();
+    switch (format.sampleFormat()) {
+    case QAudioFormat::UInt8:
+        return stretch(reinterpret_cast<const quint8 *>(data), frames, channels, rate, cancelled);
+    case QAudioFormat::Int16:
+        return stretch(reinterpret_cast<const qint16 *>(data), frames, channels, rate, cancelled);
+    case QAudioFormat::Int32:
+        return stretch(reinterpret_cast<const qint32 *>(data), frames, channels, rate, cancelled);
+    case QAudioFormat::Float:
+        return stretch(reinterpret_cast<const float *>(data), frames, channels, rate, cancelled);
+    default:
+        return QByteArray();
+    }
+}
+
+}
@@ -0,0 +1,19 @@
+#ifndef TIMESTRETCH_H
+#define TIMESTRETCH_H
+
+#include <QAudioFormat>
+#include <QByteArray>
+#include <atomic>
+
+// 保持音高的变速 (WSOLA)：按 rate 倍的步长从输入取帧，每帧在小范围内挪到与上一帧的
+// 自然延续最相似的位置，再加窗叠加到固定步长的输出上。纯计算，只在工作线程里调用
+namespace TimeStretch {
+
+// rate > 1 变快 (输出变短)；输出格式与输入相同
+// 不支持的采样格式或 cancelled 被置位时返回空
+QByteArray render(const QByteArray &pcm, const QAudioFormat &format, double rate,
+                  const std::atomic_bool *cancelled = nullptr);
+
+}
+
+#endif // TIMESTRETCH_H
@@ -0,0 +1,209 @@
+#include "Trace.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <memory>
+#include <vector>
+
+namespace Trace {
+
+namespace detail {
+std::atomic_bool g_enabled{false};
+}
+
+namespace {
+
+struct Event {
+    const char *name;
+    qint64 ts;    // 纳秒
+    qint64 value; // span: 时长 (纳秒)；计数器: 数值
+    bool counter;
+};
+
+// 只有所属线程写入；导出时由 dump() 加锁读。锁几乎永远无竞争，只是一次原子操作
+struct ThreadBuffer {
+    int tid = 0;
+    QString name;
+    QMutex mutex;
+    std::vector<Event> ring;
+    quint64 written = 0; // 累计写入条数，ring 下标 = written % kRingCapacity
+};
+
+// 缓冲区按"线程槽"复用：线程退出时还回空闲列表，下一个新线程接着用 (沿用 tid，事件不清空)。
+// 线程池会回收空闲线程再起新线程，这样内存只随同时存在的线程数增长，而不是随累计创建过的线程数增长
+struct Registry {
+    QMutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers; // 所有槽 (导出用)
+    std::vector<std::shared_ptr<ThreadBuffer>> free;    // 所属线程已经退出的槽
+    int nextTid = 1;
+};
+
+Registry &registry() {
+    static Registry r;
+    return r;
+}
+
+// 线程局部的持有者：线程退出时析构，把缓冲区还回去
+struct LocalSlot {
+    std::shared_ptr<ThreadBuffer> buffer;
+    ~LocalSlot() {
+        if (!buffer) return;
+        Registry &r = registry();
+        QMutexLocker locker(&r.mutex);
+        r.free.push_back(std::move(buffer));
+    }
+};
+
+const QElapsedTimer &traceClock() {
+    static const QElapsedTimer timer = [] {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }();
+    return timer;
+}
+
+ThreadBuffer &localBuffer() {
+    Registry &r = registry(); // 先于 slot 构造，保证 slot 析构时还在
+    thread_local LocalSlot slot;
+    if (!slot.buffer) {
+        QString name;
+        QThread *thread = QThread::currentThread();
+        const QCoreApplication *app = QCoreApplication::instance();
+        if (app && thread == app->thread()) name = QStringLiteral("Main");
+        else if (thread) name = thread->objectName();
+
+        QMutexLocker locker(&r.mutex);
+        if (!r.free.empty()) {
+            slot.buffer = std::move(r.free.back());
+            r.free.pop_back();
+        } else {
+            slot.buffer = std::make_shared<ThreadBuffer>();
+            slot.buffer->ring.resize(kRingCapacity);
+            slot.buffer->tid = r.nextTid++;
+            r.buffers.push_back(slot.buffer);
+        }
+        QMutexLocker bufferLocker(&slot.buffer->mutex);
+        slot.buffer->name = name.isEmpty() ? QStringLiteral("Thread %1").arg(slot.buffer->tid) : name;
+    }
+    return *slot.buffer;
+}
+
+void push(const Event &event) {
+    ThreadBuffer &buffer = localBuffer();
+    QMutexLocker locker(&buffer.mutex);
+    buffer.ring[size_t(buffer.written % kRingCapacity)] = event;
+    ++buffer.written;
+}
+
+void appendJsonString(QByteArray &out, const QByteArray &text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (uchar(c) < 0x20) continue;
+        out += c;
+    }
+    out += '"';
+}
+
+// trace-event 的时间单位是微秒，保留到纳秒
+void appendMicros(QByteArray &out, qint64 ns) {
+    out += QByteArray::number(ns / 1000);
+    out += '.';
+    out += QByteArray::number(ns % 1000).rightJustified(3, '0');
+}
+
+}
+
+void setEnabled(bool enabled) {
+    traceClock(); // 让时钟在第一条事件之前启动
+    detail::g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 nowNs() {
+    return traceClock().nsecsElapsed();
+}
+
+void recordSpan(const char *name, qint64 startNs, qint64 endNs) {
+    push({name, startNs, endNs - startNs, false});
+}
+
+void recordCounter(const char *name, qint64 value) {
+    push({name, nowNs(), value, true});
+}
+
+int dump(const QString &path, QString *error) {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        Registry &r = registry();
+        QMutexLocker locker(&r.mutex);
+        buffers = r.buffers;
+    }
+
+    QByteArray json;
+    json.reserve(1 << 20);
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    int count = 0;
+    bool first = true;
+    auto begin = [&] {
+        if (!first) json += ",\n";
+        first = false;
+    };
+
+    for (const auto &buffer : buffers) {
+        std::vector<Event> events;
+        {
+            QMutexLocker locker(&buffer->mutex);
+            const quint64 n = qMin<quint64>(buffer->written, kRingCapacity);
+            events.reserve(size_t(n));
+            for (quint64 i = buffer->written - n; i < buffer->written; ++i)
+                events.push_back(buffer->ring[size_t(i % kRingCapacity)]);
+        }
+        const QByteArray tid = QByteArray::number(buffer->tid);
+
+        begin();
+        json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":";
+        appendJsonString(json, buffer->name.toUtf8());
+        json += "}}";
+
+        for (const Event &e : events) {
+            begin();
+            json += "{\"name\":";
+            appendJsonString(json, QByteArray(e.name));
+            if (e.counter) {
+                json += ",\"ph\":\"C\",\"ts\":";
+                appendMicros(json, e.ts);
+                json += ",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"value\":" + QByteArray::number(e.value) + "}}";
+            } else {
+                json += ",\"cat\":\"osu\",\"ph\":\"X\",\"ts\":";
+                appendMicros(json, e.ts);
+                json += ",\"dur\":";
+                appendMicros(json, e.value);
+                json += ",\"pid\":" + pid + ",\"tid\":" + tid + "}";
+            }
+            ++count;
+        }
+    }
+    json += "\n]}\n";
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        if (error) *error = file.errorString();
+        return -1;
+    }
+    return count;
+}
+
+void clear() {
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    for (const auto &buffer : r.buffers) {
+        QMutexLocker bufferLocker(&buffer->mutex);
+        buffer->written = 0;
+    }
+}
+
+}
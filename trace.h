@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <atomic>
+
+// 内置埋点：作用域 span 和计数器写进各线程自己的环形缓冲区 (写入不抢全局锁)，
+// 需要时导出成 Chrome trace-event JSON，用 ui.perfetto.dev 或 chrome://tracing 打开。
+// CMake 选项 OSU_ENABLE_TRACING=OFF 时 TRACE_SCOPE / TRACE_COUNTER 展开为空；
+// 编进来但运行时没开启时，每个埋点只多一次 relaxed 原子读。
+namespace Trace {
+
+// 每个线程保留最近这么多条事件，写满后覆盖最旧的
+constexpr int kRingCapacity = 1 << 16;
+
+namespace detail {
+extern std::atomic_bool g_enabled;
+}
+
+inline bool isEnabled() { return detail::g_enabled.load(std::memory_order_relaxed); }
+void setEnabled(bool enabled);
+constexpr bool compiledIn() {
+#ifdef OSU_ENABLE_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+// 进程内单调时钟 (纳秒)
+qint64 nowNs();
+
+// name 必须是静态字符串 (字面量)，缓冲区里只存指针
+void recordSpan(const char *name, qint64 startNs, qint64 endNs);
+void recordCounter(const char *name, qint64 value);
+
+// 导出所有线程 (包括已退出的线程池线程) 的缓冲区；返回写出的事件数，失败返回 -1
+int dump(const QString &path, QString *error = nullptr);
+void clear();
+
+class Span {
+public:
+    explicit Span(const char *name) : m_name(isEnabled() ? name : nullptr) {
+        if (m_name) m_start = nowNs();
+    }
+    ~Span() {
+        if (m_name) recordSpan(m_name, m_start, nowNs());
+    }
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+private:
+    const char *m_name;
+    qint64 m_start = 0;
+};
+
+}
+
+#ifdef OSU_ENABLE_TRACING
+#define OSU_TRACE_CONCAT_(a, b) a##b
+#define OSU_TRACE_CONCAT(a, b) OSU_TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) Trace::Span OSU_TRACE_CONCAT(traceSpan_, __LINE__)(name)
+#define TRACE_COUNTER(name, value) \
+    do { if (Trace::isEnabled()) Trace::recordCounter(name, qint64(value)); } while (0)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,496 @@
+#include "ZipArchive.h"
+#include "Trace.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringDecoder>
+#include <QtEndian>
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+
+// ================= inflate (RFC 1951) =================
+// 规范 Huffman 码逐位解码：不建查找表，代码短、没有额外内存；谱面包里的文件解压一次就够用
+
+constexpr int kMaxBits = 15;
+constexpr int kMaxLengthCodes = 286;
+constexpr int kMaxDistCodes = 30;
+constexpr int kFixedLengthCodes = 288;
+
+struct Huffman {
+    short count[kMaxBits + 1]; // 每种码长的符号数
+    short symbol[kFixedLengthCodes]; // 按码值排序的符号
+};
+
+// 由各符号的码长建规范 Huffman 码；返回 0 表示完整，> 0 表示不完整，< 0 表示超额 (无效)
+int construct(Huffman &h, const short *length, int n) {
+    for (int len = 0; len <= kMaxBits; ++len) h.count[len] = 0;
+    for (int s = 0; s < n; ++s) h.count[length[s]]++;
+    if (h.count[0] == n) return 0; // 没有任何符号：由调用方决定是否允许
+
+    int left = 1;
+    for (int len = 1; len <= kMaxBits; ++len) {
+        left <<= 1;
+        left -= h.count[len];
+        if (left < 0) return left;
+    }
+
+    short offs[kMaxBits + 1];
+    offs[1] = 0;
+    for (int len = 1; len < kMaxBits; ++len) offs[len + 1] = short(offs[len] + h.count[len]);
+    for (int s = 0; s < n; ++s) {
+        if (length[s] != 0) h.symbol[offs[length[s]]++] = short(s);
+    }
+    return left;
+}
+
+class Inflater {
+public:
+    Inflater(const uchar *in, qsizetype size, QByteArray &out) : m_in(in), m_size(size), m_out(out) {}
+
+    bool run() {
+        int last;
+        do {
+            last = bits(1);
+            const int type = bits(2);
+            if (m_error) return false;
+            bool ok = false;
+            if (type == 0) ok = stored();
+            else if (type == 1) ok = fixed();
+            else if (type == 2) ok = dynamic();
+            if (!ok || m_error) return false;
+        } while (!last);
+        m_out.resize(m_outLen);
+        return true;
+    }
+
+private:
+    int bits(int need) {
+        quint64 val = m_bitBuf;
+        while (m_bitCount < need) {
+            if (m_pos >= m_size) {
+                m_error = true;
+                return 0;
+            }
+            val |= quint64(m_in[m_pos++]) << m_bitCount;
+            m_bitCount += 8;
+        }
+        m_bitBuf = quint32(val >> need);
+        m_bitCount -= need;
+        return int(val & ((quint64(1) << need) - 1));
+    }
+
+    int decode(const Huffman &h) {
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= kMaxBits; ++len) {
+            code |= bits(1);
+            const int count = h.count[len];
+            if (code - count < first) return h.symbol[index + (code - first)];
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    void reserve(qsizetype n) {
+        if (m_outLen + n <= m_out.size()) return;
+        m_out.resize(std::max<qsizetype>(m_out.size() * 2, m_outLen + n));
+    }
+
+    bool stored() {
+        // 丢掉当前字节剩下的位
+        m_bitBuf = 0;
+        m_bitCount = 0;
+        if (m_pos + 4 > m_size) return false;
+        const unsigned len = m_in[m_pos] | (unsigned(m_in[m_pos + 1]) << 8);
+        const unsigned nlen = m_in[m_pos + 2] | (unsigned(m_in[m_pos + 3]) << 8);
+        m_pos += 4;
+        if (len != (~nlen & 0xffffu) || m_pos + qsizetype(len) > m_size) return false;
+        reserve(len);
+        std::memcpy(m_out.data() + m_outLen, m_in + m_pos, len);
+        m_outLen += len;
+        m_pos += len;
+        return true;
+    }
+
+    bool codes(const Huffman &lencode, const Huffman &distcode) {
+        static const short kLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                              35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const short kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                               3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const short kDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                            8193, 12289, 16385, 24577};
+        static const short kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                             7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        for (;;) {
+            int symbol = decode(lencode);
+            if (symbol < 0 || m_error) return false;
+            if (symbol < 256) {
+                reserve(1);
+                m_out.data()[m_outLen++] = char(symbol);
+                continue;
+            }
+            if (symbol == 256) return true;
+
+            symbol -= 257;
+            if (symbol >= 29) return false;
+            const int len = kLengthBase[symbol] + bits(kLengthExtra[symbol]);
+            symbol = decode(distcode);
+            if (symbol < 0 || symbol >= 30) return false;
+            const qsizetype dist = kDistBase[symbol] + bits(kDistExtra[symbol]);
+            if (m_error || dist > m_outLen) return false;
+
+            // 源和目标可能重叠 (dist < len)，只能逐字节复制
+            reserve(len);
+            char *out = m_out.data();
+            for (int i = 0; i < len; ++i, ++m_outLen) out[m_outLen] = out[m_outLen - dist];
+        }
+    }
+
+    bool fixed() {
+        struct Tables {
+            Huffman lencode, distcode;
+            Tables() {
+                short lengths[kFixedLengthCodes];
+                int s = 0;
+                for (; s < 144; ++s) lengths[s] = 8;
+                for (; s < 256; ++s) lengths[s] = 9;
+                for (; s < 280; ++s) lengths[s] = 7;
+                for (; s < kFixedLengthCodes; ++s) lengths[s] = 8;
+                construct(lencode, lengths, kFixedLengthCodes);
+                for (s = 0; s < kMaxDistCodes; ++s) lengths[s] = 5;
+                construct(distcode, lengths, kMaxDistCodes);
+            }
+        };
+        static const Tables tables;
+        return codes(tables.lencode, tables.distcode);
+    }
+
+    bool dynamic() {
+        static const short kOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        short lengths[kMaxLengthCodes + kMaxDistCodes];
+        Huffman lencode, distcode;
+
+        const int nlen = bits(5) + 257;
+        const int ndist = bits(5) + 1;
+        const int ncode = bits(4) + 4;
+        if (m_error || nlen > kMaxLengthCodes || ndist > kMaxDistCodes) return false;
+
+        // 码长的码长
+        int index = 0;
+        for (; index < ncode; ++index) lengths[kOrder[index]] = short(bits(3));
+        for (; index < 19; ++index) lengths[kOrder[index]] = 0;
+        if (m_error || construct(lencode, lengths, 19) != 0) return false;
+
+        index = 0;
+        while (index < nlen + ndist) {
+            int symbol = decode(lencode);
+            if (symbol < 0 || m_error) return false;
+            if (symbol < 16) {
+                lengths[index++] = short(symbol);
+                continue;
+            }
+            short len = 0;
+            if (symbol == 16) {
+                if (index == 0) return false;
+                len = lengths[index - 1];
+                symbol = 3 + bits(2);
+            } else if (symbol == 17) {
+                symbol = 3 + bits(3);
+            } else {
+                symbol = 11 + bits(7);
+            }
+            if (m_error || index + symbol > nlen + ndist) return false;
+            while (symbol--) lengths[index++] = len;
+        }
+        if (lengths[256] == 0) return false; // 必须有块结束符
+
+        // 不完整的码只允许是单个 1 位码
+        int err = construct(lencode, lengths, nlen);
+        if (err && (err < 0 || nlen != lencode.count[0] + lencode.count[1])) return false;
+        err = construct(distcode, lengths + nlen, ndist);
+        if (err && (err < 0 || ndist != distcode.count[0] + distcode.count[1])) return false;
+
+        return codes(lencode, distcode);
+    }
+
+    const uchar *m_in;
+    qsizetype m_size;
+    qsizetype m_pos = 0;
+    quint32 m_bitBuf = 0;
+    int m_bitCount = 0;
+    bool m_error = false;
+
+    QByteArray &m_out;
+    qsizetype m_outLen = 0;
+};
+
+// ================= 中央目录 =================
+
+constexpr quint32 kLocalHeaderSig = 0x04034b50;
+constexpr quint32 kCentralHeaderSig = 0x02014b50;
+constexpr quint32 kEndOfCentralDirSig = 0x06054b50;
+constexpr int kLocalHeaderSize = 30;
+constexpr int kCentralHeaderSize = 46;
+constexpr int kEndOfCentralDirSize = 22;
+constexpr int kIndexCacheCapacity = 64;
+
+inline quint16 le16(const uchar *p) { return qFromLittleEndian<quint16>(p); }
+inline quint32 le32(const uchar *p) { return qFromLittleEndian<quint32>(p); }
+
+bool fail(QString *error, const QString &message) {
+    if (error) *error = message;
+    return false;
+}
+
+// 设置了 UTF-8 标志位就按 UTF-8；没设置时很多打包工具其实也写的是 UTF-8，不合法再退回 Latin-1
+QString decodeName(const QByteArray &raw, quint16 flags) {
+    if (flags & 0x0800) return QString::fromUtf8(raw);
+    QStringDecoder decoder(QStringDecoder::Utf8);
+    QString name = decoder(raw);
+    return decoder.hasError() ? QString::fromLatin1(raw) : name;
+}
+
+ZipIndexPtr readIndex(const QFileInfo &info, QString *error) {
+    QFile file(info.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(error, file.errorString());
+        return nullptr;
+    }
+    const qint64 size = info.size();
+
+    // 目录结束记录在文件末尾，后面最多跟 65535 字节的注释
+    const qint64 tailSize = std::min<qint64>(size, kEndOfCentralDirSize + 0xFFFF);
+    if (tailSize < kEndOfCentralDirSize || !file.seek(size - tailSize)) {
+        fail(error, "Not a zip archive");
+        return nullptr;
+    }
+    const QByteArray tail = file.read(tailSize);
+    const uchar *t = reinterpret_cast<const uchar *>(tail.constData());
+    qint64 eocd = -1;
+    for (qint64 i = tail.size() - kEndOfCentralDirSize; i >= 0; --i) {
+        if (le32(t + i) == kEndOfCentralDirSig) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0) {
+        fail(error, "Not a zip archive");
+        return nullptr;
+    }
+
+    const int count = le16(t + eocd + 10);
+    const qint64 dirSize = le32(t + eocd + 12);
+    const qint64 dirOffset = le32(t + eocd + 16);
+    if (count == 0xFFFF || dirSize == 0xFFFFFFFFLL || dirOffset == 0xFFFFFFFFLL) {
+        fail(error, "ZIP64 archives are not supported");
+        return nullptr;
+    }
+    if (dirOffset + dirSize > size || !file.seek(dirOffset)) {
+        fail(error, "Corrupt central directory");
+        return nullptr;
+    }
+    const QByteArray dir = file.read(dirSize);
+    if (dir.size() != dirSize) {
+        fail(error, "Corrupt central directory");
+        return nullptr;
+    }
+
+    auto index = std::make_shared<ZipIndex>();
+    index->archivePath = info.absoluteFilePath();
+    index->archiveSize = size;
+    index->archiveMtime = info.lastModified().toMSecsSinceEpoch();
+    index->entries.reserve(count);
+    index->byName.reserve(count);
+
+    const uchar *d = reinterpret_cast<const uchar *>(dir.constData());
+    qint64 pos = 0;
+    for (int i = 0; i < count; ++i) {
+        if (pos + kCentralHeaderSize > dir.size() || le32(d + pos) != kCentralHeaderSig) {
+            fail(error, "Corrupt central directory");
+            return nullptr;
+        }
+        const uchar *h = d + pos;
+        const int nameLen = le16(h + 28);
+        const int extraLen = le16(h + 30);
+        const int commentLen = le16(h + 32);
+        if (pos + kCentralHeaderSize + nameLen + extraLen + commentLen > dir.size()) {
+            fail(error, "Corrupt central directory");
+            return nullptr;
+        }
+
+        ZipEntry entry;
+        entry.flags = le16(h + 8);
+        entry.method = le16(h + 10);
+        entry.crc32 = le32(h + 16);
+        entry.compressedSize = le32(h + 20);
+        entry.size = le32(h + 24);
+        entry.localHeaderOffset = le32(h + 42);
+        entry.name = decodeName(QByteArray(reinterpret_cast<const char *>(h + kCentralHeaderSize), nameLen), entry.flags);
+        entry.name.replace('\\', '/');
+        pos += kCentralHeaderSize + nameLen + extraLen + commentLen;
+
+        if (entry.name.endsWith('/')) continue; // 目录项
+        index->byName.insert(entry.name.toLower(), int(index->entries.size()));
+        index->entries.push_back(std::move(entry));
+    }
+    return index;
+}
+
+struct IndexCache {
+    QMutex mutex;
+    QList<ZipIndexPtr> entries; // 最近使用的在最前
+};
+
+IndexCache &indexCache() {
+    static IndexCache cache;
+    return cache;
+}
+
+const std::array<quint32, 256> kCrcTable = [] {
+    std::array<quint32, 256> table{};
+    for (quint32 i = 0; i < 256; ++i) {
+        quint32 c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : (c >> 1);
+        table[i] = c;
+    }
+    return table;
+}();
+
+}
+
+const ZipEntry *ZipIndex::find(const QString &name) const {
+    const int i = byName.value(name.toLower(), -1);
+    return i < 0 ? nullptr : &entries[i];
+}
+
+namespace ZipArchive {
+
+ZipIndexPtr index(const QString &archivePath, QString *error) {
+    const QFileInfo info(archivePath);
+    if (!info.isFile()) {
+        fail(error, "Archive not found");
+        return nullptr;
+    }
+    const QString path = info.absoluteFilePath();
+    const qint64 size = info.size();
+    const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+
+    IndexCache &cache = indexCache();
+    {
+        QMutexLocker locker(&cache.mutex);
+        for (qsizetype i = 0; i < cache.entries.size(); ++i) {
+            const ZipIndexPtr &entry = cache.entries[i];
+            if (entry->archivePath != path) continue;
+            if (entry->archiveSize == size && entry->archiveMtime == mtime) {
+                cache.entries.move(i, 0);
+                return cache.entries.first();
+            }
+            cache.entries.removeAt(i); // 包被替换过
+            break;
+        }
+    }
+
+    // 读目录不持锁：扫描时多个线程可以同时读不同的包
+    ZipIndexPtr built = readIndex(info, error);
+    if (!built) return nullptr;
+
+    QMutexLocker locker(&cache.mutex);
+    cache.entries.prepend(built);
+    while (cache.entries.size() > kIndexCacheCapacity) cache.entries.removeLast();
+    return built;
+}
+
+bool extract(const ZipIndex &index, const ZipEntry &entry, QByteArray &out, QString *error) {
+    TRACE_SCOPE("zip.extract");
+    if (entry.flags & 0x0001) return fail(error, "Encrypted entries are not supported");
+    if (entry.method != 0 && entry.method != 8) {
+        return fail(error, QString("Unsupported compression method %1").arg(entry.method));
+    }
+
+    QFile file(index.archivePath);
+    if (!file.open(QIODevice::ReadOnly)) return fail(error, file.errorString());
+
+    // 本地头里的文件名 / 扩展字段长度可能和中央目录不同，以本地头为准
+    if (!file.seek(entry.localHeaderOffset)) return fail(error, "Corrupt local header");
+    const QByteArray header = file.read(kLocalHeaderSize);
+    const uchar *h = reinterpret_cast<const uchar *>(header.constData());
+    if (header.size() != kLocalHeaderSize || le32(h) != kLocalHeaderSig) return fail(error, "Corrupt local header");
+    const qint64 dataOffset = entry.localHeaderOffset + kLocalHeaderSize + le16(h + 26) + le16(h + 28);
+
+    if (!file.seek(dataOffset)) return fail(error, "Truncated entry");
+    const QByteArray data = file.read(entry.compressedSize);
+    if (data.size() != entry.compressedSize) return fail(error, "Truncated entry");
+
+    if (entry.method == 0) {
+        out = data;
+    } else if (!inflate(data.constData(), data.size(), out, qsizetype(entry.size))) {
+        return fail(error, "Corrupt deflate stream");
+    }
+    if (out.size() != entry.size || crc32(out.constData(), out.size()) != entry.crc32) {
+        return fail(error, "CRC mismatch");
+    }
+    return true;
+}
+
+bool inflate(const char *data, qsizetype size, QByteArray &out, qsizetype expectedSize) {
+    out.resize(std::max<qsizetype>(expectedSize, std::max<qsizetype>(size * 2, 1024)));
+    Inflater inflater(reinterpret_cast<const uchar *>(data), size, out);
+    if (inflater.run()) return true;
+    out.clear();
+    return false;
+}
+
+quint32 crc32(const char *data, qsizetype size) {
+    quint32 c = 0xFFFFFFFFu;
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    for (qsizetype i = 0; i < size; ++i) c = kCrcTable[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+bool isArchiveName(const QString &path) {
+    return path.endsWith(QLatin1String(".osz"), Qt::CaseInsensitive);
+}
+
+bool splitPath(const QString &path, QString *archivePath, QString *entryName) {
+    static const QLatin1String kMarker(".osz/");
+    qsizetype at = path.indexOf(kMarker, 0, Qt::CaseInsensitive);
+    while (at >= 0) {
+        const QString archive = path.left(at + 4);
+        if (QFileInfo(archive).isFile()) {
+            if (archivePath) *archivePath = archive;
+            if (entryName) *entryName = path.mid(at + kMarker.size());
+            return true;
+        }
+        at = path.indexOf(kMarker, at + 1, Qt::CaseInsensitive); // 叫 xxx.osz 的文件夹
+    }
+    return false;
+}
+
+QString joinPath(const QString &archivePath, const QString &entryName) {
+    return archivePath + '/' + entryName;
+}
+
+bool readFile(const QString &path, QByteArray &out) {
+    QString archive, entryName;
+    if (!splitPath(path, &archive, &entryName)) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        out = file.readAll();
+        return true;
+    }
+    ZipIndexPtr idx = index(archive);
+    if (!idx) return false;
+    const ZipEntry *entry = idx->find(entryName);
+    return entry && extract(*idx, *entry, out);
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef ZIPARCHIVE_H
+#define ZIPARCHIVE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+// 包内的一个文件 (中央目录项)
+struct ZipEntry {
+    QString name;               // 包内路径，'/' 分隔
+    quint16 method = 0;         // 0 = stored, 8 = deflate
+    quint16 flags = 0;
+    quint32 crc32 = 0;
+    qint64 compressedSize = 0;
+    qint64 size = 0;            // 解压后大小
+    qint64 localHeaderOffset = 0;
+};
+
+// 一个 .osz (zip) 的中央目录
+struct ZipIndex {
+    QString archivePath;
+    qint64 archiveSize = 0;
+    qint64 archiveMtime = 0;
+    std::vector<ZipEntry> entries;
+    QHash<QString, int> byName; // 小写包内路径 -> entries 下标 (osu! 的文件名不区分大小写)
+
+    const ZipEntry *find(const QString &name) const;
+};
+using ZipIndexPtr = std::shared_ptr<const ZipIndex>;
+
+// .osz 谱面包：只读中央目录建索引，条目按需解压到内存 (stored / deflate，自带 inflate)，不落盘。
+// 包内文件用虚拟路径 "<包路径>/<包内路径>" 表示 (例如 Songs/123 Foo.osz/Foo [Hard].osu)，
+// 包就像一个文件夹；readFile() 等函数对普通文件和包内文件一视同仁。
+namespace ZipArchive {
+
+// 中央目录索引：按 (路径, 大小, 修改时间) 缓存在进程内，同一个包反复打开不再读目录 (线程安全)
+ZipIndexPtr index(const QString &archivePath, QString *error = nullptr);
+// 把一个条目解压到内存并校验 CRC
+bool extract(const ZipIndex &index, const ZipEntry &entry, QByteArray &out, QString *error = nullptr);
+
+// 原始 deflate 流 (RFC 1951)；expectedSize 只用于预分配，可以为 0
+bool inflate(const char *data, qsizetype size, QByteArray &out, qsizetype expectedSize = 0);
+quint32 crc32(const char *data, qsizetype size);
+
+// 虚拟路径
+bool isArchiveName(const QString &path); // 以 .osz 结尾
+// 拆分 "xxx.osz/entry"；不是包内路径 (或 xxx.osz 不是文件) 时返回 false
+bool splitPath(const QString &path, QString *archivePath, QString *entryName);
+QString joinPath(const QString &archivePath, const QString &entryName);
+
+// 读取普通文件或包内文件
+bool readFile(const QString &path, QByteArray &out);
+
+}
+
+#endif // ZIPARCHIVE_H